@@ -7,10 +7,14 @@
 
 #include <benchmark/benchmark.h>
 
+#include <fcntl.h>
 #include <math.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -18,8 +22,13 @@
 #include "google/protobuf/descriptor.pb.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/log/absl_check.h"
+#include "google/protobuf/descriptor_database.h"
 #include "google/protobuf/dynamic_message.h"
+#include "google/protobuf/huge_page_block_allocator.h"
+#include "google/protobuf/io/async_file_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
 #include "google/protobuf/json/json.h"
+#include "google/protobuf/util/reverse_serializer.h"
 #include "benchmarks/descriptor.pb.h"
 #include "benchmarks/descriptor.upb.h"
 #include "benchmarks/descriptor.upbdefs.h"
@@ -31,6 +40,7 @@
 #include "upb/mem/arena.h"
 #include "upb/reflection/def.hpp"
 #include "upb/wire/decode.h"
+#include "utf8_validity.h"
 
 upb_StringView descriptor =
     benchmarks_descriptor_proto_upbdefinit.descriptor;
@@ -240,6 +250,33 @@ static void BM_LoadAdsDescriptor_Proto2(benchmark::State& state) {
 BENCHMARK_TEMPLATE(BM_LoadAdsDescriptor_Proto2, NoLayout);
 BENCHMARK_TEMPLATE(BM_LoadAdsDescriptor_Proto2, WithLayout);
 
+// The work done for each generated file during static initialization: adding
+// its embedded descriptor to the generated database's index.  Building the
+// files into a pool is measured by BM_LoadAdsDescriptor_Proto2 above.
+static void BM_IndexAdsDescriptor_Proto2(benchmark::State& state) {
+  extern _upb_DefPool_Init
+      google_ads_googleads_v16_services_google_ads_service_proto_upbdefinit;
+  std::vector<upb_StringView> serialized_files;
+  absl::flat_hash_set<const _upb_DefPool_Init*> seen_files;
+  CollectFileDescriptors(
+      &google_ads_googleads_v16_services_google_ads_service_proto_upbdefinit,
+      serialized_files, seen_files);
+  size_t bytes_per_iter = 0;
+  for (auto _ : state) {
+    bytes_per_iter = 0;
+    protobuf::EncodedDescriptorDatabase database;
+    for (auto file : serialized_files) {
+      if (!database.Add(file.data, static_cast<int>(file.size))) {
+        printf("Failed to add file.\n");
+        exit(1);
+      }
+      bytes_per_iter += file.size;
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * bytes_per_iter);
+}
+BENCHMARK(BM_IndexAdsDescriptor_Proto2);
+
 enum CopyStrings {
   Copy,
   Alias,
@@ -249,6 +286,7 @@ enum ArenaMode {
   NoArena,
   UseArena,
   InitBlock,
+  HugePageArena,
 };
 
 template <ArenaMode AMode, CopyStrings Copy>
@@ -315,6 +353,26 @@ struct Proto2Factory<InitBlock, P> {
   protobuf::Arena arena;
 };
 
+template <class P>
+struct Proto2Factory<HugePageArena, P> {
+ public:
+  Proto2Factory() : arena(GetOptions()) {}
+  P* GetProto() { return protobuf::Arena::Create<P>(&arena); }
+
+ private:
+  protobuf::ArenaOptions GetOptions() {
+    protobuf::ArenaOptions opts;
+    opts.block_alloc = &protobuf::internal::HugePageBlockAllocator::Allocate;
+    opts.block_dealloc =
+        &protobuf::internal::HugePageBlockAllocator::Deallocate;
+    opts.start_block_size = 64 << 10;
+    opts.max_block_size = 1 << 20;
+    return opts;
+  }
+
+  protobuf::Arena arena;
+};
+
 using FileDesc = ::upb_benchmark::FileDescriptorProto;
 using FileDescSV = ::upb_benchmark::sv::FileDescriptorProto;
 
@@ -341,6 +399,92 @@ BENCHMARK_TEMPLATE(BM_Parse_Proto2, FileDesc, UseArena, Copy);
 BENCHMARK_TEMPLATE(BM_Parse_Proto2, FileDesc, InitBlock, Copy);
 BENCHMARK_TEMPLATE(BM_Parse_Proto2, FileDescSV, InitBlock, Alias);
 
+// Concatenating a serialized message with itself merges the repeated fields,
+// which gives a large message with the shape of descriptor.proto.
+static const std::string& LargeDescriptorInput() {
+  static const std::string* input = [] {
+    auto* res = new std::string;
+    for (int i = 0; i < 1000; ++i) {
+      res->append(descriptor.data, descriptor.size);
+    }
+    return res;
+  }();
+  return *input;
+}
+
+template <ArenaMode AMode>
+void BM_Parse_Proto2_Large(benchmark::State& state) {
+  const std::string& input = LargeDescriptorInput();
+  for (auto _ : state) {
+    Proto2Factory<AMode, FileDesc> proto_factory;
+    auto proto = proto_factory.GetProto();
+    bool ok = proto->ParseFromString(input);
+    if (!ok) {
+      printf("Failed to parse.\n");
+      exit(1);
+    }
+    benchmark::DoNotOptimize(proto);
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK_TEMPLATE(BM_Parse_Proto2_Large, UseArena);
+BENCHMARK_TEMPLATE(BM_Parse_Proto2_Large, HugePageArena);
+
+// A pool of threads filling one arena-owned response. Reports the arena's
+// memory footprint next to the time so that the cost of bounding the number of
+// per-thread sub-arenas can be weighed against the memory it saves.
+template <size_t kMaxThreadArenas>
+static void BM_Arena_CrossThreadFill(benchmark::State& state) {
+  static protobuf::Arena* arena;
+  if (state.thread_index() == 0) {
+    protobuf::ArenaOptions options;
+    options.max_thread_arenas = kMaxThreadArenas;
+    arena = new protobuf::Arena(options);
+  }
+  for (auto _ : state) {
+    auto* proto =
+        protobuf::Arena::Create<upb_benchmark::DescriptorProto>(arena);
+    proto->set_name("message");
+    proto->add_field()->set_name("field");
+    benchmark::DoNotOptimize(proto);
+  }
+  if (state.thread_index() == 0) {
+    state.counters["space_allocated"] = arena->SpaceAllocated();
+    state.counters["space_used"] = arena->SpaceUsed();
+    delete arena;
+  }
+}
+BENCHMARK_TEMPLATE(BM_Arena_CrossThreadFill, 0)
+    ->ThreadRange(1, 64)
+    ->Iterations(10000)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Arena_CrossThreadFill, 4)
+    ->ThreadRange(1, 64)
+    ->Iterations(10000)
+    ->UseRealTime();
+
+enum Utf8Text { Ascii, Latin1, Cjk };
+
+// UTF-8 validation alone, as done for string fields on parse. Reports the
+// throughput per input byte.
+template <Utf8Text kText>
+static void BM_Utf8Validate(benchmark::State& state) {
+  // Each unit is 4 bytes: ASCII, ASCII and a 2-byte codepoint, or a 3-byte
+  // codepoint and ASCII.
+  const char* unit = "abcd";
+  if (kText == Latin1) unit = "ab\xc3\xa9";
+  if (kText == Cjk) unit = "\xe4\xb8\xadx";
+  std::string str;
+  while (str.size() < static_cast<size_t>(state.range(0))) str += unit;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(utf8_range::IsStructurallyValid(str));
+  }
+  state.SetBytesProcessed(state.iterations() * str.size());
+}
+BENCHMARK_TEMPLATE(BM_Utf8Validate, Ascii)->Range(16, 1 << 16);
+BENCHMARK_TEMPLATE(BM_Utf8Validate, Latin1)->Range(16, 1 << 16);
+BENCHMARK_TEMPLATE(BM_Utf8Validate, Cjk)->Range(16, 1 << 16);
+
 static void BM_SerializeDescriptor_Proto2(benchmark::State& state) {
   upb_benchmark::FileDescriptorProto proto;
   proto.ParseFromArray(descriptor.data, descriptor.size);
@@ -351,6 +495,29 @@ static void BM_SerializeDescriptor_Proto2(benchmark::State& state) {
 }
 BENCHMARK(BM_SerializeDescriptor_Proto2);
 
+static void BM_SerializeDescriptor_Proto2_ToString(benchmark::State& state) {
+  upb_benchmark::FileDescriptorProto proto;
+  proto.ParseFromArray(descriptor.data, descriptor.size);
+  std::string output;
+  for (auto _ : state) {
+    proto.SerializePartialToString(&output);
+  }
+  state.SetBytesProcessed(state.iterations() * descriptor.size);
+}
+BENCHMARK(BM_SerializeDescriptor_Proto2_ToString);
+
+static void BM_SerializeDescriptor_Proto2_Reverse(benchmark::State& state) {
+  upb_benchmark::FileDescriptorProto proto;
+  proto.ParseFromArray(descriptor.data, descriptor.size);
+  protobuf::util::ReverseSerializer serializer;
+  std::string output;
+  for (auto _ : state) {
+    serializer.SerializePartialToString(proto, &output);
+  }
+  state.SetBytesProcessed(state.iterations() * descriptor.size);
+}
+BENCHMARK(BM_SerializeDescriptor_Proto2_Reverse);
+
 static upb_benchmark_FileDescriptorProto* UpbParseDescriptor(upb_Arena* arena) {
   upb_benchmark_FileDescriptorProto* set =
       upb_benchmark_FileDescriptorProto_parse(descriptor.data, descriptor.size,
@@ -469,3 +636,51 @@ static void BM_JsonSerialize_Proto2(benchmark::State& state) {
   state.SetBytesProcessed(state.iterations() * json.size());
 }
 BENCHMARK(BM_JsonSerialize_Proto2);
+
+enum FileReader { Plain, Async };
+
+// Reads a local file through a stream, touching every byte the way a parser
+// would.  The file is in the page cache after the first iteration, so this
+// measures per-buffer overhead rather than disk latency.
+template <FileReader kReader>
+static void BM_ReadFile(benchmark::State& state) {
+  const char* tmpdir = getenv("TEST_TMPDIR");
+  std::string filename =
+      std::string(tmpdir != nullptr ? tmpdir : "/tmp") + "/bm_read_file";
+  const size_t file_size = 64 << 20;
+  {
+    int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    ABSL_CHECK_GE(fd, 0);
+    std::string chunk(1 << 20, 'x');
+    for (size_t i = 0; i < file_size; i += chunk.size()) {
+      ABSL_CHECK_EQ(write(fd, chunk.data(), chunk.size()),
+                    static_cast<ssize_t>(chunk.size()));
+    }
+    close(fd);
+  }
+  int fd = open(filename.c_str(), O_RDONLY);
+  ABSL_CHECK_GE(fd, 0);
+  for (auto _ : state) {
+    ABSL_CHECK_EQ(lseek(fd, 0, SEEK_SET), 0);
+    std::unique_ptr<protobuf::io::ZeroCopyInputStream> input;
+    if (kReader == Async) {
+      input = std::make_unique<protobuf::io::AsyncFileInputStream>(fd);
+    } else {
+      input = std::make_unique<protobuf::io::FileInputStream>(fd, 256 << 10);
+    }
+    const void* data;
+    int size;
+    uint64_t sum = 0;
+    while (input->Next(&data, &size)) {
+      const char* p = static_cast<const char*>(data);
+      for (int i = 0; i < size; i += 64) sum += p[i];
+    }
+    ABSL_CHECK_EQ(input->ByteCount(), static_cast<int64_t>(file_size));
+    benchmark::DoNotOptimize(sum);
+  }
+  close(fd);
+  unlink(filename.c_str());
+  state.SetBytesProcessed(state.iterations() * file_size);
+}
+BENCHMARK_TEMPLATE(BM_ReadFile, Plain);
+BENCHMARK_TEMPLATE(BM_ReadFile, Async);
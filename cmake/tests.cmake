@@ -42,6 +42,16 @@ foreach(proto_file ${tests_protos})
   set(tests_proto_files ${tests_proto_files} ${pb_generated_files})
 endforeach(proto_file)
 
+# Messages compiled with the table_driven_serialization generator option.
+protobuf_generate(
+  PROTOS ${protobuf_SOURCE_DIR}/src/google/protobuf/unittest_table_driven_serialization.proto
+  LANGUAGE cpp
+  PLUGIN_OPTIONS table_driven_serialization
+  OUT_VAR pb_generated_files
+  IMPORT_DIRS ${protobuf_SOURCE_DIR}/src
+)
+set(tests_proto_files ${tests_proto_files} ${pb_generated_files})
+
 set(common_test_files
   ${test_util_hdrs}
   ${lite_test_util_srcs}
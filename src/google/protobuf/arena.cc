@@ -12,6 +12,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <limits>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -23,6 +24,7 @@
 #include "absl/synchronization/mutex.h"
 #include "absl/types/span.h"
 #include "google/protobuf/arena_allocation_policy.h"
+#include "google/protobuf/arena_block_cache.h"
 #include "google/protobuf/arena_cleanup.h"
 #include "google/protobuf/arenaz_sampler.h"
 #include "google/protobuf/port.h"
@@ -68,6 +70,9 @@ inline size_t AllocationSize(size_t last_size, size_t start_size,
 }
 
 SizedPtr AllocateMemory(const AllocationPolicy& policy, size_t size) {
+  if (policy.UsesBlockCache()) {
+    return ArenaBlockCache::Allocate(size);
+  }
   if (policy.block_alloc == nullptr) {
     return AllocateAtLeast(size);
   }
@@ -102,10 +107,13 @@ SizedPtr AllocateCleanupChunk(const AllocationPolicy* policy_ptr,
 class GetDeallocator {
  public:
   explicit GetDeallocator(const AllocationPolicy* policy)
-      : dealloc_(policy ? policy->block_dealloc : nullptr) {}
+      : dealloc_(policy ? policy->block_dealloc : nullptr),
+        use_block_cache_(policy && policy->UsesBlockCache()) {}
 
   void operator()(SizedPtr mem) const {
-    if (dealloc_) {
+    if (use_block_cache_) {
+      ArenaBlockCache::Deallocate(mem.p, mem.n);
+    } else if (dealloc_) {
       dealloc_(mem.p, mem.n);
     } else {
       internal::SizedDelete(mem.p, mem.n);
@@ -114,6 +122,7 @@ class GetDeallocator {
 
  private:
   void (*dealloc_)(void*, size_t);
+  bool use_block_cache_;
 };
 
 }  // namespace
@@ -182,6 +191,27 @@ void ChunkList::Cleanup(const SerialArena& arena) {
   };
 }
 
+void ChunkList::RewindTo(Position position, const SerialArena& arena) {
+  GetDeallocator deallocator(arena.parent_.AllocPolicy());
+  // Destroy in the reverse order of insertion, chunk by chunk.
+  while (head_ != position.chunk) {
+    ABSL_DCHECK(head_ != nullptr);
+    for (CleanupNode* first = head_->First(); next_ != first;) {
+      (--next_)->Destroy();
+    }
+    Chunk* next = head_->next;
+    deallocator({head_, head_->size});
+    head_ = next;
+    next_ = head_ == nullptr ? nullptr : head_->Last() + 1;
+  }
+  ABSL_DCHECK_GE(next_, position.next);
+  while (next_ != position.next) {
+    (--next_)->Destroy();
+  }
+  limit_ = head_ == nullptr ? nullptr : head_->Last() + 1;
+  prefetch_ptr_ = reinterpret_cast<char*>(next_);
+}
+
 std::vector<void*> ChunkList::PeekForTesting() {
   std::vector<void*> ret;
   Chunk* c = head_;
@@ -230,10 +260,6 @@ std::vector<void*> SerialArena::PeekCleanupListForTesting() {
   return cleanup_list_.PeekForTesting();
 }
 
-std::vector<void*> ThreadSafeArena::PeekCleanupListForTesting() {
-  return GetSerialArena()->PeekCleanupListForTesting();
-}
-
 void SerialArena::Init(ArenaBlock* b, size_t offset) {
   set_range(b->Pointer(offset), b->Limit());
   head_.store(b, std::memory_order_relaxed);
@@ -256,6 +282,9 @@ SerialArena* SerialArena::New(SizedPtr mem, ThreadSafeArena& parent) {
 
 template <typename Deallocator>
 SizedPtr SerialArena::Free(Deallocator deallocator) {
+  ThreadSafeArenaStats::RecordStringBlockUnused(
+      parent_.arena_stats_.MutableStats(),
+      string_block_unused_.load(std::memory_order_relaxed));
   FreeStringBlocks();
 
   ArenaBlock* b = head();
@@ -268,6 +297,69 @@ SizedPtr SerialArena::Free(Deallocator deallocator) {
   return mem;
 }
 
+SerialArenaCheckpoint SerialArena::Checkpoint() {
+  SerialArenaCheckpoint checkpoint;
+  checkpoint.serial = this;
+  checkpoint.head = head();
+  checkpoint.ptr = ptr();
+  checkpoint.limit = limit_;
+  checkpoint.space_used = space_used_.load(std::memory_order_relaxed);
+  checkpoint.space_allocated = space_allocated_.load(std::memory_order_relaxed);
+  checkpoint.cleanup = cleanup_list_.position();
+  checkpoint.string_block = string_block_.load(std::memory_order_relaxed);
+  checkpoint.string_block_unused =
+      string_block_unused_.load(std::memory_order_relaxed);
+  return checkpoint;
+}
+
+void SerialArena::RewindTo(const SerialArenaCheckpoint& checkpoint) {
+  ABSL_DCHECK_EQ(checkpoint.serial, this);
+  // Same order as on destruction: cleanups first, then strings, then memory.
+  cleanup_list_.RewindTo(checkpoint.cleanup, *this);
+
+  StringBlock* sb = string_block_.load(std::memory_order_relaxed);
+  size_t unused = string_block_unused_.load(std::memory_order_relaxed);
+  while (sb != checkpoint.string_block) {
+    ABSL_DCHECK(sb != nullptr);
+    for (std::string* s = sb->AtOffset(unused); s != sb->end(); ++s) {
+      s->~basic_string();
+    }
+    StringBlock* next = sb->next();
+    StringBlock::Delete(sb);
+    sb = next;
+    unused = 0;
+  }
+  if (sb != nullptr) {
+    ABSL_DCHECK_LE(unused, checkpoint.string_block_unused);
+    std::string* end = sb->AtOffset(checkpoint.string_block_unused);
+    for (std::string* s = sb->AtOffset(unused); s != end; ++s) {
+      s->~basic_string();
+    }
+  }
+  string_block_.store(checkpoint.string_block, std::memory_order_relaxed);
+  string_block_unused_.store(checkpoint.string_block_unused,
+                             std::memory_order_relaxed);
+
+  GetDeallocator deallocator(parent_.AllocPolicy());
+  for (ArenaBlock* b = head(); b != checkpoint.head;) {
+    ABSL_DCHECK(b != nullptr && !b->IsSentry());
+    ArenaBlock* next = b->next;
+    deallocator({b, b->size});
+    b = next;
+  }
+  head_.store(checkpoint.head, std::memory_order_release);
+  set_range(checkpoint.ptr, checkpoint.limit);
+  space_used_.store(checkpoint.space_used, std::memory_order_relaxed);
+  space_allocated_.store(checkpoint.space_allocated,
+                         std::memory_order_relaxed);
+  cached_block_length_ = 0;
+  cached_blocks_ = nullptr;
+
+  if (ptr() != nullptr) {
+    PROTOBUF_POISON_MEMORY_REGION(ptr(), limit_ - ptr());
+  }
+}
+
 PROTOBUF_NOINLINE
 void* SerialArena::AllocateAlignedFallback(size_t n) {
   AllocateNewBlock(n);
@@ -296,6 +388,8 @@ void* SerialArena::AllocateFromStringBlockFallback() {
     new_sb = StringBlock::New(sb);
     AddSpaceAllocated(new_sb->allocated_size());
   }
+  ThreadSafeArenaStats::RecordStringBlockAllocation(
+      parent_.arena_stats_.MutableStats(), new_sb->allocated_size());
   string_block_.store(new_sb, std::memory_order_release);
   size_t unused = new_sb->effective_size() - sizeof(std::string);
   string_block_unused_.store(unused, std::memory_order_relaxed);
@@ -545,6 +639,245 @@ ThreadSafeArena::SerialArenaChunk* ThreadSafeArena::SentrySerialArenaChunk() {
       const_cast<SerialArenaChunkHeader*>(&kSentryArenaChunk));
 }
 
+// A SerialArena shared by several threads of an arena created with
+// AllocationPolicy::max_thread_arenas. Threads allocate by bumping the
+// SerialArena's `ptr_` with a compare-and-swap, bounded by `limit_`, so
+// allocating takes no lock. `mu_` is only taken to create the SerialArena and
+// to give it a new block once the current one is full. The rest of the
+// SerialArena's state (its own limit, cleanup list, string blocks and array
+// freelists) is not thread-safe and is only touched under `mu_` or not at all:
+// cleanups go to a lock-free list of their own and strings are allocated one
+// at a time, each with its cleanup.
+class alignas(kCacheAlignment) ThreadSafeArena::SharedSerialArena {
+ public:
+  void* AllocateAligned(size_t n, size_t align, ThreadSafeArena& parent) {
+    ABSL_DCHECK(ArenaAlignDefault::IsAligned(n));
+    if (void* ret = TryAllocateAligned(n, align)) return ret;
+    return AllocateAlignedFallback(n, align, parent);
+  }
+
+  // An object that needs a destructor shares one allocation with its cleanup
+  // node, which is placed right before it.
+  void* AllocateAlignedWithCleanup(size_t n, size_t align,
+                                   void (*destructor)(void*),
+                                   ThreadSafeArena& parent) {
+    if (align > ArenaAlignDefault::align) {
+      void* ret = AllocateAligned(ArenaAlignDefault::Ceil(n), align, parent);
+      AddCleanup(ret, destructor, parent);
+      return ret;
+    }
+    auto* node = static_cast<AdjacentNode*>(
+        AllocateAligned(sizeof(AdjacentNode) + ArenaAlignDefault::Ceil(n),
+                        ArenaAlignDefault::align, parent));
+    node->destructor = destructor;
+    Push(node, kAdjacent);
+    return node + 1;
+  }
+
+  void AddCleanup(void* elem, void (*destructor)(void*),
+                  ThreadSafeArena& parent) {
+    auto* node = static_cast<ExternalNode*>(AllocateAligned(
+        sizeof(ExternalNode), ArenaAlignDefault::align, parent));
+    node->destructor = destructor;
+    node->elem = elem;
+    Push(node, kExternal);
+  }
+
+  // Strings don't store their destructor: only the list link precedes them.
+  void* AllocateString(ThreadSafeArena& parent) {
+    static_assert(alignof(std::string) <= ArenaAlignDefault::align, "");
+    auto* node = static_cast<CleanupNode*>(
+        AllocateAligned(sizeof(CleanupNode) + sizeof(std::string),
+                        ArenaAlignDefault::align, parent));
+    Push(node, kString);
+    return node + 1;
+  }
+
+  // Runs the cleanups, the most recently added first.
+  void CleanupList() {
+    uintptr_t tagged = cleanup_.exchange(0, std::memory_order_acquire);
+    while (tagged != 0) {
+      CleanupNode* node = Untag(tagged);
+      const uintptr_t next = node->next;
+      switch (GetKind(tagged)) {
+        case kString:
+          static_cast<std::string*>(Elem(node, kString))->~basic_string();
+          break;
+        case kAdjacent:
+          static_cast<AdjacentNode*>(node)->destructor(Elem(node, kAdjacent));
+          break;
+        case kExternal:
+          static_cast<ExternalNode*>(node)->destructor(Elem(node, kExternal));
+          break;
+      }
+      tagged = next;
+    }
+  }
+
+  std::vector<void*> PeekCleanupListForTesting() const {
+    std::vector<void*> ret;
+    for (uintptr_t tagged = cleanup_.load(std::memory_order_acquire);
+         tagged != 0; tagged = Untag(tagged)->next) {
+      ret.push_back(Elem(Untag(tagged), GetKind(tagged)));
+    }
+    return ret;
+  }
+
+ private:
+  // Cleanups form a lock-free list. Each link is a pointer to the next node
+  // tagged in its low bits with the node's kind.
+  enum Kind : uintptr_t {
+    kString,    // A CleanupNode followed by the std::string.
+    kAdjacent,  // An AdjacentNode followed by the object.
+    kExternal,  // An ExternalNode pointing to the object.
+  };
+  static constexpr uintptr_t kKindMask = 3;
+
+  struct CleanupNode {
+    uintptr_t next;
+  };
+  struct AdjacentNode : CleanupNode {
+    void (*destructor)(void*);
+  };
+  struct ExternalNode : AdjacentNode {
+    void* elem;
+  };
+
+  static CleanupNode* Untag(uintptr_t tagged) {
+    return reinterpret_cast<CleanupNode*>(tagged & ~kKindMask);
+  }
+  static Kind GetKind(uintptr_t tagged) {
+    return static_cast<Kind>(tagged & kKindMask);
+  }
+  static void* Elem(CleanupNode* node, Kind kind) {
+    switch (kind) {
+      case kString:
+        return node + 1;
+      case kAdjacent:
+        return static_cast<AdjacentNode*>(node) + 1;
+      case kExternal:
+        return static_cast<ExternalNode*>(node)->elem;
+    }
+    return nullptr;
+  }
+
+  void Push(CleanupNode* node, Kind kind) {
+    const uintptr_t tagged = reinterpret_cast<uintptr_t>(node) | kind;
+    node->next = cleanup_.load(std::memory_order_relaxed);
+    while (!cleanup_.compare_exchange_weak(node->next, tagged,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+    }
+  }
+
+  // Allocates from the current block, or returns nullptr if it is full or
+  // being replaced.
+  void* TryAllocateAligned(size_t n, size_t align) {
+    SerialArena* serial = serial_.load(std::memory_order_acquire);
+    if (PROTOBUF_PREDICT_FALSE(serial == nullptr)) return nullptr;
+    // `limit_` is loaded after `ptr_`, so a position in a new block is never
+    // checked against the limit of the block it replaced. A position in a
+    // replaced block may be checked against a newer limit, but then the
+    // compare-and-swap fails.
+    char* ptr = serial->ptr_.load(std::memory_order_acquire);
+    while (true) {
+      char* limit = limit_.load(std::memory_order_acquire);
+      char* ret = static_cast<char*>(SerialArena::AlignTo(ptr, align));
+      // See the comment in SerialArena::MaybeAllocateAligned re uintptr_t.
+      if (reinterpret_cast<uintptr_t>(ret) + n >
+          reinterpret_cast<uintptr_t>(limit)) {
+        return nullptr;
+      }
+      if (serial->ptr_.compare_exchange_weak(ptr, ret + n,
+                                             std::memory_order_relaxed,
+                                             std::memory_order_acquire)) {
+        PROTOBUF_UNPOISON_MEMORY_REGION(ret, n);
+        return ret;
+      }
+    }
+  }
+
+  void* AllocateAlignedFallback(size_t n, size_t align,
+                                ThreadSafeArena& parent);
+
+  std::atomic<SerialArena*> serial_{nullptr};
+  // The limit of the current block of `serial_`, or nullptr while it is being
+  // replaced.
+  std::atomic<char*> limit_{nullptr};
+  std::atomic<uintptr_t> cleanup_{0};
+  absl::Mutex mu_;
+};
+
+PROTOBUF_NOINLINE
+void* ThreadSafeArena::SharedSerialArena::AllocateAlignedFallback(
+    size_t n, size_t align, ThreadSafeArena& parent) {
+  absl::MutexLock lock(&mu_);
+  // Another thread may have added a block while this one was waiting.
+  if (void* ret = TryAllocateAligned(n, align)) return ret;
+
+  const size_t required = SerialArena::AlignUpTo(n, align);
+  SerialArena* serial = serial_.load(std::memory_order_relaxed);
+  if (serial == nullptr) {
+    serial = SerialArena::New(
+        AllocateBlock(parent.AllocPolicy(), 0, required + kSerialArenaSize),
+        parent);
+    // The address of a SharedSerialArena never collides with a thread id.
+    parent.AddSerialArena(this, serial);
+    serial_.store(serial, std::memory_order_release);
+  } else {
+    // Retire the current block. Clearing the limit sends the other threads
+    // here, and the fence orders that before the new block is published. The
+    // exchange makes every compare-and-swap still in flight against the old
+    // block fail, and tells how much of it was used: AllocateNewBlock() counts
+    // the whole block, so take the unused tail back off.
+    limit_.store(nullptr, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    char* end =
+        serial->ptr_.exchange(serial->limit_, std::memory_order_acq_rel);
+    serial->AddSpaceUsed(end - serial->limit_);
+    serial->AllocateNewBlock(required);
+  }
+  // Allocate before publishing the limit: once it is, the other threads may
+  // fill the block before this one gets to it.
+  char* ptr = serial->ptr_.load(std::memory_order_relaxed);
+  char* ret = static_cast<char*>(SerialArena::AlignTo(ptr, align));
+  ABSL_DCHECK_LE(ret + n, serial->limit_);
+  serial->ptr_.store(ret + n, std::memory_order_relaxed);
+  limit_.store(serial->limit_, std::memory_order_release);
+  PROTOBUF_UNPOISON_MEMORY_REGION(ret, n);
+  return ret;
+}
+
+// The SharedSerialArenas of an arena created with
+// AllocationPolicy::max_thread_arenas. Each thread other than the creator is
+// bound to one of them, round-robin, the first time it allocates from the
+// arena, and keeps it in its ThreadCache until it allocates from another arena.
+class ThreadSafeArena::SharedSerialArenas {
+ public:
+  explicit SharedSerialArenas(size_t size)
+      : id_(GetNextLifeCycleId()),
+        size_(size),
+        arenas_(new SharedSerialArena[size]) {}
+
+  // Stored in ThreadCache::last_lifecycle_id_seen by the threads bound to one
+  // of these SharedSerialArenas. It comes from the same sequence as arena ids,
+  // so GetSerialArenaFast() never matches it.
+  uint64_t id() const { return id_; }
+
+  SharedSerialArena* Next() {
+    return &arenas_[next_.fetch_add(1, std::memory_order_relaxed) % size_];
+  }
+
+  void CleanupList() {
+    for (size_t i = 0; i < size_; ++i) arenas_[i].CleanupList();
+  }
+
+ private:
+  const uint64_t id_;
+  const size_t size_;
+  std::atomic<size_t> next_{0};
+  std::unique_ptr<SharedSerialArena[]> arenas_;
+};
 
 alignas(kCacheAlignment) ABSL_CONST_INIT
     std::atomic<ThreadSafeArena::LifecycleId> ThreadSafeArena::lifecycle_id_{0};
@@ -595,7 +928,13 @@ ArenaBlock* ThreadSafeArena::FirstBlock(void* buf, size_t size,
 
   SizedPtr mem;
   if (buf == nullptr || size < kBlockHeaderSize + kAllocPolicySize) {
-    mem = AllocateBlock(&policy, 0, kAllocPolicySize);
+    if (policy.first_block_size > 0) {
+      mem = AllocateMemory(policy,
+                           std::max(policy.first_block_size,
+                                    kBlockHeaderSize + kAllocPolicySize));
+    } else {
+      mem = AllocateBlock(&policy, 0, kAllocPolicySize);
+    }
   } else {
     mem = {buf, size};
     // Record user-owned block.
@@ -733,12 +1072,22 @@ void ThreadSafeArena::Init() {
   CacheSerialArena(&first_arena_);
 }
 
+void ThreadSafeArena::RecordSizeHint() const {
+  const AllocationPolicy* policy = alloc_policy_.get();
+  if (policy != nullptr && policy->size_hint != nullptr) {
+    policy->size_hint->Record(SpaceUsed());
+  }
+}
+
 ThreadSafeArena::~ThreadSafeArena() {
+  RecordSizeHint();
+
   // Have to do this in a first pass, because some of the destructors might
   // refer to memory in other blocks.
   CleanupList();
 
   auto mem = Free();
+  DeleteSharedSerialArenas();
   if (alloc_policy_.is_user_owned_initial_block()) {
     // Unpoison the initial block, now that it's going back to the user.
     PROTOBUF_UNPOISON_MEMORY_REGION(mem.p, mem.n);
@@ -775,6 +1124,7 @@ SizedPtr ThreadSafeArena::Free() {
 
 uint64_t ThreadSafeArena::Reset() {
   const size_t space_allocated = SpaceAllocated();
+  RecordSizeHint();
 
   // Have to do this in a first pass, because some of the destructors might
   // refer to memory in other blocks.
@@ -785,6 +1135,7 @@ uint64_t ThreadSafeArena::Reset() {
   // Discard all blocks except the first one. Whether it is user-provided or
   // allocated, always reuse the first block for the first arena.
   auto mem = Free();
+  DeleteSharedSerialArenas();
 
   // Reset the first arena with the first block. This avoids redundant
   // free / allocation and re-allocating for AllocationPolicy. Adjust offset if
@@ -817,12 +1168,82 @@ void* ThreadSafeArena::AllocateAlignedWithCleanup(size_t n, size_t align,
 }
 
 void ThreadSafeArena::AddCleanup(void* elem, void (*cleanup)(void*)) {
-  GetSerialArena()->AddCleanup(elem, cleanup);
+  SerialArena* arena;
+  if (PROTOBUF_PREDICT_TRUE(GetSerialArenaFast(&arena))) {
+    arena->AddCleanup(elem, cleanup);
+    return;
+  }
+  if (SharedSerialArena* shared = GetSharedSerialArena()) {
+    shared->AddCleanup(elem, cleanup, *this);
+    return;
+  }
+  GetSerialArenaFallback(kMaxCleanupNodeSize)->AddCleanup(elem, cleanup);
+}
+
+bool ThreadSafeArena::UsesSharedSerialArenas() const {
+  const AllocationPolicy* policy = alloc_policy_.get();
+  return policy != nullptr && policy->max_thread_arenas != 0 &&
+         &thread_cache() != first_owner_;
+}
+
+ThreadSafeArena::SharedSerialArenas* ThreadSafeArena::GetSharedSerialArenas() {
+  SharedSerialArenas* shared = shared_arenas_.load(std::memory_order_acquire);
+  if (PROTOBUF_PREDICT_TRUE(shared != nullptr)) return shared;
+  auto* created = new SharedSerialArenas(alloc_policy_->max_thread_arenas);
+  if (shared_arenas_.compare_exchange_strong(shared, created,
+                                             std::memory_order_acq_rel,
+                                             std::memory_order_acquire)) {
+    return created;
+  }
+  // Another thread won the race.
+  delete created;
+  return shared;
+}
+
+void ThreadSafeArena::DeleteSharedSerialArenas() {
+  // The SerialArenas themselves are owned by the chunk list and freed by
+  // Free().
+  delete shared_arenas_.exchange(nullptr, std::memory_order_relaxed);
+}
+
+ThreadSafeArena::SharedSerialArena* ThreadSafeArena::GetSharedSerialArena() {
+  const AllocationPolicy* policy = alloc_policy_.get();
+  if (PROTOBUF_PREDICT_TRUE(policy == nullptr ||
+                            policy->max_thread_arenas == 0)) {
+    return nullptr;
+  }
+  ThreadCache& tc = thread_cache();
+  if (&tc == first_owner_) return nullptr;
+  SharedSerialArenas* shared = GetSharedSerialArenas();
+  if (PROTOBUF_PREDICT_TRUE(tc.last_lifecycle_id_seen == shared->id())) {
+    return tc.last_shared_arena;
+  }
+  SharedSerialArena* arena = shared->Next();
+  tc.last_lifecycle_id_seen = shared->id();
+  tc.last_shared_arena = arena;
+  return arena;
+}
+
+SerialArenaCheckpoint ThreadSafeArena::Checkpoint() {
+  ABSL_CHECK(!UsesSharedSerialArenas())
+      << "Checkpoints are not supported on threads sharing SerialArenas";
+  SerialArenaCheckpoint checkpoint = GetSerialArena()->Checkpoint();
+  checkpoint.life_cycle_id = tag_and_id_;
+  return checkpoint;
+}
+
+void ThreadSafeArena::RewindTo(const SerialArenaCheckpoint& checkpoint) {
+  ABSL_CHECK_EQ(checkpoint.life_cycle_id, tag_and_id_)
+      << "Checkpoint was taken on another arena or before Reset()";
+  ABSL_CHECK_EQ(checkpoint.serial, GetSerialArena())
+      << "Checkpoint must be rewound on the thread that took it";
+  checkpoint.serial->RewindTo(checkpoint);
 }
 
 SerialArena* ThreadSafeArena::GetSerialArena() {
   SerialArena* arena;
   if (PROTOBUF_PREDICT_FALSE(!GetSerialArenaFast(&arena))) {
+    ABSL_DCHECK(!UsesSharedSerialArenas());
     arena = GetSerialArenaFallback(kMaxCleanupNodeSize);
   }
   return arena;
@@ -831,13 +1252,23 @@ SerialArena* ThreadSafeArena::GetSerialArena() {
 PROTOBUF_NOINLINE
 void* ThreadSafeArena::AllocateAlignedWithCleanupFallback(
     size_t n, size_t align, void (*destructor)(void*)) {
+  if (SharedSerialArena* shared = GetSharedSerialArena()) {
+    return shared->AllocateAlignedWithCleanup(n, align, destructor, *this);
+  }
   return GetSerialArenaFallback(n + kMaxCleanupNodeSize)
       ->AllocateAlignedWithCleanup(n, align, destructor);
 }
 
 PROTOBUF_NOINLINE
 void* ThreadSafeArena::AllocateFromStringBlock() {
-  return GetSerialArena()->AllocateFromStringBlock();
+  SerialArena* arena;
+  if (PROTOBUF_PREDICT_TRUE(GetSerialArenaFast(&arena))) {
+    return arena->AllocateFromStringBlock();
+  }
+  if (SharedSerialArena* shared = GetSharedSerialArena()) {
+    return shared->AllocateString(*this);
+  }
+  return GetSerialArenaFallback(kMaxCleanupNodeSize)->AllocateFromStringBlock();
 }
 
 template <typename Callback>
@@ -906,6 +1337,9 @@ uint64_t ThreadSafeArena::SpaceUsed() const {
 
 template <AllocationClient alloc_client>
 PROTOBUF_NOINLINE void* ThreadSafeArena::AllocateAlignedFallback(size_t n) {
+  if (SharedSerialArena* shared = GetSharedSerialArena()) {
+    return shared->AllocateAligned(n, ArenaAlignDefault::align, *this);
+  }
   return GetSerialArenaFallback(n)->AllocateAligned<alloc_client>(n);
 }
 
@@ -914,11 +1348,26 @@ template void* ThreadSafeArena::AllocateAlignedFallback<
 template void*
     ThreadSafeArena::AllocateAlignedFallback<AllocationClient::kArray>(size_t);
 
+std::vector<void*> ThreadSafeArena::PeekCleanupListForTesting() {
+  SerialArena* arena;
+  if (GetSerialArenaFast(&arena)) return arena->PeekCleanupListForTesting();
+  if (SharedSerialArena* shared = GetSharedSerialArena()) {
+    return shared->PeekCleanupListForTesting();
+  }
+  return GetSerialArenaFallback(kMaxCleanupNodeSize)
+      ->PeekCleanupListForTesting();
+}
+
 void ThreadSafeArena::CleanupList() {
 #ifdef PROTOBUF_ASAN
   UnpoisonAllArenaBlocks();
 #endif
 
+  if (SharedSerialArenas* shared =
+          shared_arenas_.load(std::memory_order_relaxed)) {
+    shared->CleanupList();
+  }
+
   WalkSerialArenaChunk([](SerialArenaChunk* chunk) {
     absl::Span<std::atomic<SerialArena*>> span = chunk->arenas();
     // Walks arenas backward to handle the first serial arena the last.
@@ -971,6 +1420,28 @@ SerialArena* ThreadSafeArena::GetSerialArenaFallback(size_t n) {
 
 }  // namespace internal
 
+void ArenaSizeHint::Record(uint64_t space_used) {
+  // Follow growth right away but decay slowly (by 1/8 of the difference per
+  // record) on shrinking. Races between concurrent records are benign: one of
+  // the values wins and the hint stays approximately right.
+  uint64_t expected = expected_space_used_.load(std::memory_order_relaxed);
+  if (space_used < expected) {
+    space_used = expected - (expected - space_used) / 8;
+  }
+  expected_space_used_.store(space_used, std::memory_order_relaxed);
+}
+
+size_t ArenaSizeHint::FirstBlockSize(size_t start_block_size) const {
+  const uint64_t expected = expected_space_used();
+  if (expected == 0) return start_block_size;
+  // The first block also holds the block header and the AllocationPolicy.
+  constexpr size_t kOverhead = internal::ThreadSafeArena::kBlockHeaderSize +
+                               internal::ThreadSafeArena::kAllocPolicySize;
+  const uint64_t wanted = std::min<uint64_t>(expected + kOverhead,
+                                             kMaxStartBlockSize);
+  return std::max(start_block_size, static_cast<size_t>(wanted));
+}
+
 void* Arena::Allocate(size_t n) { return impl_.AllocateAligned(n); }
 
 void* Arena::AllocateForArray(size_t n) {
@@ -10,6 +10,7 @@
 #ifndef GOOGLE_PROTOBUF_ARENA_H__
 #define GOOGLE_PROTOBUF_ARENA_H__
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <limits>
@@ -89,6 +90,61 @@ void arena_delete_object(void* object) {
 }
 }  // namespace internal
 
+// ArenaSizeHint remembers how much memory the arenas created at one call site
+// ended up using, so that later arenas from the same call site can allocate a
+// first block of the right size up front instead of growing through a chain of
+// small blocks. It is usually a static next to the code creating the arenas:
+//
+//   static ArenaSizeHint hint;
+//   ArenaOptions options;
+//   options.size_hint = &hint;
+//   Arena arena(options);
+//
+// An arena reports its SpaceUsed() to the hint on Reset() and on destruction.
+// Growth is followed immediately while shrinking decays slowly, so occasional
+// small requests do not undo the sizing for large ones.
+//
+// All member functions are thread-safe. The hint must outlive every arena that
+// refers to it.
+class PROTOBUF_EXPORT ArenaSizeHint {
+ public:
+  // Upper bound for the first block size derived from a hint.
+  static constexpr size_t kMaxStartBlockSize = size_t{16} << 20;
+
+  constexpr ArenaSizeHint() = default;
+  ArenaSizeHint(const ArenaSizeHint&) = delete;
+  ArenaSizeHint& operator=(const ArenaSizeHint&) = delete;
+
+  // Returns the space used the next arena is expected to need, or 0 if nothing
+  // has been recorded yet.
+  uint64_t expected_space_used() const {
+    return expected_space_used_.load(std::memory_order_relaxed);
+  }
+
+  // Records the space used by an arena at the end of its lifetime.
+  void Record(uint64_t space_used);
+
+  // Returns the size of the first block for a new arena whose configured start
+  // block size is `start_block_size`.
+  size_t FirstBlockSize(size_t start_block_size) const;
+
+ private:
+  std::atomic<uint64_t> expected_space_used_{0};
+};
+
+// Saved allocation state of an arena, returned by Arena::Checkpoint() and
+// consumed by Arena::RewindTo(). Only valid for the arena and the thread that
+// created it, and only until that arena is rewound past it, Reset() or
+// destroyed.
+class ArenaCheckpoint {
+ private:
+  friend class Arena;
+  explicit ArenaCheckpoint(const internal::SerialArenaCheckpoint& state)
+      : state_(state) {}
+
+  internal::SerialArenaCheckpoint state_;
+};
+
 // ArenaOptions provides optional additional parameters to arena construction
 // that control its block-allocation behavior.
 struct ArenaOptions {
@@ -122,6 +178,31 @@ struct ArenaOptions {
   // calls free.
   void (*block_dealloc)(void*, size_t) = nullptr;
 
+  // If true, blocks are recycled through a process-wide, per-thread cache
+  // instead of being returned to the system allocator when the arena is reset
+  // or destroyed, and new blocks are taken from that cache when possible. This
+  // is useful when many short-lived arenas are created, e.g. one per request.
+  // See `internal::ArenaBlockCache` for limits and statistics.
+  //
+  // Ignored if either `block_alloc` or `block_dealloc` is set.
+  bool recycle_blocks = false;
+
+  // If set, the size of the arena's first block is derived from the space used
+  // by earlier arenas sharing the same hint, and this arena reports its own
+  // usage back to it. See ArenaSizeHint above. `start_block_size` serves as a
+  // lower bound, and remains the size of the first block of every other
+  // thread's sub-arena.
+  ArenaSizeHint* size_hint = nullptr;
+
+  // By default every thread allocating from the arena gets its own sub-arena
+  // with its own partially used blocks. If non-zero, threads other than the one
+  // creating the arena instead share at most this many sub-arenas: each thread
+  // is bound to one of them on its first allocation and bumps its pointer with
+  // an atomic compare-and-swap, taking a lock only to add a block. This bounds
+  // memory waste when a large pool of threads fills one arena, at the cost of
+  // contention on the shared pointers.
+  size_t max_thread_arenas = 0;
+
  private:
   internal::AllocationPolicy AllocationPolicy() const {
     internal::AllocationPolicy res;
@@ -129,6 +210,12 @@ struct ArenaOptions {
     res.max_block_size = max_block_size;
     res.block_alloc = block_alloc;
     res.block_dealloc = block_dealloc;
+    res.recycle_blocks = recycle_blocks;
+    res.size_hint = size_hint;
+    if (size_hint != nullptr) {
+      res.first_block_size = size_hint->FirstBlockSize(start_block_size);
+    }
+    res.max_thread_arenas = max_thread_arenas;
     return res;
   }
 
@@ -302,6 +389,30 @@ class PROTOBUF_EXPORT PROTOBUF_ALIGNAS(8) Arena final {
   // of the allocated blocks. This method is not thread-safe.
   uint64_t Reset() { return impl_.Reset(); }
 
+  // Checkpoint() and RewindTo() give scratch allocations a cheaper lifetime
+  // than a second arena:
+  //
+  //   ArenaCheckpoint checkpoint = arena.Checkpoint();
+  //   auto* scratch = Arena::Create<MyMessage>(&arena);
+  //   ...
+  //   arena.RewindTo(checkpoint);  // `scratch` is gone, its memory is reused.
+  //
+  // RewindTo() runs the destructors registered since the checkpoint (Own(),
+  // OwnDestructor(), OwnCustomDestructor() and arena strings), frees the blocks
+  // allocated since and resets the bump pointer, so later allocations reuse the
+  // same memory.
+  //
+  // Only the allocations made by the calling thread are rolled back, and
+  // RewindTo() must be called on the thread that took the checkpoint. Every
+  // object allocated after the checkpoint becomes invalid, including memory
+  // acquired by older objects, e.g. when a repeated field created before the
+  // checkpoint grows after it. Checkpoints can be nested; rewinding to an outer
+  // one invalidates the inner ones. These methods are not thread-safe.
+  ArenaCheckpoint Checkpoint() { return ArenaCheckpoint(impl_.Checkpoint()); }
+  void RewindTo(const ArenaCheckpoint& checkpoint) {
+    impl_.RewindTo(checkpoint.state_);
+  }
+
   // Adds |object| to a list of heap-allocated objects to be freed with |delete|
   // when the arena is destroyed or reset.
   template <typename T>
@@ -13,6 +13,9 @@
 
 namespace google {
 namespace protobuf {
+
+class ArenaSizeHint;  // defined in arena.h
+
 namespace internal {
 
 // `AllocationPolicy` defines `Arena` allocation policies. Applications can
@@ -30,10 +33,33 @@ struct AllocationPolicy {
   void* (*block_alloc)(size_t) = nullptr;
   void (*block_dealloc)(void*, size_t) = nullptr;
 
+  // If true, blocks are obtained from and returned to `ArenaBlockCache`.
+  // Only honored when neither `block_alloc` nor `block_dealloc` is set.
+  bool recycle_blocks = false;
+
+  // If set, the arena reports its space used to `size_hint` on Reset() and
+  // destruction. `first_block_size` has already been derived from it.
+  ArenaSizeHint* size_hint = nullptr;
+
+  // If non-zero, the size of the arena's first block. Only that block uses it:
+  // the blocks of other threads' SerialArenas still start at
+  // `start_block_size`.
+  size_t first_block_size = 0;
+
+  // If non-zero, threads other than the one creating the arena share this many
+  // SerialArenas instead of getting one each.
+  size_t max_thread_arenas = 0;
+
   bool IsDefault() const {
     return start_block_size == kDefaultStartBlockSize &&
            max_block_size == kDefaultMaxBlockSize && block_alloc == nullptr &&
-           block_dealloc == nullptr;
+           block_dealloc == nullptr && !recycle_blocks &&
+           size_hint == nullptr && first_block_size == 0 &&
+           max_thread_arenas == 0;
+  }
+
+  bool UsesBlockCache() const {
+    return recycle_blocks && block_alloc == nullptr && block_dealloc == nullptr;
   }
 };
 
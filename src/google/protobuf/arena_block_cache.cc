@@ -0,0 +1,184 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/arena_block_cache.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#include "absl/numeric/bits.h"
+#include "google/protobuf/port.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace internal {
+namespace {
+
+// log2 of the smallest and largest cacheable block sizes.
+constexpr size_t kMinBin = 6;
+constexpr size_t kMaxBin = 20;
+constexpr size_t kNumBins = kMaxBin - kMinBin + 1;
+static_assert(size_t{1} << kMinBin == ArenaBlockCache::kMinBlockSize, "");
+static_assert(size_t{1} << kMaxBin == ArenaBlockCache::kMaxBlockSize, "");
+
+std::atomic<size_t> max_cached_bytes_per_thread{
+    ArenaBlockCache::kDefaultMaxCachedBytesPerThread};
+
+// Header written into every cached block. Bin `i` holds blocks whose size is in
+// [2^(kMinBin + i), 2^(kMinBin + i + 1)), so the exact size must be kept.
+struct CachedBlock {
+  CachedBlock* next;
+  size_t size;
+};
+static_assert(sizeof(CachedBlock) <= ArenaBlockCache::kMinBlockSize, "");
+
+#if !defined(PROTOBUF_NO_THREADLOCAL)
+
+// Must be trivially destructible so that it stays usable after the reaper below
+// has run, e.g. when an arena owned by another thread_local object is destroyed
+// late during thread exit.
+struct ThreadBlockCache {
+  CachedBlock* bins[kNumBins];
+  ArenaBlockCache::Stats stats;
+  bool reaper_registered;
+  bool exiting;
+};
+
+PROTOBUF_CONSTINIT PROTOBUF_THREAD_LOCAL ThreadBlockCache thread_block_cache{};
+
+void DrainThreadBlockCache(ThreadBlockCache& cache) {
+  for (CachedBlock*& head : cache.bins) {
+    while (head != nullptr) {
+      CachedBlock* block = head;
+      PROTOBUF_UNPOISON_MEMORY_REGION(block, sizeof(CachedBlock));
+      PROTOBUF_UNPOISON_MEMORY_REGION(block, block->size);
+      head = block->next;
+      internal::SizedDelete(block, block->size);
+    }
+  }
+  cache.stats.cached_bytes = 0;
+}
+
+// Frees the cached blocks of a thread when it exits. Registered lazily on the
+// first block put into the cache.
+struct ThreadBlockCacheReaper {
+  ~ThreadBlockCacheReaper() {
+    DrainThreadBlockCache(thread_block_cache);
+    thread_block_cache.exiting = true;
+  }
+};
+
+// Pops the head of `bin` if it holds at least `size` bytes.
+CachedBlock* PopIfFits(ThreadBlockCache& cache, size_t bin, size_t size) {
+  CachedBlock*& head = cache.bins[bin - kMinBin];
+  CachedBlock* block = head;
+  if (block == nullptr) return nullptr;
+  PROTOBUF_UNPOISON_MEMORY_REGION(block, sizeof(CachedBlock));
+  if (block->size < size) {
+    PROTOBUF_POISON_MEMORY_REGION(block, sizeof(CachedBlock));
+    return nullptr;
+  }
+  head = block->next;
+  return block;
+}
+
+void RegisterReaper(ThreadBlockCache& cache) {
+  static thread_local ThreadBlockCacheReaper reaper;
+  (void)reaper;
+  cache.reaper_registered = true;
+}
+
+#endif  // !PROTOBUF_NO_THREADLOCAL
+
+}  // namespace
+
+SizedPtr ArenaBlockCache::Allocate(size_t size) {
+#if !defined(PROTOBUF_NO_THREADLOCAL)
+  ThreadBlockCache& cache = thread_block_cache;
+  if (PROTOBUF_PREDICT_TRUE(size <= kMaxBlockSize)) {
+    size_t bin = size <= kMinBlockSize
+                     ? kMinBin
+                     : static_cast<size_t>(absl::bit_width(size)) - 1;
+    // Arenas tend to request the same sequence of sizes over and over, so try
+    // the size class of `size` itself first. Every block in the next class up
+    // is large enough.
+    CachedBlock* block = PopIfFits(cache, bin, size);
+    if (block == nullptr && bin < kMaxBin) {
+      block = PopIfFits(cache, bin + 1, size);
+    }
+    if (block != nullptr) {
+      SizedPtr res = {block, block->size};
+      PROTOBUF_UNPOISON_MEMORY_REGION(res.p, res.n);
+      cache.stats.cached_bytes -= res.n;
+      ++cache.stats.hits;
+      return res;
+    }
+  }
+  ++cache.stats.misses;
+#endif  // !PROTOBUF_NO_THREADLOCAL
+  return AllocateAtLeast(size);
+}
+
+void ArenaBlockCache::Deallocate(void* p, size_t size) {
+#if !defined(PROTOBUF_NO_THREADLOCAL)
+  ThreadBlockCache& cache = thread_block_cache;
+  if (size >= kMinBlockSize && size < 2 * kMaxBlockSize && !cache.exiting &&
+      cache.stats.cached_bytes + size <=
+          max_cached_bytes_per_thread.load(std::memory_order_relaxed)) {
+    if (PROTOBUF_PREDICT_FALSE(!cache.reaper_registered)) {
+      RegisterReaper(cache);
+    }
+    // Bin by the largest power of two that does not exceed `size`.
+    size_t bin = static_cast<size_t>(absl::bit_width(size)) - 1;
+    CachedBlock*& head = cache.bins[bin - kMinBin];
+    head = new (p) CachedBlock{head, size};
+    PROTOBUF_POISON_MEMORY_REGION(head, size);
+    cache.stats.cached_bytes += size;
+    if (cache.stats.cached_bytes > cache.stats.peak_cached_bytes) {
+      cache.stats.peak_cached_bytes = cache.stats.cached_bytes;
+    }
+    ++cache.stats.returns;
+    return;
+  }
+  ++cache.stats.evictions;
+#endif  // !PROTOBUF_NO_THREADLOCAL
+  internal::SizedDelete(p, size);
+}
+
+void ArenaBlockCache::SetMaxCachedBytesPerThread(size_t bytes) {
+  max_cached_bytes_per_thread.store(bytes, std::memory_order_relaxed);
+}
+
+size_t ArenaBlockCache::GetMaxCachedBytesPerThread() {
+  return max_cached_bytes_per_thread.load(std::memory_order_relaxed);
+}
+
+void ArenaBlockCache::ReleaseThreadCache() {
+#if !defined(PROTOBUF_NO_THREADLOCAL)
+  DrainThreadBlockCache(thread_block_cache);
+  thread_block_cache.stats.peak_cached_bytes = 0;
+#endif  // !PROTOBUF_NO_THREADLOCAL
+}
+
+ArenaBlockCache::Stats ArenaBlockCache::GetThreadStats() {
+#if !defined(PROTOBUF_NO_THREADLOCAL)
+  return thread_block_cache.stats;
+#else
+  return {};
+#endif  // !PROTOBUF_NO_THREADLOCAL
+}
+
+}  // namespace internal
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
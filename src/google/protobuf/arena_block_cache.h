@@ -0,0 +1,93 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// This file defines the internal class ArenaBlockCache
+
+#ifndef GOOGLE_PROTOBUF_ARENA_BLOCK_CACHE_H__
+#define GOOGLE_PROTOBUF_ARENA_BLOCK_CACHE_H__
+
+#include <cstddef>
+#include <cstdint>
+
+#include "google/protobuf/port.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace internal {
+
+// `ArenaBlockCache` is a process-wide recycler for arena blocks. Each thread
+// owns a small cache of freed blocks, binned by power-of-two size classes.
+// Arenas created with `ArenaOptions::recycle_blocks` return their blocks here
+// on destruction or `Reset()` and pull new blocks from here before falling back
+// to the system allocator. For the common "one arena per request" pattern this
+// brings malloc/free traffic on the request path close to zero once the cache
+// is warm.
+//
+// Blocks may be released on a different thread than the one that allocated
+// them; they simply land in the releasing thread's cache. The amount of memory
+// each thread may hold is bounded by `SetMaxCachedBytesPerThread()`, and
+// anything cached by a thread is freed when that thread exits.
+//
+// All functions are thread-safe: they only ever touch the calling thread's
+// cache (or a relaxed atomic for the global limit).
+class PROTOBUF_EXPORT ArenaBlockCache {
+ public:
+  // Statistics for the calling thread's cache.
+  struct Stats {
+    // Number of block requests served from the cache.
+    uint64_t hits = 0;
+    // Number of block requests that went to the system allocator.
+    uint64_t misses = 0;
+    // Number of blocks put back into the cache.
+    uint64_t returns = 0;
+    // Number of blocks released to the system allocator instead of being
+    // cached, because they were too small, too large or the cache was full.
+    uint64_t evictions = 0;
+    // Bytes currently held by the cache.
+    size_t cached_bytes = 0;
+    // Largest value `cached_bytes` reached since the last
+    // `ReleaseThreadCache()`.
+    size_t peak_cached_bytes = 0;
+  };
+
+  // Blocks outside of [kMinBlockSize, kMaxBlockSize] are never cached.
+  static constexpr size_t kMinBlockSize = 64;
+  static constexpr size_t kMaxBlockSize = size_t{1} << 20;
+  static constexpr size_t kDefaultMaxCachedBytesPerThread = size_t{4} << 20;
+
+  // Returns a block of at least `size` bytes, reusing a cached block when one
+  // of a suitable size class is available.
+  static SizedPtr Allocate(size_t size);
+
+  // Takes ownership of `p`, which must have been returned by `Allocate()` or
+  // `AllocateAtLeast()` with a capacity of `size` bytes.
+  static void Deallocate(void* p, size_t size);
+
+  // Bounds the number of bytes each thread may keep cached. Takes effect on the
+  // next `Deallocate()` of every thread; already cached blocks are kept until
+  // reused or `ReleaseThreadCache()` is called.
+  static void SetMaxCachedBytesPerThread(size_t bytes);
+  static size_t GetMaxCachedBytesPerThread();
+
+  // Frees every block cached by the calling thread and resets its
+  // `peak_cached_bytes`.
+  static void ReleaseThreadCache();
+
+  // Returns the statistics of the calling thread's cache.
+  static Stats GetThreadStats();
+};
+
+}  // namespace internal
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_ARENA_BLOCK_CACHE_H__
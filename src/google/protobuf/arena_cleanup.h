@@ -57,7 +57,16 @@ struct CleanupNode {
 // factors of two up to a limit. Trivially destructible, but Cleanup() must be
 // called before destruction.
 class ChunkList {
+ private:
+  struct Chunk;
+
  public:
+  // A point in the list, see position() and RewindTo().
+  struct Position {
+    Chunk* chunk;
+    CleanupNode* next;
+  };
+
   PROTOBUF_ALWAYS_INLINE void Add(void* elem, void (*destructor)(void*),
                                   SerialArena& arena) {
     if (PROTOBUF_PREDICT_TRUE(next_ < limit_)) {
@@ -71,8 +80,14 @@ class ChunkList {
   // before destruction.
   void Cleanup(const SerialArena& arena);
 
+  // Returns the current end of the list.
+  Position position() const { return {head_, next_}; }
+
+  // Runs the cleanups inserted after `position` in reverse order, frees the
+  // chunks allocated since and makes `position` the end of the list again.
+  void RewindTo(Position position, const SerialArena& arena);
+
  private:
-  struct Chunk;
   friend class internal::SerialArena;
 
   void AddFallback(void* elem, void (*destructor)(void*), SerialArena& arena);
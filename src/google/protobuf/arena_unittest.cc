@@ -30,11 +30,14 @@
 #include "absl/log/absl_log.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/barrier.h"
+#include "absl/synchronization/notification.h"
 #include "absl/utility/utility.h"
+#include "google/protobuf/arena_block_cache.h"
 #include "google/protobuf/arena_cleanup.h"
 #include "google/protobuf/arena_test_util.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/extension_set.h"
+#include "google/protobuf/huge_page_block_allocator.h"
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 #include "google/protobuf/message.h"
@@ -1755,6 +1758,319 @@ TEST(ArenaTest, BlockSizeSmallerThanAllocation) {
   }
 }
 
+TEST(ArenaTest, SizeHintSizesFirstBlock) {
+  ArenaSizeHint hint;
+  ArenaOptions options;
+  options.size_hint = &hint;
+  EXPECT_EQ(hint.FirstBlockSize(options.start_block_size),
+            options.start_block_size);
+
+  constexpr size_t kChunk = 1000;
+  constexpr int kNumChunks = 400;
+  uint64_t first_allocated;
+  {
+    Arena arena(options);
+    for (int i = 0; i < kNumChunks; ++i) {
+      Arena::CreateArray<char>(&arena, kChunk);
+    }
+    first_allocated = arena.SpaceAllocated();
+  }
+  EXPECT_GE(hint.expected_space_used(), kChunk * kNumChunks);
+
+  // The next arena fits all of its allocations into the first block.
+  Arena arena(options);
+  const uint64_t initial = arena.SpaceAllocated();
+  EXPECT_GE(initial, kChunk * kNumChunks);
+  for (int i = 0; i < kNumChunks; ++i) {
+    Arena::CreateArray<char>(&arena, kChunk);
+  }
+  EXPECT_EQ(arena.SpaceAllocated(), initial);
+  EXPECT_LE(arena.SpaceAllocated(), first_allocated);
+}
+
+TEST(ArenaTest, SizeHintOnlySizesFirstBlock) {
+  ArenaSizeHint hint;
+  hint.Record(uint64_t{1} << 20);
+  ArenaOptions options;
+  options.size_hint = &hint;
+  Arena arena(options);
+  const uint64_t initial = arena.SpaceAllocated();
+  EXPECT_GE(initial, uint64_t{1} << 20);
+
+  // Another thread gets a sub-arena of its own, which grows from
+  // start_block_size instead of copying the hinted first block.
+  std::thread thread([&] { Arena::CreateArray<char>(&arena, 100); });
+  thread.join();
+  EXPECT_GT(arena.SpaceAllocated(), initial);
+  EXPECT_LT(arena.SpaceAllocated(), initial + 4096);
+}
+
+TEST(ArenaTest, SizeHintDecaysSlowly) {
+  ArenaSizeHint hint;
+  hint.Record(80000);
+  EXPECT_EQ(hint.expected_space_used(), 80000);
+  hint.Record(160000);
+  EXPECT_EQ(hint.expected_space_used(), 160000);
+  hint.Record(0);
+  EXPECT_EQ(hint.expected_space_used(), 140000);
+  EXPECT_EQ(hint.FirstBlockSize(1 << 30), 1 << 30);
+
+  hint.Record(uint64_t{1} << 40);
+  EXPECT_EQ(hint.FirstBlockSize(256), ArenaSizeHint::kMaxStartBlockSize);
+}
+
+TEST(ArenaTest, SizeHintRecordsOnReset) {
+  ArenaSizeHint hint;
+  ArenaOptions options;
+  options.size_hint = &hint;
+  Arena arena(options);
+  Arena::CreateArray<char>(&arena, 5000);
+  arena.Reset();
+  EXPECT_GE(hint.expected_space_used(), 5000);
+}
+
+TEST(ArenaTest, RecycleBlocksReusesMemory) {
+  using internal::ArenaBlockCache;
+  ArenaBlockCache::ReleaseThreadCache();
+  ArenaOptions options;
+  options.recycle_blocks = true;
+
+  auto run = [&] {
+    Arena arena(options);
+    for (int i = 0; i < 100; ++i) {
+      Arena::CreateArray<char>(&arena, 1000);
+    }
+    return arena.SpaceAllocated();
+  };
+
+  const auto before = ArenaBlockCache::GetThreadStats();
+  const uint64_t first = run();
+  const auto after_first = ArenaBlockCache::GetThreadStats();
+  EXPECT_GT(after_first.misses, before.misses);
+  EXPECT_GT(after_first.returns, before.returns);
+  EXPECT_GT(after_first.cached_bytes, 0);
+
+  // The second arena should be served entirely from the cache.
+  EXPECT_EQ(first, run());
+  const auto after_second = ArenaBlockCache::GetThreadStats();
+  EXPECT_EQ(after_second.misses, after_first.misses);
+  EXPECT_GT(after_second.hits, after_first.hits);
+  EXPECT_EQ(after_second.cached_bytes, after_first.cached_bytes);
+
+  ArenaBlockCache::ReleaseThreadCache();
+  EXPECT_EQ(ArenaBlockCache::GetThreadStats().cached_bytes, 0);
+}
+
+TEST(ArenaTest, RecycleBlocksRespectsLimit) {
+  using internal::ArenaBlockCache;
+  ArenaBlockCache::ReleaseThreadCache();
+  const size_t old_limit = ArenaBlockCache::GetMaxCachedBytesPerThread();
+  ArenaBlockCache::SetMaxCachedBytesPerThread(4096);
+
+  ArenaOptions options;
+  options.recycle_blocks = true;
+  {
+    Arena arena(options);
+    for (int i = 0; i < 1000; ++i) {
+      Arena::CreateArray<char>(&arena, 1000);
+    }
+  }
+  const auto stats = ArenaBlockCache::GetThreadStats();
+  EXPECT_LE(stats.cached_bytes, 4096);
+  EXPECT_LE(stats.peak_cached_bytes, 4096);
+  EXPECT_GT(stats.evictions, 0);
+
+  ArenaBlockCache::SetMaxCachedBytesPerThread(old_limit);
+  ArenaBlockCache::ReleaseThreadCache();
+}
+
+TEST(ArenaTest, RecycleBlocksIgnoredWithCustomAllocator) {
+  using internal::ArenaBlockCache;
+  ArenaBlockCache::ReleaseThreadCache();
+  const auto before = ArenaBlockCache::GetThreadStats();
+  ArenaOptions options;
+  options.recycle_blocks = true;
+  options.block_alloc = &::operator new;
+  options.block_dealloc = [](void* p, size_t) { ::operator delete(p); };
+  {
+    Arena arena(options);
+    Arena::CreateArray<char>(&arena, 1000);
+  }
+  const auto after = ArenaBlockCache::GetThreadStats();
+  EXPECT_EQ(after.misses, before.misses);
+  EXPECT_EQ(after.returns, before.returns);
+}
+
+TEST(ArenaTest, RecycleBlocksAcrossThreads) {
+  using internal::ArenaBlockCache;
+  ArenaOptions options;
+  options.recycle_blocks = true;
+  // Blocks freed on the main thread come from other threads' allocations.
+  Arena arena(options);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&arena] {
+      for (int j = 0; j < 100; ++j) {
+        Arena::CreateArray<char>(&arena, 100);
+      }
+      ArenaBlockCache::ReleaseThreadCache();
+    });
+  }
+  for (auto& t : threads) t.join();
+  arena.Reset();
+  EXPECT_GT(ArenaBlockCache::GetThreadStats().cached_bytes, 0);
+  ArenaBlockCache::ReleaseThreadCache();
+}
+
+TEST(ArenaTest, HugePageBlockAllocator) {
+  using internal::HugePageBlockAllocator;
+  ArenaOptions options;
+  options.block_alloc = &HugePageBlockAllocator::Allocate;
+  options.block_dealloc = &HugePageBlockAllocator::Deallocate;
+  options.max_block_size = 1 << 20;
+
+  for (int round = 0; round < 3; ++round) {
+    Arena arena(options);
+    TestAllTypes* message = Arena::Create<TestAllTypes>(&arena);
+    TestUtil::SetAllFields(message);
+    // Large enough to need a dedicated mapping.
+    char* big = Arena::CreateArray<char>(
+        &arena, HugePageBlockAllocator::kMaxSlabBlockSize * 2);
+    memset(big, 0xaa, HugePageBlockAllocator::kMaxSlabBlockSize * 2);
+    for (int i = 0; i < 1000; ++i) {
+      Arena::CreateArray<char>(&arena, 1000);
+    }
+    TestUtil::ExpectAllFieldsSet(*message);
+  }
+#ifdef __linux__
+  // Slabs are kept for reuse; dedicated mappings are released.
+  EXPECT_GE(HugePageBlockAllocator::BytesMapped(),
+            HugePageBlockAllocator::kSlabSize);
+#endif
+}
+
+struct CountDestructions {
+  explicit CountDestructions(int* count) : count(count) {}
+  ~CountDestructions() { ++*count; }
+  int* count;
+};
+
+TEST(ArenaTest, CheckpointRewindRunsNewerCleanups) {
+  Arena arena;
+  int kept = 0;
+  int scratch = 0;
+  Arena::Create<CountDestructions>(&arena, &kept);
+  std::string* kept_string = Arena::Create<std::string>(&arena, "kept");
+
+  ArenaCheckpoint checkpoint = arena.Checkpoint();
+  const uint64_t space_allocated = arena.SpaceAllocated();
+  for (int i = 0; i < 1000; ++i) {
+    Arena::Create<CountDestructions>(&arena, &scratch);
+    Arena::Create<std::string>(&arena, 100, 'x');
+  }
+  Arena::CreateArray<char>(&arena, 100000);
+  EXPECT_GT(arena.SpaceAllocated(), space_allocated);
+
+  arena.RewindTo(checkpoint);
+  EXPECT_EQ(scratch, 1000);
+  EXPECT_EQ(kept, 0);
+  EXPECT_EQ(*kept_string, "kept");
+  EXPECT_EQ(arena.SpaceAllocated(), space_allocated);
+  EXPECT_EQ(internal::ArenaTestPeer::PeekCleanupListForTesting(&arena).size(),
+            1);
+}
+
+TEST(ArenaTest, CheckpointRewindReusesMemory) {
+  Arena arena;
+  Arena::CreateArray<char>(&arena, 64);
+  ArenaCheckpoint checkpoint = arena.Checkpoint();
+  char* first = Arena::CreateArray<char>(&arena, 64);
+  arena.RewindTo(checkpoint);
+  EXPECT_EQ(Arena::CreateArray<char>(&arena, 64), first);
+
+  // Rewinding to the same checkpoint repeatedly keeps the arena bounded.
+  const uint64_t space_allocated = arena.SpaceAllocated();
+  for (int i = 0; i < 100; ++i) {
+    arena.RewindTo(checkpoint);
+    TestAllTypes* message = Arena::Create<TestAllTypes>(&arena);
+    TestUtil::SetAllFields(message);
+  }
+  arena.RewindTo(checkpoint);
+  EXPECT_EQ(arena.SpaceAllocated(), space_allocated);
+}
+
+TEST(ArenaTest, CheckpointRewindNested) {
+  Arena arena;
+  int outer = 0;
+  int inner = 0;
+  ArenaCheckpoint outer_checkpoint = arena.Checkpoint();
+  Arena::Create<CountDestructions>(&arena, &outer);
+  ArenaCheckpoint inner_checkpoint = arena.Checkpoint();
+  Arena::Create<CountDestructions>(&arena, &inner);
+  arena.RewindTo(inner_checkpoint);
+  EXPECT_EQ(inner, 1);
+  EXPECT_EQ(outer, 0);
+  arena.RewindTo(outer_checkpoint);
+  EXPECT_EQ(outer, 1);
+  EXPECT_EQ(inner, 1);
+}
+
+TEST(ArenaTest, MaxThreadArenasBoundsSerialArenas) {
+  constexpr int kThreads = 16;
+  auto run = [](size_t max_thread_arenas, std::atomic<int>* destroyed) {
+    ArenaOptions options;
+    options.max_thread_arenas = max_thread_arenas;
+    Arena arena(options);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreads; ++i) {
+      threads.emplace_back([&] {
+        for (int j = 0; j < 100; ++j) {
+          TestAllTypes* message = Arena::Create<TestAllTypes>(&arena);
+          TestUtil::SetAllFields(message);
+          TestUtil::ExpectAllFieldsSet(*message);
+          arena.OwnCustomDestructor(destroyed, [](void* p) {
+            static_cast<std::atomic<int>*>(p)->fetch_add(1);
+          });
+        }
+      });
+    }
+    for (auto& t : threads) t.join();
+    return arena.SpaceAllocated();
+  };
+
+  std::atomic<int> destroyed{0};
+  const uint64_t unbounded = run(0, &destroyed);
+  EXPECT_EQ(destroyed.load(), kThreads * 100);
+  destroyed.store(0);
+  const uint64_t bounded = run(2, &destroyed);
+  EXPECT_EQ(destroyed.load(), kThreads * 100);
+  EXPECT_LT(bounded, unbounded);
+}
+
+TEST(ArenaTest, MaxThreadArenasRebindsAfterReset) {
+  ArenaOptions options;
+  options.max_thread_arenas = 1;
+  Arena arena(options);
+  absl::Notification allocated[2], reset;
+  std::thread thread([&] {
+    for (int i = 0; i < 2; ++i) {
+      if (i == 1) reset.WaitForNotification();
+      std::string* s = Arena::Create<std::string>(&arena, 100, 'x');
+      EXPECT_EQ(*s, std::string(100, 'x'));
+      allocated[i].Notify();
+    }
+  });
+  allocated[0].WaitForNotification();
+  EXPECT_GT(arena.SpaceUsed(), sizeof(std::string));
+  // The thread's binding to the SharedSerialArena freed here must not be used
+  // again. The strings' heap buffers are freed by the cleanups.
+  arena.Reset();
+  reset.Notify();
+  allocated[1].WaitForNotification();
+  EXPECT_GT(arena.SpaceUsed(), sizeof(std::string));
+  thread.join();
+}
+
 TEST(ArenaTest, GetArenaShouldReturnTheArenaForArenaAllocatedMessages) {
   Arena arena;
   ArenaMessage* message = Arena::Create<ArenaMessage>(&arena);
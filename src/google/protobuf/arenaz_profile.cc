@@ -0,0 +1,287 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/arenaz_profile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/arenaz_sampler.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "google/protobuf/wire_format_lite.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace internal {
+namespace {
+
+std::string SymbolizeFrame(void* pc, ArenazSymbolizer symbolizer) {
+  char buf[1024];
+  // Use the return address minus one so that the symbol of the call site is
+  // found even when the call is the last instruction of a function.
+  if (symbolizer != nullptr &&
+      symbolizer(static_cast<char*>(pc) - 1, buf, sizeof(buf))) {
+    return buf;
+  }
+  return absl::StrFormat("%p", pc);
+}
+
+uint64_t Scale(uint64_t value, const ArenazProfileEntry& entry) {
+  if (entry.num_sampled_arenas == 0) return value;
+  // Every sampled arena stands for `stride` arenas on average.
+  return static_cast<uint64_t>(static_cast<double>(value) * entry.weight /
+                               entry.num_sampled_arenas);
+}
+
+// Minimal writer for the subset of `perftools.profiles.Profile` we emit.
+// Field numbers are from
+// https://github.com/google/pprof/blob/main/proto/profile.proto.
+class PprofWriter {
+ public:
+  explicit PprofWriter(ArenazSymbolizer symbolizer) : symbolizer_(symbolizer) {
+    Intern("");
+  }
+
+  void AddSampleType(absl::string_view type, absl::string_view unit) {
+    std::string value_type;
+    {
+      io::StringOutputStream stream(&value_type);
+      io::CodedOutputStream out(&stream);
+      WireFormatLite::WriteInt64(1, Intern(type), &out);
+      WireFormatLite::WriteInt64(2, Intern(unit), &out);
+    }
+    messages_.emplace_back(1, std::move(value_type));
+  }
+
+  void SetDefaultSampleType(absl::string_view type) {
+    default_sample_type_ = Intern(type);
+  }
+
+  void AddSample(const std::vector<void*>& stack,
+                 const std::vector<int64_t>& values) {
+    std::string sample;
+    {
+      io::StringOutputStream stream(&sample);
+      io::CodedOutputStream out(&stream);
+      for (void* pc : stack) {
+        WireFormatLite::WriteUInt64(1, LocationId(pc), &out);
+      }
+      for (int64_t value : values) {
+        WireFormatLite::WriteInt64(2, value, &out);
+      }
+    }
+    messages_.emplace_back(2, std::move(sample));
+  }
+
+  std::string Finish() && {
+    std::string res;
+    {
+      io::StringOutputStream stream(&res);
+      io::CodedOutputStream out(&stream);
+      for (const auto& message : messages_) {
+        WireFormatLite::WriteBytes(message.first, message.second, &out);
+      }
+      for (const auto& location : locations_) {
+        WireFormatLite::WriteBytes(4, location, &out);
+      }
+      for (const auto& function : functions_) {
+        WireFormatLite::WriteBytes(5, function, &out);
+      }
+      for (const auto& str : strings_) {
+        WireFormatLite::WriteString(6, str, &out);
+      }
+      if (default_sample_type_ != 0) {
+        WireFormatLite::WriteInt64(14, default_sample_type_, &out);
+      }
+    }
+    return res;
+  }
+
+ private:
+  int64_t Intern(absl::string_view str) {
+    auto it = string_ids_.find(str);
+    if (it != string_ids_.end()) return it->second;
+    strings_.emplace_back(str);
+    int64_t id = static_cast<int64_t>(strings_.size() - 1);
+    string_ids_.emplace(strings_.back(), id);
+    return id;
+  }
+
+  // Adds a Location (and its Function) for `pc` if needed and returns its id.
+  uint64_t LocationId(void* pc) {
+    auto it = location_ids_.find(pc);
+    if (it != location_ids_.end()) return it->second;
+    const uint64_t id = locations_.size() + 1;
+    location_ids_.emplace(pc, id);
+
+    std::string function;
+    {
+      io::StringOutputStream stream(&function);
+      io::CodedOutputStream out(&stream);
+      const int64_t name = Intern(SymbolizeFrame(pc, symbolizer_));
+      WireFormatLite::WriteUInt64(1, id, &out);
+      WireFormatLite::WriteInt64(2, name, &out);
+      WireFormatLite::WriteInt64(3, name, &out);
+    }
+    functions_.push_back(std::move(function));
+
+    std::string line;
+    {
+      io::StringOutputStream stream(&line);
+      io::CodedOutputStream out(&stream);
+      WireFormatLite::WriteUInt64(1, id, &out);
+    }
+    std::string location;
+    {
+      io::StringOutputStream stream(&location);
+      io::CodedOutputStream out(&stream);
+      WireFormatLite::WriteUInt64(1, id, &out);
+      WireFormatLite::WriteUInt64(3, reinterpret_cast<uintptr_t>(pc), &out);
+      WireFormatLite::WriteBytes(4, line, &out);
+    }
+    locations_.push_back(std::move(location));
+    return id;
+  }
+
+  // Sample types and samples, in insertion order, as (field number, bytes).
+  std::vector<std::pair<int, std::string>> messages_;
+  std::vector<std::string> locations_;
+  std::vector<std::string> functions_;
+  ArenazSymbolizer symbolizer_;
+  absl::flat_hash_map<void*, uint64_t> location_ids_;
+  std::vector<std::string> strings_;
+  absl::flat_hash_map<std::string, int64_t> string_ids_;
+  int64_t default_sample_type_ = 0;
+};
+
+}  // namespace
+
+ArenazProfile CollectArenazProfile(ThreadSafeArenazSampler& sampler) {
+  ArenazProfile profile;
+#if defined(PROTOBUF_ARENAZ_SAMPLE)
+  absl::flat_hash_map<std::vector<void*>, size_t> index;
+  sampler.Iterate([&](const ThreadSafeArenaStats& stats) {
+    std::vector<void*> stack(stats.stack, stats.stack + stats.depth);
+    auto inserted = index.try_emplace(stack, profile.entries.size());
+    if (inserted.second) {
+      profile.entries.emplace_back();
+      profile.entries.back().stack = std::move(stack);
+    }
+    ArenazProfileEntry& entry = profile.entries[inserted.first->second];
+    ++entry.num_sampled_arenas;
+    entry.weight += stats.weight;
+    for (const auto& block_stats : stats.block_histogram) {
+      entry.num_blocks +=
+          block_stats.num_allocations.load(std::memory_order_relaxed);
+      entry.bytes_allocated +=
+          block_stats.bytes_allocated.load(std::memory_order_relaxed);
+      entry.bytes_used +=
+          block_stats.bytes_used.load(std::memory_order_relaxed);
+      entry.bytes_wasted +=
+          block_stats.bytes_wasted.load(std::memory_order_relaxed);
+    }
+    entry.max_block_size = std::max<uint64_t>(
+        entry.max_block_size,
+        stats.max_block_size.load(std::memory_order_relaxed));
+    entry.bytes_returned_to_freelists +=
+        stats.bytes_returned_to_freelists.load(std::memory_order_relaxed);
+    entry.string_block_bytes_allocated +=
+        stats.string_block_bytes_allocated.load(std::memory_order_relaxed);
+    entry.string_block_bytes_unused +=
+        stats.string_block_bytes_unused.load(std::memory_order_relaxed);
+  });
+  std::sort(profile.entries.begin(), profile.entries.end(),
+            [](const ArenazProfileEntry& a, const ArenazProfileEntry& b) {
+              return a.bytes_allocated > b.bytes_allocated;
+            });
+#else
+  (void)sampler;
+#endif  // PROTOBUF_ARENAZ_SAMPLE
+  return profile;
+}
+
+ArenazProfile CollectArenazProfile() {
+  return CollectArenazProfile(GlobalThreadSafeArenazSampler());
+}
+
+std::string ArenazProfileToText(const ArenazProfile& profile,
+                                ArenazSymbolizer symbolizer) {
+  std::string res;
+  uint64_t total_allocated = 0;
+  uint64_t total_wasted = 0;
+  for (const auto& entry : profile.entries) {
+    total_allocated += Scale(entry.bytes_allocated, entry);
+    total_wasted += Scale(entry.bytes_wasted, entry);
+  }
+  absl::StrAppend(&res, "Arena memory profile: ", profile.entries.size(),
+                  " allocation sites, ~", total_allocated,
+                  " bytes allocated, ~", total_wasted, " bytes wasted\n");
+  for (const auto& entry : profile.entries) {
+    absl::StrAppend(&res, "\n", entry.num_sampled_arenas,
+                    " sampled arenas (~", entry.weight, " arenas)\n");
+    absl::StrAppendFormat(
+        &res,
+        "  blocks: %d  allocated: %d  used: %d  wasted: %d  max block: %d\n",
+        Scale(entry.num_blocks, entry), Scale(entry.bytes_allocated, entry),
+        Scale(entry.bytes_used, entry), Scale(entry.bytes_wasted, entry),
+        entry.max_block_size);
+    absl::StrAppendFormat(
+        &res,
+        "  returned to array freelists: %d  string blocks allocated: %d  "
+        "string blocks unused: %d\n",
+        Scale(entry.bytes_returned_to_freelists, entry),
+        Scale(entry.string_block_bytes_allocated, entry),
+        Scale(entry.string_block_bytes_unused, entry));
+    for (void* pc : entry.stack) {
+      absl::StrAppendFormat(&res, "    @ %p  %s\n", pc,
+                            SymbolizeFrame(pc, symbolizer));
+    }
+  }
+  return res;
+}
+
+std::string ArenazProfileToPprof(const ArenazProfile& profile,
+                                 ArenazSymbolizer symbolizer) {
+  PprofWriter writer(symbolizer);
+  writer.AddSampleType("arenas", "count");
+  writer.AddSampleType("allocated", "bytes");
+  writer.AddSampleType("used", "bytes");
+  writer.AddSampleType("wasted", "bytes");
+  writer.AddSampleType("freelist", "bytes");
+  writer.AddSampleType("string_block_unused", "bytes");
+  writer.SetDefaultSampleType("allocated");
+  for (const auto& entry : profile.entries) {
+    writer.AddSample(
+        entry.stack,
+        {entry.weight,
+         static_cast<int64_t>(Scale(entry.bytes_allocated, entry)),
+         static_cast<int64_t>(Scale(entry.bytes_used, entry)),
+         static_cast<int64_t>(Scale(entry.bytes_wasted, entry)),
+         static_cast<int64_t>(Scale(entry.bytes_returned_to_freelists, entry)),
+         static_cast<int64_t>(Scale(entry.string_block_bytes_unused, entry))});
+  }
+  return std::move(writer).Finish();
+}
+
+}  // namespace internal
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
@@ -0,0 +1,99 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// Exports the arenas sampled by arenaz_sampler.h as a memory profile.
+//
+// Typical use from a debug or status handler:
+//
+//   internal::ArenazProfile profile = internal::CollectArenazProfile();
+//   std::string report =
+//       internal::ArenazProfileToText(profile, &absl::Symbolize);
+//   std::string pprof = internal::ArenazProfileToPprof(profile);
+//
+// Frames are only named when a symbolizer such as absl::Symbolize is passed,
+// so that libprotobuf itself does not depend on absl/debugging:symbolize.
+//
+// The pprof output is an uncompressed `perftools.profiles.Profile` that can be
+// fed to `pprof` directly. Sampling must be compiled in (PROTOBUF_ARENAZ_SAMPLE)
+// for the profile to contain any data.
+
+#ifndef GOOGLE_PROTOBUF_ARENAZ_PROFILE_H__
+#define GOOGLE_PROTOBUF_ARENAZ_PROFILE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "google/protobuf/arenaz_sampler.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace internal {
+
+// Aggregated statistics of all live sampled arenas created from the same stack.
+struct ArenazProfileEntry {
+  // Stack of the arena construction, innermost frame first.
+  std::vector<void*> stack;
+
+  // Number of sampled arenas and the estimated number of arenas they represent
+  // (the sum of their sampling strides).
+  int64_t num_sampled_arenas = 0;
+  int64_t weight = 0;
+
+  // Block totals, summed over the block histogram.
+  uint64_t num_blocks = 0;
+  uint64_t bytes_allocated = 0;
+  uint64_t bytes_used = 0;
+  uint64_t bytes_wasted = 0;
+  uint64_t max_block_size = 0;
+
+  // See the corresponding fields of ThreadSafeArenaStats.
+  uint64_t bytes_returned_to_freelists = 0;
+  uint64_t string_block_bytes_allocated = 0;
+  uint64_t string_block_bytes_unused = 0;
+};
+
+struct ArenazProfile {
+  // Sorted by decreasing `bytes_allocated`.
+  std::vector<ArenazProfileEntry> entries;
+};
+
+// Snapshots the arenas currently registered with `sampler` and aggregates them
+// by construction stack.
+PROTOBUF_EXPORT ArenazProfile
+CollectArenazProfile(ThreadSafeArenazSampler& sampler);
+
+// Same as above for the global sampler.
+PROTOBUF_EXPORT ArenazProfile CollectArenazProfile();
+
+// Writes the name of the function containing `pc` to `out`, with the signature
+// of absl::Symbolize().  Returns false if no name was found.
+using ArenazSymbolizer = bool (*)(const void* pc, char* out, int out_size);
+
+// Returns a human readable report, one section per stack. Frames are named with
+// `symbolizer` if given, and otherwise printed as addresses. Byte counts are
+// scaled by the sampling weight to estimate totals.
+PROTOBUF_EXPORT std::string ArenazProfileToText(
+    const ArenazProfile& profile, ArenazSymbolizer symbolizer = nullptr);
+
+// Returns `profile` serialized as a pprof `perftools.profiles.Profile`. Values
+// are scaled by the sampling weight. Function names come from `symbolizer` as
+// above; without it pprof shows addresses.
+PROTOBUF_EXPORT std::string ArenazProfileToPprof(
+    const ArenazProfile& profile, ArenazSymbolizer symbolizer = nullptr);
+
+}  // namespace internal
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_ARENAZ_PROFILE_H__
@@ -62,6 +62,9 @@ void ThreadSafeArenaStats::BlockStats::PrepareForSampling() {
 void ThreadSafeArenaStats::PrepareForSampling(int64_t stride) {
   for (auto& blockstats : block_histogram) blockstats.PrepareForSampling();
   max_block_size.store(0, std::memory_order_relaxed);
+  bytes_returned_to_freelists.store(0, std::memory_order_relaxed);
+  string_block_bytes_allocated.store(0, std::memory_order_relaxed);
+  string_block_bytes_unused.store(0, std::memory_order_relaxed);
   thread_ids.store(0, std::memory_order_relaxed);
   weight = stride;
   // The inliner makes hardcoded skip_count difficult (especially when combined
@@ -68,6 +68,14 @@ struct ThreadSafeArenaStats
 
   // Records the largest block allocated for the arena.
   std::atomic<size_t> max_block_size;
+  // Bytes handed back to the arena's array free lists by Repeated*Field when
+  // they grow. This memory can only be reused for arrays, so it is an upper
+  // bound of the memory sitting idle in the free lists.
+  std::atomic<size_t> bytes_returned_to_freelists;
+  // Bytes allocated for string blocks, and the bytes left unused in the last
+  // string block when the arena was reset or destroyed.
+  std::atomic<size_t> string_block_bytes_allocated;
+  std::atomic<size_t> string_block_bytes_unused;
   // Bit `i` is set to 1 indicates that a thread with `tid % 63 = i` accessed
   // the underlying arena.  We use `% 63` as a rudimentary hash to ensure some
   // bit mixing for thread-ids; `% 64` would only grab the low bits and might
@@ -87,6 +95,24 @@ struct ThreadSafeArenaStats
     if (PROTOBUF_PREDICT_TRUE(info == nullptr)) return;
     RecordAllocateSlow(info, used, allocated, wasted);
   }
+  static void RecordReturnArrayMemory(ThreadSafeArenaStats* info,
+                                      size_t size) {
+    if (PROTOBUF_PREDICT_TRUE(info == nullptr)) return;
+    info->bytes_returned_to_freelists.fetch_add(size,
+                                                std::memory_order_relaxed);
+  }
+  static void RecordStringBlockAllocation(ThreadSafeArenaStats* info,
+                                          size_t allocated) {
+    if (PROTOBUF_PREDICT_TRUE(info == nullptr)) return;
+    info->string_block_bytes_allocated.fetch_add(allocated,
+                                                 std::memory_order_relaxed);
+  }
+  static void RecordStringBlockUnused(ThreadSafeArenaStats* info,
+                                      size_t unused) {
+    if (PROTOBUF_PREDICT_TRUE(info == nullptr)) return;
+    info->string_block_bytes_unused.fetch_add(unused,
+                                              std::memory_order_relaxed);
+  }
 
   // Returns the bin for the provided size.
   static size_t FindBin(size_t bytes);
@@ -167,6 +193,12 @@ using SamplingState = int64_t;
 struct ThreadSafeArenaStats {
   static void RecordAllocateStats(ThreadSafeArenaStats*, size_t /*requested*/,
                                   size_t /*allocated*/, size_t /*wasted*/) {}
+  static void RecordReturnArrayMemory(ThreadSafeArenaStats*, size_t /*size*/) {
+  }
+  static void RecordStringBlockAllocation(ThreadSafeArenaStats*,
+                                          size_t /*allocated*/) {}
+  static void RecordStringBlockUnused(ThreadSafeArenaStats*,
+                                      size_t /*unused*/) {}
 };
 
 ThreadSafeArenaStats* SampleSlow(SamplingState& next_sample);
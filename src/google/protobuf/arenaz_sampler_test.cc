@@ -17,6 +17,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include "google/protobuf/arenaz_profile.h"
 
 // Must be included last.
 #include "google/protobuf/port_def.inc"
@@ -592,6 +593,41 @@ TEST(ThreadSafeArenazSamplerTest, UsedAndWasted) {
   });
   SetThreadSafeArenazSampleParameter(oldparam);
 }
+
+TEST(ThreadSafeArenazSamplerTest, Profile) {
+  ThreadSafeArenazSampler sampler;
+  constexpr int64_t kTestStride = 10;
+  auto* info1 = Register(&sampler, 100, kTestStride);
+  auto* info2 = Register(&sampler, 200, kTestStride);
+  auto* info3 = Register(&sampler, 1000, kTestStride);
+  // Pretend the first two arenas were created from the same place.
+  static char site1, site2;
+  info1->depth = info2->depth = info3->depth = 1;
+  info1->stack[0] = info2->stack[0] = &site1;
+  info3->stack[0] = &site2;
+  ThreadSafeArenaStats::RecordReturnArrayMemory(info3, 64);
+  ThreadSafeArenaStats::RecordStringBlockAllocation(info3, 256);
+  ThreadSafeArenaStats::RecordStringBlockUnused(info3, 16);
+
+  ArenazProfile profile = CollectArenazProfile(sampler);
+  ASSERT_EQ(profile.entries.size(), 2);
+  EXPECT_EQ(profile.entries[0].num_sampled_arenas, 1);
+  EXPECT_EQ(profile.entries[0].bytes_allocated, 1000);
+  EXPECT_EQ(profile.entries[0].bytes_returned_to_freelists, 64);
+  EXPECT_EQ(profile.entries[0].string_block_bytes_allocated, 256);
+  EXPECT_EQ(profile.entries[0].string_block_bytes_unused, 16);
+  EXPECT_EQ(profile.entries[1].num_sampled_arenas, 2);
+  EXPECT_EQ(profile.entries[1].weight, 2 * kTestStride);
+  EXPECT_EQ(profile.entries[1].bytes_allocated, 300);
+
+  EXPECT_THAT(ArenazProfileToText(profile),
+              ::testing::HasSubstr("allocated: 10000"));
+  EXPECT_FALSE(ArenazProfileToPprof(profile).empty());
+
+  sampler.Unregister(info1);
+  sampler.Unregister(info2);
+  sampler.Unregister(info3);
+}
 #endif  // defined(PROTOBUF_ARENAZ_SAMPLE)
 
 }  // namespace
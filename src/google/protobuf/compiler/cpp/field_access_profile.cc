@@ -0,0 +1,194 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/compiler/cpp/field_access_profile.h"
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "absl/log/absl_check.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "google/protobuf/compiler/cpp/names.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/descriptor.pb.h"
+#include "google/protobuf/dynamic_message.h"
+#include "google/protobuf/io/tokenizer.h"
+#include "google/protobuf/message.h"
+#include "google/protobuf/text_format.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace compiler {
+namespace cpp {
+namespace {
+
+// The parts of AccessInfo that the generator reads. Profiles are only read in
+// text form, so the field numbers do not matter.
+constexpr absl::string_view kAccessInfoSchema = R"pb(
+  name: "access_info.proto"
+  package: "google.protobuf.compiler"
+  message_type {
+    name: "FieldAccessInfo"
+    field { name: "name" number: 1 label: LABEL_OPTIONAL type: TYPE_STRING }
+    field {
+      name: "getters_count"
+      number: 2
+      label: LABEL_OPTIONAL
+      type: TYPE_UINT64
+    }
+    field {
+      name: "setters_count"
+      number: 3
+      label: LABEL_OPTIONAL
+      type: TYPE_UINT64
+    }
+  }
+  message_type {
+    name: "MessageAccessInfo"
+    field { name: "name" number: 1 label: LABEL_OPTIONAL type: TYPE_STRING }
+    field { name: "count" number: 2 label: LABEL_OPTIONAL type: TYPE_UINT64 }
+    field {
+      name: "field"
+      number: 3
+      label: LABEL_REPEATED
+      type: TYPE_MESSAGE
+      type_name: ".google.protobuf.compiler.FieldAccessInfo"
+    }
+  }
+  message_type {
+    name: "AccessInfo"
+    field {
+      name: "message"
+      number: 1
+      label: LABEL_REPEATED
+      type: TYPE_MESSAGE
+      type_name: ".google.protobuf.compiler.MessageAccessInfo"
+    }
+  }
+)pb";
+
+class ProfileErrorCollector : public io::ErrorCollector {
+ public:
+  void RecordError(int line, io::ColumnNumber column,
+                   absl::string_view message) override {
+    if (!error_.empty()) return;
+    error_ = absl::StrCat("Invalid field access profile at line ", line + 1,
+                          ", column ", column + 1, ": ", message);
+  }
+
+  const std::string& error() const { return error_; }
+
+ private:
+  std::string error_;
+};
+
+}  // namespace
+
+absl::StatusOr<FieldAccessProfile> FieldAccessProfile::Parse(
+    absl::string_view text) {
+  FileDescriptorProto schema;
+  ABSL_CHECK(TextFormat::ParseFromString(kAccessInfoSchema, &schema));
+  DescriptorPool pool;
+  const FileDescriptor* file = pool.BuildFile(schema);
+  ABSL_CHECK(file != nullptr);
+  const Descriptor* access_info_type =
+      file->FindMessageTypeByName("AccessInfo");
+  const Descriptor* message_type =
+      file->FindMessageTypeByName("MessageAccessInfo");
+  const Descriptor* field_type = file->FindMessageTypeByName("FieldAccessInfo");
+
+  DynamicMessageFactory factory(&pool);
+  std::unique_ptr<Message> access_info(
+      factory.GetPrototype(access_info_type)->New());
+  ProfileErrorCollector errors;
+  TextFormat::Parser parser;
+  parser.AllowUnknownField(true);
+  parser.RecordErrorsTo(&errors);
+  if (!parser.ParseFromString(text, access_info.get())) {
+    return absl::InvalidArgumentError(errors.error());
+  }
+
+  const Reflection* reflection = access_info->GetReflection();
+  const FieldDescriptor* messages =
+      access_info_type->FindFieldByName("message");
+  const FieldDescriptor* message_name = message_type->FindFieldByName("name");
+  const FieldDescriptor* count = message_type->FindFieldByName("count");
+  const FieldDescriptor* fields = message_type->FindFieldByName("field");
+  const FieldDescriptor* field_name = field_type->FindFieldByName("name");
+  const FieldDescriptor* getters = field_type->FindFieldByName("getters_count");
+  const FieldDescriptor* setters = field_type->FindFieldByName("setters_count");
+
+  FieldAccessProfile profile;
+  for (int i = 0; i < reflection->FieldSize(*access_info, messages); ++i) {
+    const Message& message =
+        reflection->GetRepeatedMessage(*access_info, messages, i);
+    const Reflection* message_reflection = message.GetReflection();
+    MessageProfile& message_profile =
+        profile.messages_[message_reflection->GetString(message, message_name)];
+    message_profile.count += message_reflection->GetUInt64(message, count);
+    for (int j = 0; j < message_reflection->FieldSize(message, fields); ++j) {
+      const Message& field =
+          message_reflection->GetRepeatedMessage(message, fields, j);
+      const Reflection* field_reflection = field.GetReflection();
+      message_profile.present[field_reflection->GetString(field, field_name)] +=
+          field_reflection->GetUInt64(field, getters) +
+          field_reflection->GetUInt64(field, setters);
+    }
+  }
+  return profile;
+}
+
+absl::StatusOr<FieldAccessProfile> FieldAccessProfile::Load(
+    absl::string_view path) {
+  std::ifstream file{std::string(path)};
+  if (!file) {
+    return absl::NotFoundError(
+        absl::StrCat("Could not open field access profile: ", path));
+  }
+  std::stringstream contents;
+  contents << file.rdbuf();
+  return Parse(contents.str());
+}
+
+const FieldAccessProfile::MessageProfile* FieldAccessProfile::FindMessage(
+    const Descriptor* descriptor) const {
+  // Drop the leading "::".
+  const std::string name = QualifiedClassName(descriptor).substr(2);
+  auto it = messages_.find(name);
+  if (it == messages_.end() || it->second.count == 0) return nullptr;
+  return &it->second;
+}
+
+bool FieldAccessProfile::HasMessage(const Descriptor* descriptor) const {
+  return FindMessage(descriptor) != nullptr;
+}
+
+absl::optional<double> FieldAccessProfile::PresenceRatio(
+    const FieldDescriptor* field) const {
+  const MessageProfile* message = FindMessage(field->containing_type());
+  if (message == nullptr) return absl::nullopt;
+  auto it = message->present.find(field->name());
+  if (it == message->present.end()) return 0.0;
+  return static_cast<double>(it->second) / message->count;
+}
+
+}  // namespace cpp
+}  // namespace compiler
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
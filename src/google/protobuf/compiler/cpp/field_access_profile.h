@@ -0,0 +1,73 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Field access profiles, as written by internal::FieldAccessSampler in
+// google/protobuf/field_access_sampler.h. The generator reads them when
+// invoked with `--cpp_out=field_access_profile=<file>:<dir>` and uses how often
+// each field is present to order presence checks and fast parse table entries.
+// It does not change which fields are split out or which strings are inlined.
+
+#ifndef GOOGLE_PROTOBUF_COMPILER_CPP_FIELD_ACCESS_PROFILE_H__
+#define GOOGLE_PROTOBUF_COMPILER_CPP_FIELD_ACCESS_PROFILE_H__
+
+#include <cstdint>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "google/protobuf/descriptor.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace compiler {
+namespace cpp {
+
+class PROTOC_EXPORT FieldAccessProfile {
+ public:
+  // Parses the text form of an AccessInfo proto, the profile format read by
+  // compiler/cpp/tools/analyze_profile_proto.cc. Messages are named by their
+  // C++ class, and `count` is the number of sampled messages of that type. As
+  // in analyze_profile_proto, the getters_count and setters_count of a field
+  // add up to the number of those messages that had the field set. Other
+  // fields of the profile, such as the usage in configs_count, are ignored.
+  static absl::StatusOr<FieldAccessProfile> Parse(absl::string_view text);
+
+  // Reads and parses the profile at `path`.
+  static absl::StatusOr<FieldAccessProfile> Load(absl::string_view path);
+
+  // Returns true if the profile has sampled messages of this type.
+  bool HasMessage(const Descriptor* descriptor) const;
+
+  // Returns the fraction of the sampled messages of its type that had `field`
+  // set, or nullopt if the profile has no messages of that type.
+  absl::optional<double> PresenceRatio(const FieldDescriptor* field) const;
+
+ private:
+  struct MessageProfile {
+    uint64_t count = 0;
+    absl::flat_hash_map<std::string, uint64_t> present;
+  };
+
+  const MessageProfile* FindMessage(const Descriptor* descriptor) const;
+
+  // Keyed by C++ class name, without the leading "::".
+  absl::flat_hash_map<std::string, MessageProfile> messages_;
+};
+
+}  // namespace cpp
+}  // namespace compiler
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_COMPILER_CPP_FIELD_ACCESS_PROFILE_H__
@@ -0,0 +1,101 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/compiler/cpp/field_access_profile.h"
+
+#include <gtest/gtest.h>
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/optional.h"
+#include "google/protobuf/compiler/cpp/helpers.h"
+#include "google/protobuf/compiler/cpp/options.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/unittest.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace compiler {
+namespace cpp {
+namespace {
+
+using ::protobuf_unittest::ForeignMessage;
+using ::protobuf_unittest::TestAllTypes;
+
+TEST(FieldAccessProfileTest, PresenceRatio) {
+  absl::StatusOr<FieldAccessProfile> profile = FieldAccessProfile::Parse(
+      "# comment\n"
+      "language: \"cpp\"\n"
+      "message {\n"
+      "  name: \"protobuf_unittest::ForeignMessage\"\n"
+      "  count: 200\n"
+      "  field { name: \"c\" getters_count: 190 configs_count: 5000 }\n"
+      "  field { name: \"d\" getters_count: 0 configs_count: 7000 }\n"
+      "}\n");
+  ASSERT_TRUE(profile.ok()) << profile.status();
+
+  const Descriptor* descriptor = ForeignMessage::descriptor();
+  EXPECT_TRUE(profile->HasMessage(descriptor));
+  EXPECT_FALSE(profile->HasMessage(TestAllTypes::descriptor()));
+  EXPECT_EQ(profile->PresenceRatio(descriptor->FindFieldByName("c")), 0.95);
+  EXPECT_EQ(profile->PresenceRatio(descriptor->FindFieldByName("d")), 0.0);
+  EXPECT_EQ(profile->PresenceRatio(TestAllTypes::descriptor()->field(0)),
+            absl::nullopt);
+
+  // Presence, not the number of accessor calls, drives the heuristics.
+  Options options;
+  options.field_access_profile = &*profile;
+  EXPECT_TRUE(IsLikelyPresent(descriptor->FindFieldByName("c"), options));
+  EXPECT_TRUE(IsRarelyPresent(descriptor->FindFieldByName("d"), options));
+  EXPECT_FALSE(IsRarelyPresent(TestAllTypes::descriptor()->field(0), options));
+  EXPECT_EQ(GetPresenceProbability(descriptor->FindFieldByName("c"), options),
+            0.95f);
+  EXPECT_EQ(FindHottestField({descriptor->FindFieldByName("d"),
+                              descriptor->FindFieldByName("c")},
+                             options),
+            descriptor->FindFieldByName("c"));
+}
+
+TEST(FieldAccessProfileTest, DoesNotChangeLayout) {
+  absl::StatusOr<FieldAccessProfile> profile = FieldAccessProfile::Parse(
+      "message {\n"
+      "  name: \"protobuf_unittest::TestAllTypes\"\n"
+      "  count: 100\n"
+      "  field { name: \"optional_string\" getters_count: 95 }\n"
+      "}\n");
+  ASSERT_TRUE(profile.ok()) << profile.status();
+
+  // Splitting and string inlining change the layout of the generated
+  // messages, so a profile alone doesn't enable them.
+  const Descriptor* descriptor = TestAllTypes::descriptor();
+  Options options;
+  options.field_access_profile = &*profile;
+  EXPECT_TRUE(
+      IsLikelyPresent(descriptor->FindFieldByName("optional_string"), options));
+  EXPECT_TRUE(
+      IsRarelyPresent(descriptor->FindFieldByName("optional_bytes"), options));
+  EXPECT_FALSE(IsStringInliningEnabled(options));
+  EXPECT_FALSE(ShouldSplit(descriptor, options));
+  EXPECT_FALSE(
+      ShouldSplit(descriptor->FindFieldByName("optional_bytes"), options));
+  EXPECT_FALSE(
+      IsStringInlined(descriptor->FindFieldByName("optional_string"), options));
+}
+
+TEST(FieldAccessProfileTest, ParseErrors) {
+  EXPECT_EQ(FieldAccessProfile::Parse("message { count: x }\n").status().code(),
+            absl::StatusCode::kInvalidArgument);
+  EXPECT_EQ(FieldAccessProfile::Parse("message foo.Bar 1\n").status().code(),
+            absl::StatusCode::kInvalidArgument);
+  EXPECT_EQ(FieldAccessProfile::Load("/nonexistent/profile").status().code(),
+            absl::StatusCode::kNotFound);
+}
+
+}  // namespace
+}  // namespace cpp
+}  // namespace compiler
+}  // namespace protobuf
+}  // namespace google
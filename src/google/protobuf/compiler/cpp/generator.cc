@@ -22,12 +22,15 @@
 #include "absl/log/absl_check.h"
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/match.h"
 #include "absl/strings/numbers.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "google/protobuf/compiler/code_generator.h"
+#include "google/protobuf/compiler/cpp/field_access_profile.h"
 #include "google/protobuf/compiler/cpp/file.h"
 #include "google/protobuf/compiler/cpp/helpers.h"
 #include "google/protobuf/compiler/cpp/options.h"
@@ -119,7 +122,18 @@ bool CppGenerator::Generate(const FileDescriptor* file,
   //
   // If the lite option is passed to the compiler, we will generate the
   // current files and all transitive dependencies using the LITE runtime.
+  //
+  // If the table_driven_serialization option is passed to the compiler, the
+  // generated messages compute their size and serialize themselves from their
+  // parse tables instead of generated code for each field, for smaller code.
+  //
+  // If the field_access_profile option is passed to the compiler, the
+  // generator reads the field access profile at the given path, as written by
+  // internal::FieldAccessSampler. Presence checks and fast parse table entries
+  // are ordered by how often each field is set. The profile does not split out
+  // fields or inline strings.
   Options file_options;
+  std::string field_access_profile_path;
 
   file_options.opensource_runtime = opensource_runtime_;
   file_options.runtime_include_base = runtime_include_base_;
@@ -184,6 +198,10 @@ bool CppGenerator::Generate(const FileDescriptor* file,
       file_options.force_eagerly_verified_lazy = true;
     } else if (key == "experimental_strip_nonfunctional_codegen") {
       file_options.strip_nonfunctional_codegen = true;
+    } else if (key == "table_driven_serialization") {
+      file_options.table_driven_serialization = true;
+    } else if (key == "field_access_profile") {
+      field_access_profile_path = value;
     } else {
       *error = absl::StrCat("Unknown generator option: ", key);
       return false;
@@ -198,6 +216,18 @@ bool CppGenerator::Generate(const FileDescriptor* file,
     return false;
   }
 
+  absl::optional<FieldAccessProfile> field_access_profile;
+  if (!field_access_profile_path.empty()) {
+    absl::StatusOr<FieldAccessProfile> profile =
+        FieldAccessProfile::Load(field_access_profile_path);
+    if (!profile.ok()) {
+      *error = std::string(profile.status().message());
+      return false;
+    }
+    field_access_profile = *std::move(profile);
+    file_options.field_access_profile = &*field_access_profile;
+  }
+
   // -----------------------------------------------------------------
 
 
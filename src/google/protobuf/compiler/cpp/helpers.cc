@@ -34,6 +34,8 @@
 #include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
+#include "google/protobuf/compiler/cpp/field_access_profile.h"
 #include "google/protobuf/compiler/cpp/names.h"
 #include "google/protobuf/compiler/cpp/options.h"
 #include "google/protobuf/compiler/scc.h"
@@ -922,17 +924,36 @@ bool IsProfileDriven(const Options& options) {
          options.access_info_map != nullptr;
 }
 
+bool HasFieldAccessProfile(const Options& options) {
+  return !options.bootstrap && options.field_access_profile != nullptr;
+}
+
+// Thresholds on the fraction of sampled messages that have a field set, in a
+// field access profile.
+constexpr double kRarelyPresentRatio = 0.005;
+constexpr double kLikelyPresentRatio = 0.9;
+
+static absl::optional<double> PresenceRatio(const FieldDescriptor* field,
+                                            const Options& options) {
+  if (!HasFieldAccessProfile(options)) return absl::nullopt;
+  return options.field_access_profile->PresenceRatio(field);
+}
+
 bool IsRarelyPresent(const FieldDescriptor* field, const Options& options) {
-  return false;
+  absl::optional<double> ratio = PresenceRatio(field, options);
+  return ratio.has_value() && *ratio < kRarelyPresentRatio;
 }
 
 bool IsLikelyPresent(const FieldDescriptor* field, const Options& options) {
-  return false;
+  absl::optional<double> ratio = PresenceRatio(field, options);
+  return ratio.has_value() && *ratio >= kLikelyPresentRatio;
 }
 
 float GetPresenceProbability(const FieldDescriptor* field,
                              const Options& options) {
-  return 1.f;
+  absl::optional<double> ratio = PresenceRatio(field, options);
+  if (!ratio.has_value()) return 1.f;
+  return static_cast<float>(std::min(*ratio, 1.0));
 }
 
 bool IsStringInliningEnabled(const Options& options) {
@@ -1036,17 +1057,23 @@ bool ShouldForceAllocationOnConstruction(const Descriptor* desc,
 }
 
 bool IsPresentMessage(const Descriptor* descriptor, const Options& options) {
-  (void)descriptor;
-  (void)options;
   // Assume that the message is present if there is no profile.
-  return true;
+  if (!HasFieldAccessProfile(options)) return true;
+  return options.field_access_profile->HasMessage(descriptor);
 }
 
 const FieldDescriptor* FindHottestField(
     const std::vector<const FieldDescriptor*>& fields, const Options& options) {
-  (void)fields;
-  (void)options;
-  return nullptr;
+  const FieldDescriptor* hottest = nullptr;
+  double hottest_ratio = 0;
+  for (const FieldDescriptor* field : fields) {
+    absl::optional<double> ratio = PresenceRatio(field, options);
+    if (ratio.has_value() && *ratio > hottest_ratio) {
+      hottest = field;
+      hottest_ratio = *ratio;
+    }
+  }
+  return hottest;
 }
 
 static bool HasRepeatedFields(const Descriptor* descriptor) {
@@ -1547,6 +1574,25 @@ bool IsImplicitWeakField(const FieldDescriptor* field, const Options& options,
              scc_analyzer->GetSCC(field->message_type());
 }
 
+bool UseTableDrivenSerialization(const Descriptor* descriptor,
+                                 const Options& options,
+                                 MessageSCCAnalyzer* scc_analyzer) {
+  if (!options.table_driven_serialization ||
+      descriptor->options().message_set_wire_format()) {
+    return false;
+  }
+  // Maps, weak and lazy fields, and StringPiece fields have representations
+  // that the table-driven serializer does not handle.
+  for (const auto* field : FieldRange(descriptor)) {
+    if (field->is_map() || IsWeak(field, options) || IsStringPiece(field) ||
+        IsLazy(field, options, scc_analyzer) ||
+        IsImplicitWeakField(field, options, scc_analyzer)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 MessageAnalysis MessageSCCAnalyzer::GetSCCAnalysis(const SCC* scc) {
   auto it = analysis_cache_.find(scc);
   if (it != analysis_cache_.end()) return it->second;
@@ -346,10 +346,15 @@ inline bool IsStringPiece(const FieldDescriptor* field) {
 
 bool IsProfileDriven(const Options& options);
 
-// Returns true if `field` is unlikely to be present based on PDProto profile.
+// Returns true if a field access profile was passed to the generator.
+bool HasFieldAccessProfile(const Options& options);
+
+// Returns true if `field` is unlikely to be present based on the field access
+// profile.
 bool IsRarelyPresent(const FieldDescriptor* field, const Options& options);
 
-// Returns true if `field` is likely to be present based on PDProto profile.
+// Returns true if `field` is likely to be present based on the field access
+// profile.
 bool IsLikelyPresent(const FieldDescriptor* field, const Options& options);
 
 float GetPresenceProbability(const FieldDescriptor* field,
@@ -822,6 +827,12 @@ bool UsingImplicitWeakFields(const FileDescriptor* file,
 bool IsImplicitWeakField(const FieldDescriptor* field, const Options& options,
                          MessageSCCAnalyzer* scc_analyzer);
 
+// Indicates whether ByteSizeLong() and _InternalSerialize() of this message
+// call the table-driven serializer instead of being generated field by field.
+bool UseTableDrivenSerialization(const Descriptor* descriptor,
+                                 const Options& options,
+                                 MessageSCCAnalyzer* scc_analyzer);
+
 inline std::string SimpleBaseClass(const Descriptor* desc,
                                    const Options& options) {
   // The only base class we have derived from `Message`.
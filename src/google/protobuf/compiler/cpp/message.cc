@@ -440,7 +440,8 @@ bool MaybeEmitHaswordsCheck(ChunkIterator it, ChunkIterator end,
                             const std::vector<int>& has_bit_indices,
                             int cached_has_word_index, const std::string& from,
                             io::Printer* p) {
-  if (!it->has_hasbit || !IsProfileDriven(options) ||
+  if (!it->has_hasbit ||
+      !(IsProfileDriven(options) || HasFieldAccessProfile(options)) ||
       std::distance(it, end) < 2 || !it->is_rarely_present) {
     return false;
   }
@@ -4354,6 +4355,30 @@ void MessageGenerator::GenerateSerializeWithCachedSizesToArray(io::Printer* p) {
     return;
   }
 
+  if (UseTableDrivenSerialization(descriptor_, options_, scc_analyzer_)) {
+    p->Emit({{"serialize", UseUnknownFieldSet(descriptor_->file(), options_)
+                               ? "Serialize"
+                               : "SerializeLite"}},
+            R"cc(
+#if defined(PROTOBUF_CUSTOM_VTABLE)
+              $uint8$* $classname$::_InternalSerialize(
+                  const MessageLite& base, $uint8$* target,
+                  ::$proto_ns$::io::EpsCopyOutputStream* stream) {
+                const $classname$& this_ = static_cast<const $classname$&>(base);
+#else   // PROTOBUF_CUSTOM_VTABLE
+              $uint8$* $classname$::_InternalSerialize(
+                  $uint8$* target,
+                  ::$proto_ns$::io::EpsCopyOutputStream* stream) const {
+                const $classname$& this_ = *this;
+#endif  // PROTOBUF_CUSTOM_VTABLE
+                $annotate_serialize$;
+                return ::_pbi::TcParser::$serialize$(this_, &_table_.header,
+                                                     target, stream);
+              }
+            )cc");
+    return;
+  }
+
   p->Emit(
       {
           {"debug_cond", ShouldSerializeInOrder(descriptor_, options_)
@@ -4747,6 +4772,26 @@ void MessageGenerator::GenerateByteSize(io::Printer* p) {
     return;
   }
 
+  if (UseTableDrivenSerialization(descriptor_, options_, scc_analyzer_)) {
+    p->Emit({{"byte_size", UseUnknownFieldSet(descriptor_->file(), options_)
+                               ? "ByteSize"
+                               : "ByteSizeLite"}},
+            R"cc(
+#if defined(PROTOBUF_CUSTOM_VTABLE)
+              ::size_t $classname$::ByteSizeLong(const MessageLite& base) {
+                const $classname$& this_ = static_cast<const $classname$&>(base);
+#else   // PROTOBUF_CUSTOM_VTABLE
+              ::size_t $classname$::ByteSizeLong() const {
+                const $classname$& this_ = *this;
+#endif  // PROTOBUF_CUSTOM_VTABLE
+                $WeakDescriptorSelfPin$;
+                $annotate_bytesize$;
+                return ::_pbi::TcParser::$byte_size$(this_, &_table_.header);
+              }
+            )cc");
+    return;
+  }
+
   std::vector<FieldChunk> chunks = CollectFields(
       optimized_order_, options_,
       [&](const FieldDescriptor* a, const FieldDescriptor* b) -> bool {
@@ -21,6 +21,7 @@ class AccessInfoMap;
 class SplitMap;
 
 namespace cpp {
+class FieldAccessProfile;
 
 enum class EnforceOptimizeMode {
   kNoEnforcement,  // Use the runtime specified by the file specific options.
@@ -38,6 +39,7 @@ struct FieldListenerOptions {
 struct Options {
   const AccessInfoMap* access_info_map = nullptr;
   const SplitMap* split_map = nullptr;
+  const FieldAccessProfile* field_access_profile = nullptr;
   std::string dllexport_decl;
   std::string runtime_include_base;
   std::string annotation_pragma_name;
@@ -66,6 +68,7 @@ struct Options {
   bool force_inline_string = false;
 #endif  // !PROTOBUF_STABLE_EXPERIMENTS
   bool strip_nonfunctional_codegen = false;
+  bool table_driven_serialization = false;
 };
 
 }  // namespace cpp
@@ -60,6 +60,7 @@
 #include "absl/strings/string_view.h"
 #include "absl/strings/strip.h"
 #include "absl/strings/substitute.h"
+#include "absl/synchronization/blocking_counter.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
@@ -75,6 +76,7 @@
 #include "google/protobuf/generated_message_util.h"
 #include "google/protobuf/io/strtod.h"
 #include "google/protobuf/io/tokenizer.h"
+#include "google/protobuf/lock_free_lookup_map.h"
 #include "google/protobuf/message.h"
 #include "google/protobuf/message_lite.h"
 #include "google/protobuf/parse_context.h"
@@ -656,6 +658,14 @@ class Symbol {
 
 #undef DEFINE_MEMBERS
 
+  // Converts to and from a plain pointer, for caches of symbols.
+  const internal::SymbolBase* base() const { return ptr_; }
+  static Symbol FromBase(const internal::SymbolBase* base) {
+    Symbol s;
+    s.ptr_ = base;
+    return s;
+  }
+
   Type type() const { return static_cast<Type>(ptr_->symbol_type_); }
   bool IsNull() const { return type() == NULL_SYMBOL; }
   bool IsType() const { return type() == MESSAGE || type() == ENUM; }
@@ -1483,6 +1493,38 @@ class DescriptorPool::Tables {
   // so the overhead is small.
   absl::flat_hash_map<std::string, Descriptor::WellKnownType> well_known_types_;
 
+  // Symbols, files and extensions that lookups have already found, so that
+  // later lookups of them take no locks.  Entries are only added while
+  // holding the pool's mutex, and only for pools that have one; pools without
+  // a mutex take no locks anyway.
+  struct SymbolName {
+    absl::string_view operator()(const internal::SymbolBase& symbol) const {
+      return Symbol::FromBase(&symbol).full_name();
+    }
+  };
+  struct FileName {
+    absl::string_view operator()(const FileDescriptor& file) const {
+      return file.name();
+    }
+  };
+  using ExtensionKey = std::pair<const Descriptor*, int>;
+  struct ExtensionNumber {
+    ExtensionKey operator()(const FieldDescriptor& extension) const {
+      return {extension.containing_type(), extension.number()};
+    }
+  };
+  internal::LockFreeLookupMap<absl::string_view, internal::SymbolBase,
+                              SymbolName>
+      found_symbols_;
+  internal::LockFreeLookupMap<absl::string_view, FileDescriptor, FileName>
+      found_files_;
+  internal::LockFreeLookupMap<ExtensionKey, FieldDescriptor, ExtensionNumber>
+      found_extensions_;
+
+  // Pools that BuildFilesParallel() built files in, whose tables have been
+  // adopted.  They own the memory of those files.
+  std::vector<std::unique_ptr<const DescriptorPool>> adopted_pools_;
+
   // -----------------------------------------------------------------
   // Finding items.
 
@@ -1514,6 +1556,12 @@ class DescriptorPool::Tables {
   bool AddFile(const FileDescriptor* file);
   bool AddExtension(const FieldDescriptor* field);
 
+  // Moves all symbols, files and extensions of `other` into these tables.
+  // Returns false, changing nothing, if any of them is already defined here,
+  // except for packages, which may be defined by both.  There must be no
+  // checkpoints in either.  `other` keeps its allocations.
+  bool AdoptTables(Tables& other);
+
   // Caches a feature set and returns a stable reference to the cached
   // allocation owned by the pool.
   const FeatureSet* InternFeatureSet(FeatureSet&& features);
@@ -1691,11 +1739,9 @@ inline Symbol FileDescriptorTables::FindNestedSymbol(
 Symbol DescriptorPool::Tables::FindByNameHelper(const DescriptorPool* pool,
                                                 absl::string_view name) {
   if (pool->mutex_ != nullptr) {
-    // Fast path: the Symbol is already cached.  This is just a hash lookup.
-    absl::ReaderMutexLock lock(pool->mutex_);
-    if (known_bad_symbols_.empty() && known_bad_files_.empty()) {
-      Symbol result = FindSymbol(name);
-      if (!result.IsNull()) return result;
+    // Fast path: the Symbol was found before.  This takes no locks.
+    if (const internal::SymbolBase* found = found_symbols_.Find(name)) {
+      return Symbol::FromBase(found);
     }
   }
   DescriptorPool::DeferredValidation deferred_validation(pool);
@@ -1714,6 +1760,13 @@ Symbol DescriptorPool::Tables::FindByNameHelper(const DescriptorPool* pool,
           pool->underlay_->tables_->FindByNameHelper(pool->underlay_, name);
     }
 
+    // Symbols that were already built have been validated, and are never
+    // removed from the pool or its underlay.  Ones built just now are added
+    // on their next lookup.
+    if (!result.IsNull() && pool->mutex_ != nullptr) {
+      found_symbols_.Insert(result.base());
+    }
+
     if (result.IsNull()) {
       // Symbol still not found, so check fallback database.
       if (pool->TryFindSymbolInFallbackDatabase(name, deferred_validation)) {
@@ -1940,6 +1993,36 @@ bool DescriptorPool::Tables::AddFile(const FileDescriptor* file) {
   }
 }
 
+bool DescriptorPool::Tables::AdoptTables(Tables& other) {
+  ABSL_DCHECK(checkpoints_.empty());
+  ABSL_DCHECK(other.checkpoints_.empty());
+  for (Symbol symbol : other.symbols_by_name_) {
+    Symbol existing = FindSymbol(symbol.full_name());
+    if (!existing.IsNull() && !(existing.IsPackage() && symbol.IsPackage())) {
+      return false;
+    }
+  }
+  for (const FileDescriptor* file : other.files_by_name_) {
+    if (FindFile(file->name()) != nullptr) return false;
+  }
+  for (const auto& extension : other.extensions_) {
+    if (extensions_.find(extension.first) != extensions_.end()) return false;
+  }
+
+  symbols_by_name_.insert(other.symbols_by_name_.begin(),
+                          other.symbols_by_name_.end());
+  files_by_name_.insert(other.files_by_name_.begin(),
+                        other.files_by_name_.end());
+  extensions_.insert(other.extensions_.begin(), other.extensions_.end());
+  other.symbols_by_name_.clear();
+  other.files_by_name_.clear();
+  other.extensions_.clear();
+  other.symbols_after_checkpoint_.clear();
+  other.files_after_checkpoint_.clear();
+  other.extensions_after_checkpoint_.clear();
+  return true;
+}
+
 void FileDescriptorTables::FinalizeTables() {}
 
 bool FileDescriptorTables::AddFieldByNumber(FieldDescriptor* field) {
@@ -2244,6 +2327,11 @@ void DescriptorPool::InternalAddGeneratedFile(
 
 const FileDescriptor* DescriptorPool::FindFileByName(
     absl::string_view name) const {
+  if (mutex_ != nullptr) {
+    if (const FileDescriptor* found = tables_->found_files_.Find(name)) {
+      return found;
+    }
+  }
   DeferredValidation deferred_validation(this);
   const FileDescriptor* result = nullptr;
   {
@@ -2253,7 +2341,12 @@ const FileDescriptor* DescriptorPool::FindFileByName(
       tables_->known_bad_files_.clear();
     }
     result = tables_->FindFile(name);
-    if (result != nullptr) return result;
+    if (result != nullptr) {
+      // Files in the underlay may later be shadowed by files built in this
+      // pool, so only files of this pool are remembered.
+      if (mutex_ != nullptr) tables_->found_files_.Insert(result);
+      return result;
+    }
     if (underlay_ != nullptr) {
       result = underlay_->FindFileByName(name);
       if (result != nullptr) return result;
@@ -2270,6 +2363,12 @@ const FileDescriptor* DescriptorPool::FindFileByName(
 
 const FileDescriptor* DescriptorPool::FindFileContainingSymbol(
     absl::string_view symbol_name) const {
+  if (mutex_ != nullptr) {
+    if (const internal::SymbolBase* found =
+            tables_->found_symbols_.Find(symbol_name)) {
+      return Symbol::FromBase(found).GetFile();
+    }
+  }
   const FileDescriptor* file_result = nullptr;
   DeferredValidation deferred_validation(this);
   {
@@ -2350,13 +2449,12 @@ const MethodDescriptor* DescriptorPool::FindMethodByName(
 const FieldDescriptor* DescriptorPool::FindExtensionByNumber(
     const Descriptor* extendee, int number) const {
   if (extendee->extension_range_count() == 0) return nullptr;
-  // A faster path to reduce lock contention in finding extensions, assuming
+  // A faster path to avoid lock contention in finding extensions, assuming
   // most extensions will be cache hit.
   if (mutex_ != nullptr) {
-    absl::ReaderMutexLock lock(mutex_);
-    const FieldDescriptor* result = tables_->FindExtension(extendee, number);
-    if (result != nullptr) {
-      return result;
+    if (const FieldDescriptor* found =
+            tables_->found_extensions_.Find({extendee, number})) {
+      return found;
     }
   }
   const FieldDescriptor* result = nullptr;
@@ -2369,6 +2467,7 @@ const FieldDescriptor* DescriptorPool::FindExtensionByNumber(
     }
     result = tables_->FindExtension(extendee, number);
     if (result != nullptr) {
+      if (mutex_ != nullptr) tables_->found_extensions_.Insert(result);
       return result;
     }
     if (underlay_ != nullptr) {
@@ -4718,6 +4817,186 @@ const FileDescriptor* DescriptorPool::BuildFileCollectingErrors(
   return nullptr;
 }
 
+namespace {
+
+// Keeps the warnings of a build that runs off the calling thread, so that they
+// can be reported later.  Builds with errors are redone on the calling thread,
+// so errors are only counted.
+class DeferredErrorCollector : public DescriptorPool::ErrorCollector {
+ public:
+  bool has_errors() const { return has_errors_; }
+
+  void RecordError(absl::string_view filename, absl::string_view element_name,
+                   const Message* descriptor, ErrorLocation location,
+                   absl::string_view message) override {
+    has_errors_ = true;
+  }
+
+  void RecordWarning(absl::string_view filename,
+                     absl::string_view element_name, const Message* descriptor,
+                     ErrorLocation location,
+                     absl::string_view message) override {
+    warnings_.push_back({std::string(filename), std::string(element_name),
+                         descriptor, location, std::string(message)});
+  }
+
+  void ReportWarnings(DescriptorPool::ErrorCollector* error_collector) const {
+    for (const Warning& warning : warnings_) {
+      if (error_collector == nullptr) {
+        ABSL_LOG(WARNING) << warning.filename << " " << warning.element_name
+                          << ": " << warning.message;
+      } else {
+        error_collector->RecordWarning(warning.filename, warning.element_name,
+                                       warning.descriptor, warning.location,
+                                       warning.message);
+      }
+    }
+  }
+
+ private:
+  struct Warning {
+    std::string filename;
+    std::string element_name;
+    const Message* descriptor;
+    ErrorLocation location;
+    std::string message;
+  };
+  bool has_errors_ = false;
+  std::vector<Warning> warnings_;
+};
+
+}  // namespace
+
+std::vector<const FileDescriptor*> DescriptorPool::BuildFilesParallel(
+    const FileDescriptorSet& file_set, Executor* executor,
+    ErrorCollector* error_collector) {
+  ABSL_CHECK(fallback_database_ == nullptr)
+      << "Cannot call BuildFilesParallel on a DescriptorPool that uses a "
+         "DescriptorDatabase.";
+  // Each group of independent files is split into at most this many tasks.
+  // Every task builds into a pool of its own, which this pool keeps.
+  static constexpr size_t kMaxTasksPerGroup = 64;
+
+  const int file_count = file_set.file_size();
+  std::vector<const FileDescriptor*> result(file_count, nullptr);
+
+  // Order the files by their dependencies within the set.  Files that appear
+  // twice or are part of a dependency cycle are built last, one by one, which
+  // reports the usual errors.
+  absl::flat_hash_map<absl::string_view, int> index_by_name;
+  std::vector<int> built_last;
+  for (int i = 0; i < file_count; ++i) {
+    if (!index_by_name.try_emplace(file_set.file(i).name(), i).second) {
+      built_last.push_back(i);
+    }
+  }
+  std::vector<int> missing_dependencies(file_count, 0);
+  std::vector<std::vector<int>> dependents(file_count);
+  std::vector<int> ready;
+  for (int i = 0; i < file_count; ++i) {
+    const FileDescriptorProto& proto = file_set.file(i);
+    if (index_by_name[proto.name()] != i) continue;
+    for (const std::string& dependency : proto.dependency()) {
+      auto it = index_by_name.find(dependency);
+      if (it == index_by_name.end()) continue;
+      ++missing_dependencies[i];
+      dependents[it->second].push_back(i);
+    }
+    if (missing_dependencies[i] == 0) ready.push_back(i);
+  }
+
+  while (!ready.empty()) {
+    if (executor == nullptr || ready.size() == 1) {
+      for (int i : ready) {
+        result[i] = BuildFileCollectingErrors(file_set.file(i), error_collector);
+      }
+    } else {
+      // Files in `ready` don't depend on each other, so each task can build
+      // its share into a new pool layered on this one, which isn't modified
+      // until all tasks are done.
+      struct Task {
+        absl::Span<const int> files;
+        std::unique_ptr<DescriptorPool> pool;
+        std::vector<const FileDescriptor*> built;
+        DeferredErrorCollector errors;
+      };
+      const size_t task_count = std::min(ready.size(), kMaxTasksPerGroup);
+      std::vector<Task> tasks(task_count);
+      absl::BlockingCounter tasks_left(static_cast<int>(task_count));
+      for (size_t t = 0; t < task_count; ++t) {
+        Task& task = tasks[t];
+        const size_t begin = ready.size() * t / task_count;
+        const size_t end = ready.size() * (t + 1) / task_count;
+        task.files = absl::MakeConstSpan(ready).subspan(begin, end - begin);
+        task.pool = absl::make_unique<DescriptorPool>(this);
+        DescriptorPool& pool = *task.pool;
+        pool.enforce_dependencies_ = enforce_dependencies_;
+        pool.allow_unknown_ = allow_unknown_;
+        pool.enforce_weak_ = enforce_weak_;
+        pool.enforce_extension_declarations_ = enforce_extension_declarations_;
+        pool.disallow_enforce_utf8_ = disallow_enforce_utf8_;
+        pool.deprecated_legacy_json_field_conflicts_ =
+            deprecated_legacy_json_field_conflicts_;
+        pool.direct_input_files_ = direct_input_files_;
+        if (feature_set_defaults_spec_ != nullptr) {
+          pool.feature_set_defaults_spec_ =
+              absl::make_unique<FeatureSetDefaults>(*feature_set_defaults_spec_);
+        }
+        executor->Schedule([&task, &file_set, &tasks_left] {
+          for (int i : task.files) {
+            const FileDescriptor* file = task.pool->BuildFileCollectingErrors(
+                file_set.file(i), &task.errors);
+            if (file == nullptr) break;
+            task.built.push_back(file);
+          }
+          tasks_left.DecrementCount();
+        });
+      }
+      tasks_left.Wait();
+      build_started_ = true;
+
+      for (Task& task : tasks) {
+        if (!task.errors.has_errors() &&
+            task.built.size() == task.files.size() &&
+            tables_->AdoptTables(*task.pool->tables_)) {
+          for (size_t k = 0; k < task.files.size(); ++k) {
+            const_cast<FileDescriptor*>(task.built[k])->pool_ = this;
+            result[task.files[k]] = task.built[k];
+          }
+          task.errors.ReportWarnings(error_collector);
+          tables_->adopted_pools_.push_back(std::move(task.pool));
+        } else {
+          // Something went wrong, possibly only because of a conflict with
+          // another task.  Build the files again here, which gives the same
+          // results and errors as if they had never been built in parallel.
+          for (int i : task.files) {
+            result[i] =
+                BuildFileCollectingErrors(file_set.file(i), error_collector);
+          }
+        }
+      }
+    }
+
+    std::vector<int> next;
+    for (int i : ready) {
+      for (int dependent : dependents[i]) {
+        if (--missing_dependencies[dependent] == 0) next.push_back(dependent);
+      }
+    }
+    std::sort(next.begin(), next.end());
+    ready = std::move(next);
+  }
+
+  for (int i = 0; i < file_count; ++i) {
+    if (missing_dependencies[i] > 0) built_last.push_back(i);
+  }
+  std::sort(built_last.begin(), built_last.end());
+  for (int i : built_last) {
+    result[i] = BuildFileCollectingErrors(file_set.file(i), error_collector);
+  }
+  return result;
+}
+
 const FileDescriptor* DescriptorPool::BuildFileFromDatabase(
     const FileDescriptorProto& proto,
     DeferredValidation& deferred_validation) const {
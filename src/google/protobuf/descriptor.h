@@ -95,6 +95,7 @@ class EnumValueDescriptorProto;
 class ServiceDescriptorProto;
 class MethodDescriptorProto;
 class FileDescriptorProto;
+class FileDescriptorSet;
 class MessageOptions;
 class FieldOptions;
 class OneofOptions;
@@ -2231,6 +2232,30 @@ class PROTOBUF_EXPORT DescriptorPool {
   const FileDescriptor* BuildFileCollectingErrors(
       const FileDescriptorProto& proto, ErrorCollector* error_collector);
 
+#ifndef SWIG
+  // Runs the tasks of BuildFilesParallel().  Schedule() may run the task on
+  // any thread, including the calling one.
+  class PROTOBUF_EXPORT Executor {
+   public:
+    virtual ~Executor() = default;
+    virtual void Schedule(absl::AnyInvocable<void() &&> task) = 0;
+  };
+
+  // Builds all files in `file_set`, which may be listed in any order.  This is
+  // equivalent to calling BuildFileCollectingErrors() on each file after its
+  // dependencies, but files whose dependencies are all built are built
+  // concurrently on `executor`, and then added to this pool in one step.  If
+  // `executor` is nullptr, the files are built on the calling thread.
+  //
+  // Returns the built files in the order of `file_set`, with nullptr for
+  // files that failed to build.  Errors and warnings are reported to
+  // `error_collector` from the calling thread, in the order of `file_set`
+  // within each group of independent files.
+  std::vector<const FileDescriptor*> BuildFilesParallel(
+      const FileDescriptorSet& file_set, Executor* executor,
+      ErrorCollector* error_collector = nullptr);
+#endif  // SWIG
+
   // By default, it is an error if a FileDescriptorProto contains references
   // to types or other files that are not found in the DescriptorPool (or its
   // backing DescriptorDatabase, if any).  If you call
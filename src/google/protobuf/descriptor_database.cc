@@ -12,16 +12,25 @@
 #include "google/protobuf/descriptor_database.h"
 
 #include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/container/btree_set.h"
+#include "absl/memory/memory.h"
 #include "absl/strings/ascii.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_replace.h"
 #include "absl/strings/string_view.h"
 #include "google/protobuf/descriptor.pb.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
+#include "google/protobuf/wire_format_lite.h"
 
 
 namespace google {
@@ -395,6 +404,8 @@ class EncodedDescriptorDatabase::DescriptorIndex {
                                std::vector<int>* output);
   void FindAllFileNames(std::vector<std::string>* output) const;
 
+  bool SerializeIndexedImage(std::string* output);
+
  private:
   friend class EncodedDescriptorDatabase;
 
@@ -541,10 +552,197 @@ class EncodedDescriptorDatabase::DescriptorIndex {
   std::vector<ExtensionEntry> by_extension_flat_;
 };
 
+namespace {
+
+// The parts of descriptor protos that DescriptorIndex::AddFile() looks at,
+// with the accessors of the real protos.  Strings alias the encoded file.
+//
+// Every generated file linked into a binary is indexed during static
+// initialization.  Reading just these fields off the wire avoids building,
+// and then destroying, a full FileDescriptorProto with all of its fields and
+// options for each of them.
+//
+// This only covers registration.  A file that is looked up is still parsed in
+// full by FindFileByName() and friends, and then built and cross-linked by
+// DescriptorPool::BuildFile(), so the cost measured by
+// BM_LoadAdsDescriptor_Proto2 is unchanged.
+struct IndexedNameProto {
+  absl::string_view name_;
+
+  absl::string_view name() const { return name_; }
+};
+
+struct IndexedFieldProto {
+  absl::string_view name_;
+  absl::string_view extendee_;
+  int32_t number_ = 0;
+
+  absl::string_view name() const { return name_; }
+  absl::string_view extendee() const { return extendee_; }
+  int32_t number() const { return number_; }
+};
+
+struct IndexedMessageProto {
+  absl::string_view name_;
+  std::vector<IndexedMessageProto> nested_type_;
+  std::vector<IndexedFieldProto> extension_;
+
+  absl::string_view name() const { return name_; }
+  const std::vector<IndexedMessageProto>& nested_type() const {
+    return nested_type_;
+  }
+  const std::vector<IndexedFieldProto>& extension() const { return extension_; }
+};
+
+struct IndexedFileProto {
+  absl::string_view name_;
+  absl::string_view package_;
+  std::vector<IndexedMessageProto> message_type_;
+  std::vector<IndexedNameProto> enum_type_;
+  std::vector<IndexedNameProto> service_;
+  std::vector<IndexedFieldProto> extension_;
+
+  absl::string_view name() const { return name_; }
+  absl::string_view package() const { return package_; }
+  const std::vector<IndexedMessageProto>& message_type() const {
+    return message_type_;
+  }
+  const std::vector<IndexedNameProto>& enum_type() const { return enum_type_; }
+  const std::vector<IndexedNameProto>& service() const { return service_; }
+  const std::vector<IndexedFieldProto>& extension() const { return extension_; }
+};
+
+// The tag of a length-delimited field.  Defined outside IndexedProtoParser so
+// that it can be used in its case labels.
+constexpr uint32_t Tag(int field_number) {
+  return internal::WireFormatLite::MakeTag(
+      field_number, internal::WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+}
+
+// Parses the Indexed*Proto structs.  Unknown fields are skipped, but the
+// input must still be a well-formed message, as it would for ParseFromArray().
+class IndexedProtoParser {
+ public:
+  IndexedProtoParser(const void* data, int size)
+      : data_(static_cast<const char*>(data)),
+        input_(static_cast<const uint8_t*>(data), size) {}
+
+  bool Parse(IndexedFileProto* file) {
+    return ParseFields(file) && input_.ConsumedEntireMessage();
+  }
+
+ private:
+  using WireFormatLite = internal::WireFormatLite;
+
+  template <typename Proto>
+  bool ParseFields(Proto* proto) {
+    while (uint32_t tag = input_.ReadTag()) {
+      bool handled;
+      if (!ParseField(tag, proto, &handled)) return false;
+      if (!handled && !WireFormatLite::SkipField(&input_, tag)) return false;
+    }
+    return true;
+  }
+
+  // Each overload sets `*handled` if `tag` is a field it reads, and returns
+  // false on malformed input.
+  bool ParseField(uint32_t tag, IndexedFileProto* file, bool* handled) {
+    *handled = true;
+    switch (tag) {
+      case Tag(FileDescriptorProto::kNameFieldNumber):
+        return ReadString(&file->name_);
+      case Tag(FileDescriptorProto::kPackageFieldNumber):
+        return ReadString(&file->package_);
+      case Tag(FileDescriptorProto::kMessageTypeFieldNumber):
+        return ReadMessage(&file->message_type_);
+      case Tag(FileDescriptorProto::kEnumTypeFieldNumber):
+        return ReadMessage(&file->enum_type_);
+      case Tag(FileDescriptorProto::kServiceFieldNumber):
+        return ReadMessage(&file->service_);
+      case Tag(FileDescriptorProto::kExtensionFieldNumber):
+        return ReadMessage(&file->extension_);
+    }
+    *handled = false;
+    return true;
+  }
+
+  bool ParseField(uint32_t tag, IndexedMessageProto* message, bool* handled) {
+    *handled = true;
+    switch (tag) {
+      case Tag(DescriptorProto::kNameFieldNumber):
+        return ReadString(&message->name_);
+      case Tag(DescriptorProto::kNestedTypeFieldNumber):
+        return ReadMessage(&message->nested_type_);
+      case Tag(DescriptorProto::kExtensionFieldNumber):
+        return ReadMessage(&message->extension_);
+    }
+    *handled = false;
+    return true;
+  }
+
+  bool ParseField(uint32_t tag, IndexedFieldProto* field, bool* handled) {
+    *handled = true;
+    switch (tag) {
+      case Tag(FieldDescriptorProto::kNameFieldNumber):
+        return ReadString(&field->name_);
+      case Tag(FieldDescriptorProto::kExtendeeFieldNumber):
+        return ReadString(&field->extendee_);
+      case WireFormatLite::MakeTag(FieldDescriptorProto::kNumberFieldNumber,
+                                   WireFormatLite::WIRETYPE_VARINT): {
+        uint32_t number;
+        if (!input_.ReadVarint32(&number)) return false;
+        field->number_ = static_cast<int32_t>(number);
+        return true;
+      }
+    }
+    *handled = false;
+    return true;
+  }
+
+  bool ParseField(uint32_t tag, IndexedNameProto* proto, bool* handled) {
+    // EnumDescriptorProto and ServiceDescriptorProto number `name` alike.
+    static_assert(
+        static_cast<int>(EnumDescriptorProto::kNameFieldNumber) ==
+            static_cast<int>(ServiceDescriptorProto::kNameFieldNumber),
+        "");
+    *handled = tag == Tag(EnumDescriptorProto::kNameFieldNumber);
+    return !*handled || ReadString(&proto->name_);
+  }
+
+  bool ReadString(absl::string_view* value) {
+    uint32_t length;
+    if (!input_.ReadVarint32(&length) || length > INT_MAX) return false;
+    const int position = input_.CurrentPosition();
+    if (!input_.Skip(static_cast<int>(length))) return false;
+    *value = absl::string_view(data_ + position, length);
+    return true;
+  }
+
+  template <typename Proto>
+  bool ReadMessage(std::vector<Proto>* protos) {
+    uint32_t length;
+    if (!input_.ReadVarint32(&length) || length > INT_MAX) return false;
+    auto limit =
+        input_.IncrementRecursionDepthAndPushLimit(static_cast<int>(length));
+    if (limit.second < 0) return false;
+    protos->emplace_back();
+    // A message cut short by the end of the input also ends "legitimately",
+    // so check that all of it was there.
+    const bool parsed =
+        ParseFields(&protos->back()) && input_.BytesUntilLimit() == 0;
+    return input_.DecrementRecursionDepthAndPopLimit(limit.first) && parsed;
+  }
+
+  const char* data_;
+  io::CodedInputStream input_;
+};
+
+}  // namespace
+
 bool EncodedDescriptorDatabase::Add(const void* encoded_file_descriptor,
                                     int size) {
-  FileDescriptorProto file;
-  if (file.ParseFromArray(encoded_file_descriptor, size)) {
+  IndexedFileProto file;
+  if (IndexedProtoParser(encoded_file_descriptor, size).Parse(&file)) {
     return index_->AddFile(file, std::make_pair(encoded_file_descriptor, size));
   } else {
     ABSL_LOG(ERROR) << "Invalid file descriptor data passed to "
@@ -862,6 +1060,10 @@ bool EncodedDescriptorDatabase::FindAllFileNames(
   return true;
 }
 
+bool EncodedDescriptorDatabase::SerializeIndexedImage(std::string* output) {
+  return index_->SerializeIndexedImage(output);
+}
+
 bool EncodedDescriptorDatabase::MaybeParse(
     std::pair<const void*, int> encoded_file, FileDescriptorProto* output) {
   if (encoded_file.first == nullptr) return false;
@@ -879,6 +1081,294 @@ EncodedDescriptorDatabase::~EncodedDescriptorDatabase() {
   }
 }
 
+// ===================================================================
+// The image read by MappedDescriptorDatabase.  Integers are little-endian
+// uint32s, and offsets are from the start of the image:
+//
+//   header:      "pbdescdb", version, file count, symbol count,
+//                extension count
+//   files:       name offset, name size, data offset, data size
+//   symbols:     name offset, name size, file index
+//   extensions:  extendee offset, extendee size, number, file index
+//
+// followed by the strings and encoded files that the records point to.  Files
+// are sorted by name, symbols by name, and extensions by extendee, then
+// number.  As in EncodedDescriptorDatabase, only top-level symbols are listed,
+// with their package; nested symbols are found through their top-level
+// symbol.  Extendees have no leading '.'.
+
+namespace {
+
+constexpr absl::string_view kImageMagic = "pbdescdb";
+constexpr uint32_t kImageVersion = 1;
+constexpr size_t kImageHeaderSize = 8 + 4 * 4;
+constexpr size_t kFileRecordSize = 16;
+constexpr size_t kSymbolRecordSize = 12;
+constexpr size_t kExtensionRecordSize = 16;
+
+uint32_t ReadImageUInt32(const char* data) {
+  uint32_t value;
+  io::CodedInputStream::ReadLittleEndian32FromArray(
+      reinterpret_cast<const uint8_t*>(data), &value);
+  return value;
+}
+
+// Returns the first of the `count` records for which `before_key` is false.
+// The records must be partitioned by it.
+template <typename BeforeKey>
+uint32_t PartitionPoint(uint32_t count, BeforeKey before_key) {
+  uint32_t low = 0;
+  uint32_t high = count;
+  while (low < high) {
+    const uint32_t mid = low + (high - low) / 2;
+    if (before_key(mid)) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+}  // namespace
+
+bool EncodedDescriptorDatabase::DescriptorIndex::SerializeIndexedImage(
+    std::string* output) {
+  EnsureFlat();
+
+  // Records refer to files by their position in name order.
+  std::vector<uint32_t> file_index(all_values_.size());
+  for (size_t i = 0; i < by_name_flat_.size(); ++i) {
+    file_index[by_name_flat_[i].data_offset] = static_cast<uint32_t>(i);
+  }
+  // by_symbol_flat_ is sorted by full name already, but readers compare plain
+  // strings, so sort by exactly that.
+  std::vector<std::pair<std::string, uint32_t>> symbols;
+  symbols.reserve(by_symbol_flat_.size());
+  for (const SymbolEntry& entry : by_symbol_flat_) {
+    symbols.emplace_back(entry.AsString(*this), file_index[entry.data_offset]);
+  }
+  std::sort(symbols.begin(), symbols.end());
+
+  // Write the header and records, appending what they point to.
+  output->assign(kImageHeaderSize + kFileRecordSize * by_name_flat_.size() +
+                     kSymbolRecordSize * symbols.size() +
+                     kExtensionRecordSize * by_extension_flat_.size(),
+                 '\0');
+  output->replace(0, kImageMagic.size(), kImageMagic.data(),
+                  kImageMagic.size());
+  size_t position = kImageMagic.size();
+  const auto write = [&](uint32_t value) {
+    io::CodedOutputStream::WriteLittleEndian32ToArray(
+        value, reinterpret_cast<uint8_t*>(&(*output)[position]));
+    position += sizeof(value);
+  };
+  const auto append = [&](absl::string_view bytes) {
+    write(static_cast<uint32_t>(output->size()));
+    write(static_cast<uint32_t>(bytes.size()));
+    output->append(bytes.data(), bytes.size());
+  };
+
+  write(kImageVersion);
+  write(static_cast<uint32_t>(by_name_flat_.size()));
+  write(static_cast<uint32_t>(symbols.size()));
+  write(static_cast<uint32_t>(by_extension_flat_.size()));
+  for (const FileEntry& entry : by_name_flat_) {
+    const EncodedEntry& value = all_values_[entry.data_offset];
+    append(entry.name(*this));
+    append(absl::string_view(static_cast<const char*>(value.data), value.size));
+  }
+  for (const auto& symbol : symbols) {
+    append(symbol.first);
+    write(symbol.second);
+  }
+  for (const ExtensionEntry& entry : by_extension_flat_) {
+    append(entry.extendee(*this));
+    write(static_cast<uint32_t>(entry.extension_number));
+    write(file_index[entry.data_offset]);
+  }
+
+  if (output->size() > std::numeric_limits<uint32_t>::max()) {
+    ABSL_LOG(ERROR) << "Descriptor database image would be "
+                    << output->size() << " bytes, which is too large.";
+    output->clear();
+    return false;
+  }
+  return true;
+}
+
+// ===================================================================
+
+MappedDescriptorDatabase::MappedDescriptorDatabase() = default;
+MappedDescriptorDatabase::~MappedDescriptorDatabase() = default;
+
+bool MappedDescriptorDatabase::Init(const void* data, size_t size) {
+  image_ = absl::string_view();
+  file_count_ = symbol_count_ = extension_count_ = 0;
+  files_ = symbols_ = extensions_ = nullptr;
+
+  absl::string_view image(static_cast<const char*>(data), size);
+  if (size < kImageHeaderSize || !absl::StartsWith(image, kImageMagic) ||
+      ReadImageUInt32(image.data() + 8) != kImageVersion) {
+    return false;
+  }
+  const uint32_t file_count = ReadImageUInt32(image.data() + 12);
+  const uint32_t symbol_count = ReadImageUInt32(image.data() + 16);
+  const uint32_t extension_count = ReadImageUInt32(image.data() + 20);
+  const uint64_t tables_size =
+      uint64_t{kFileRecordSize} * file_count +
+      uint64_t{kSymbolRecordSize} * symbol_count +
+      uint64_t{kExtensionRecordSize} * extension_count;
+  if (tables_size > size - kImageHeaderSize) return false;
+
+  image_ = image;
+  file_count_ = file_count;
+  symbol_count_ = symbol_count;
+  extension_count_ = extension_count;
+  files_ = image.data() + kImageHeaderSize;
+  symbols_ = files_ + kFileRecordSize * file_count;
+  extensions_ = symbols_ + kSymbolRecordSize * symbol_count;
+  return true;
+}
+
+bool MappedDescriptorDatabase::InitFromFile(int file_descriptor) {
+  io::MmapInputStream::Options options;
+  // Lookups touch the image at random.
+  options.sequential = false;
+  auto file = absl::make_unique<io::MmapInputStream>(file_descriptor, options);
+  std::string contents;
+  if (!file->is_mapped()) {
+    const void* data;
+    int size;
+    while (file->Next(&data, &size)) {
+      contents.append(static_cast<const char*>(data), size);
+    }
+    if (file->GetErrno() != 0) return false;
+  }
+
+  mapped_file_ = std::move(file);
+  read_file_ = std::move(contents);
+  const absl::string_view image =
+      mapped_file_->is_mapped() ? mapped_file_->mapped_data() : read_file_;
+  return Init(image.data(), image.size());
+}
+
+uint32_t MappedDescriptorDatabase::Field(const char* table, size_t record_size,
+                                         uint32_t index, int field) const {
+  return ReadImageUInt32(table + record_size * index + 4 * field);
+}
+
+absl::string_view MappedDescriptorDatabase::Bytes(uint32_t offset,
+                                                  uint32_t size) const {
+  if (offset > image_.size() || size > image_.size() - offset) return {};
+  return image_.substr(offset, size);
+}
+
+absl::string_view MappedDescriptorDatabase::FileName(uint32_t index) const {
+  return Bytes(Field(files_, kFileRecordSize, index, 0),
+               Field(files_, kFileRecordSize, index, 1));
+}
+
+absl::string_view MappedDescriptorDatabase::SymbolName(uint32_t index) const {
+  return Bytes(Field(symbols_, kSymbolRecordSize, index, 0),
+               Field(symbols_, kSymbolRecordSize, index, 1));
+}
+
+absl::string_view MappedDescriptorDatabase::ExtendeeName(
+    uint32_t index) const {
+  return Bytes(Field(extensions_, kExtensionRecordSize, index, 0),
+               Field(extensions_, kExtensionRecordSize, index, 1));
+}
+
+int64_t MappedDescriptorDatabase::FindFileIndex(
+    absl::string_view filename) const {
+  const uint32_t i = PartitionPoint(
+      file_count_, [&](uint32_t i) { return FileName(i) < filename; });
+  return i < file_count_ && FileName(i) == filename ? i : -1;
+}
+
+int64_t MappedDescriptorDatabase::FindSymbolFileIndex(
+    absl::string_view symbol_name) const {
+  // Find the last symbol that is less than or equal to `symbol_name`.  It
+  // either defines `symbol_name` or contains it, or no symbol does.
+  const uint32_t end = PartitionPoint(
+      symbol_count_, [&](uint32_t i) { return SymbolName(i) <= symbol_name; });
+  if (end == 0 || !IsSubSymbol(SymbolName(end - 1), symbol_name)) return -1;
+  return Field(symbols_, kSymbolRecordSize, end - 1, 2);
+}
+
+int64_t MappedDescriptorDatabase::FindExtensionFileIndex(
+    absl::string_view containing_type, int field_number) const {
+  const auto key = [&](uint32_t i) {
+    return std::make_pair(ExtendeeName(i),
+                          static_cast<int>(Field(
+                              extensions_, kExtensionRecordSize, i, 2)));
+  };
+  const auto query = std::make_pair(containing_type, field_number);
+  const uint32_t i = PartitionPoint(
+      extension_count_, [&](uint32_t i) { return key(i) < query; });
+  if (i == extension_count_ || key(i) != query) return -1;
+  return Field(extensions_, kExtensionRecordSize, i, 3);
+}
+
+bool MappedDescriptorDatabase::ParseFile(int64_t index,
+                                         FileDescriptorProto* output) const {
+  if (index < 0 || index >= file_count_) return false;
+  const uint32_t offset =
+      Field(files_, kFileRecordSize, static_cast<uint32_t>(index), 2);
+  const uint32_t size =
+      Field(files_, kFileRecordSize, static_cast<uint32_t>(index), 3);
+  if (offset > image_.size() || size > image_.size() - offset) return false;
+  return internal::ParseNoReflection(image_.substr(offset, size), *output);
+}
+
+bool MappedDescriptorDatabase::FindFileByName(const std::string& filename,
+                                              FileDescriptorProto* output) {
+  return ParseFile(FindFileIndex(filename), output);
+}
+
+bool MappedDescriptorDatabase::FindFileContainingSymbol(
+    const std::string& symbol_name, FileDescriptorProto* output) {
+  return ParseFile(FindSymbolFileIndex(symbol_name), output);
+}
+
+bool MappedDescriptorDatabase::FindNameOfFileContainingSymbol(
+    const std::string& symbol_name, std::string* output) {
+  const int64_t index = FindSymbolFileIndex(symbol_name);
+  if (index < 0 || index >= file_count_) return false;
+  *output = std::string(FileName(static_cast<uint32_t>(index)));
+  return true;
+}
+
+bool MappedDescriptorDatabase::FindFileContainingExtension(
+    const std::string& containing_type, int field_number,
+    FileDescriptorProto* output) {
+  return ParseFile(FindExtensionFileIndex(containing_type, field_number),
+                   output);
+}
+
+bool MappedDescriptorDatabase::FindAllExtensionNumbers(
+    const std::string& extendee_type, std::vector<int>* output) {
+  bool success = false;
+  for (uint32_t i = PartitionPoint(
+           extension_count_,
+           [&](uint32_t i) { return ExtendeeName(i) < extendee_type; });
+       i < extension_count_ && ExtendeeName(i) == extendee_type; ++i) {
+    output->push_back(
+        static_cast<int>(Field(extensions_, kExtensionRecordSize, i, 2)));
+    success = true;
+  }
+  return success;
+}
+
+bool MappedDescriptorDatabase::FindAllFileNames(
+    std::vector<std::string>* output) {
+  for (uint32_t i = 0; i < file_count_; ++i) {
+    output->push_back(std::string(FileName(i)));
+  }
+  return true;
+}
+
 // ===================================================================
 
 DescriptorPoolDatabase::DescriptorPoolDatabase(
@@ -14,11 +14,15 @@
 #ifndef GOOGLE_PROTOBUF_DESCRIPTOR_DATABASE_H__
 #define GOOGLE_PROTOBUF_DESCRIPTOR_DATABASE_H__
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/container/btree_map.h"
+#include "absl/strings/string_view.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/port.h"
 
@@ -31,11 +35,15 @@
 
 namespace google {
 namespace protobuf {
+namespace io {
+class MmapInputStream;
+}  // namespace io
 
 // Defined in this file.
 class DescriptorDatabase;
 class SimpleDescriptorDatabase;
 class EncodedDescriptorDatabase;
+class MappedDescriptorDatabase;
 class DescriptorPoolDatabase;
 class MergedDescriptorDatabase;
 
@@ -286,6 +294,12 @@ class PROTOBUF_EXPORT EncodedDescriptorDatabase : public DescriptorDatabase {
   bool FindNameOfFileContainingSymbol(const std::string& symbol_name,
                                       std::string* output);
 
+  // Writes all files in the database to *output, together with sorted
+  // indexes of their names, symbols and extensions, in the format that
+  // MappedDescriptorDatabase reads in place.  Returns false if the result
+  // would be 4GB or larger.
+  bool SerializeIndexedImage(std::string* output);
+
   // implements DescriptorDatabase -----------------------------------
   bool FindFileByName(const std::string& filename,
                       FileDescriptorProto* output) override;
@@ -311,6 +325,84 @@ class PROTOBUF_EXPORT EncodedDescriptorDatabase : public DescriptorDatabase {
                   FileDescriptorProto* output);
 };
 
+// A read-only database that answers queries directly from an image written by
+// EncodedDescriptorDatabase::SerializeIndexedImage().  The image contains the
+// encoded files and sorted tables of their names, symbols and extensions, so
+// the database builds no index of its own, and opening it takes constant
+// time.  When the image is a mapped file, processes on the same host that
+// open the same file share its pages.
+//
+// Lookups behave like those of the EncodedDescriptorDatabase that wrote the
+// image.  A corrupted image may give wrong answers, but is never read out of
+// bounds.
+class PROTOBUF_EXPORT MappedDescriptorDatabase : public DescriptorDatabase {
+ public:
+  MappedDescriptorDatabase();
+  MappedDescriptorDatabase(const MappedDescriptorDatabase&) = delete;
+  MappedDescriptorDatabase& operator=(const MappedDescriptorDatabase&) =
+      delete;
+  ~MappedDescriptorDatabase() override;
+
+  // Uses the image in `data`, which must remain valid for the life of the
+  // database.  Returns false, leaving the database empty, if `data` does not
+  // start with a supported image header or is too short for its tables.
+  bool Init(const void* data, size_t size);
+
+  // Like Init(), but maps the image from the current offset of the given file
+  // descriptor, which may be closed afterwards.  If the file cannot be mapped,
+  // it is read into memory instead.
+  bool InitFromFile(int file_descriptor);
+
+  // Like FindFileContainingSymbol but returns only the name of the file.
+  bool FindNameOfFileContainingSymbol(const std::string& symbol_name,
+                                      std::string* output);
+
+  // implements DescriptorDatabase -----------------------------------
+  bool FindFileByName(const std::string& filename,
+                      FileDescriptorProto* output) override;
+  bool FindFileContainingSymbol(const std::string& symbol_name,
+                                FileDescriptorProto* output) override;
+  bool FindFileContainingExtension(const std::string& containing_type,
+                                   int field_number,
+                                   FileDescriptorProto* output) override;
+  bool FindAllExtensionNumbers(const std::string& extendee_type,
+                               std::vector<int>* output) override;
+  bool FindAllFileNames(std::vector<std::string>* output) override;
+
+ private:
+  // Returns the index of the file with the given name, the file containing
+  // the given symbol, or the file defining the given extension, or -1.
+  int64_t FindFileIndex(absl::string_view filename) const;
+  int64_t FindSymbolFileIndex(absl::string_view symbol_name) const;
+  int64_t FindExtensionFileIndex(absl::string_view containing_type,
+                                 int field_number) const;
+
+  // Accessors for the fields of table records.  Return an empty string for
+  // strings that are out of bounds.
+  uint32_t Field(const char* table, size_t record_size, uint32_t index,
+                 int field) const;
+  absl::string_view Bytes(uint32_t offset, uint32_t size) const;
+  absl::string_view FileName(uint32_t index) const;
+  absl::string_view SymbolName(uint32_t index) const;
+  absl::string_view ExtendeeName(uint32_t index) const;
+
+  // Parses the file at `index` into *output.  Returns false if `index` is -1
+  // or the file's data is out of bounds or does not parse.
+  bool ParseFile(int64_t index, FileDescriptorProto* output) const;
+
+  absl::string_view image_;
+  uint32_t file_count_ = 0;
+  uint32_t symbol_count_ = 0;
+  uint32_t extension_count_ = 0;
+  const char* files_ = nullptr;
+  const char* symbols_ = nullptr;
+  const char* extensions_ = nullptr;
+
+  // Set by InitFromFile(), to keep the image alive.
+  std::unique_ptr<io::MmapInputStream> mapped_file_;
+  std::string read_file_;
+};
+
 struct PROTOBUF_EXPORT DescriptorPoolDatabaseOptions {
   // If true, the database will preserve source code info when returning
   // descriptors.
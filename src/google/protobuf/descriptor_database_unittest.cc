@@ -13,13 +13,21 @@
 
 #include "google/protobuf/descriptor_database.h"
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #include <algorithm>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "google/protobuf/descriptor.pb.h"
 #include <gmock/gmock.h>
 #include "google/protobuf/testing/googletest.h"
 #include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/test_textproto.h"
 #include "google/protobuf/text_format.h"
@@ -103,6 +111,31 @@ class EncodedDescriptorDatabaseTestCase : public DescriptorDatabaseTestCase {
   EncodedDescriptorDatabase database_;
 };
 
+// Specialization for MappedDescriptorDatabase.  Files are added to an
+// EncodedDescriptorDatabase, whose image is written again after each one.
+class MappedDescriptorDatabaseTestCase : public DescriptorDatabaseTestCase {
+ public:
+  static DescriptorDatabaseTestCase* New() {
+    return new MappedDescriptorDatabaseTestCase;
+  }
+
+  ~MappedDescriptorDatabaseTestCase() override {}
+
+  DescriptorDatabase* GetDatabase() override { return &database_; }
+  bool AddToDatabase(const FileDescriptorProto& file) override {
+    std::string data;
+    file.SerializeToString(&data);
+    if (!source_.AddCopy(data.data(), data.size())) return false;
+    EXPECT_TRUE(source_.SerializeIndexedImage(&image_));
+    return database_.Init(image_.data(), image_.size());
+  }
+
+ private:
+  EncodedDescriptorDatabase source_;
+  std::string image_;
+  MappedDescriptorDatabase database_;
+};
+
 // Specialization for DescriptorPoolDatabase.
 class DescriptorPoolDatabaseTestCase : public DescriptorDatabaseTestCase {
  public:
@@ -452,6 +485,9 @@ INSTANTIATE_TEST_SUITE_P(
 INSTANTIATE_TEST_SUITE_P(
     MemoryConserving, DescriptorDatabaseTest,
     testing::Values(&EncodedDescriptorDatabaseTestCase::New));
+INSTANTIATE_TEST_SUITE_P(
+    Mapped, DescriptorDatabaseTest,
+    testing::Values(&MappedDescriptorDatabaseTestCase::New));
 INSTANTIATE_TEST_SUITE_P(Pool, DescriptorDatabaseTest,
                          testing::Values(&DescriptorPoolDatabaseTestCase::New));
 
@@ -489,6 +525,155 @@ TEST(EncodedDescriptorDatabaseExtraTest, FindNameOfFileContainingSymbol) {
   EXPECT_FALSE(db.FindNameOfFileContainingSymbol("baz.Baz", &filename));
 }
 
+TEST(EncodedDescriptorDatabaseExtraTest, IndexesWithoutFullParse) {
+  FileDescriptorProto file;
+  ASSERT_TRUE(TextFormat::ParseFromString(
+      R"pb(
+        name: "foo.proto"
+        package: "foo"
+        options { java_package: "com.foo" }
+        message_type {
+          name: "Foo"
+          field { name: "a" number: 1 type: TYPE_INT32 }
+          nested_type {
+            name: "Nested"
+            extension { name: "ext" extendee: ".foo.Foo" number: 5 }
+          }
+          extension_range { start: 1 end: 10 }
+        }
+        enum_type {
+          name: "Enum"
+          value { name: "ZERO" number: 0 }
+        }
+        service { name: "Service" }
+      )pb",
+      &file));
+  std::string data = file.SerializeAsString();
+
+  EncodedDescriptorDatabase db;
+  ASSERT_TRUE(db.Add(data.data(), data.size()));
+
+  std::string filename;
+  EXPECT_TRUE(db.FindNameOfFileContainingSymbol("foo.Foo.Nested", &filename));
+  EXPECT_TRUE(db.FindNameOfFileContainingSymbol("foo.Enum", &filename));
+  EXPECT_TRUE(db.FindNameOfFileContainingSymbol("foo.Service", &filename));
+  FileDescriptorProto output;
+  ASSERT_TRUE(db.FindFileContainingExtension("foo.Foo", 5, &output));
+  EXPECT_EQ(output.DebugString(), file.DebugString());
+}
+
+TEST(EncodedDescriptorDatabaseExtraTest, RejectsMalformedData) {
+  FileDescriptorProto file;
+  file.set_name("foo.proto");
+  file.add_message_type()->set_name("Foo");
+  std::string data = file.SerializeAsString();
+
+  EncodedDescriptorDatabase db;
+  // Cuts the message type short.
+  EXPECT_FALSE(db.Add(data.data(), data.size() - 1));
+  // An end-group tag without a group.
+  std::string bad_tag = data + "\x0c";
+  EXPECT_FALSE(db.Add(bad_tag.data(), bad_tag.size()));
+  EXPECT_TRUE(db.Add(data.data(), data.size()));
+}
+
+TEST(MappedDescriptorDatabaseExtraTest, FindNameOfFileContainingSymbol) {
+  FileDescriptorProto file;
+  file.set_name("foo.proto");
+  file.set_package("foo");
+  file.add_message_type()->set_name("Foo");
+  std::string data = file.SerializeAsString();
+
+  EncodedDescriptorDatabase source;
+  ASSERT_TRUE(source.Add(data.data(), data.size()));
+  std::string image;
+  ASSERT_TRUE(source.SerializeIndexedImage(&image));
+
+  MappedDescriptorDatabase db;
+  ASSERT_TRUE(db.Init(image.data(), image.size()));
+  std::string filename;
+  EXPECT_TRUE(db.FindNameOfFileContainingSymbol("foo.Foo", &filename));
+  EXPECT_EQ("foo.proto", filename);
+  EXPECT_TRUE(db.FindNameOfFileContainingSymbol("foo.Foo.Bar", &filename));
+  EXPECT_EQ("foo.proto", filename);
+  EXPECT_FALSE(db.FindNameOfFileContainingSymbol("foo.Food", &filename));
+}
+
+TEST(MappedDescriptorDatabaseExtraTest, RejectsBadImages) {
+  FileDescriptorProto file;
+  file.set_name("foo.proto");
+  file.add_message_type()->set_name("Foo");
+  std::string data = file.SerializeAsString();
+
+  EncodedDescriptorDatabase source;
+  ASSERT_TRUE(source.Add(data.data(), data.size()));
+  std::string image;
+  ASSERT_TRUE(source.SerializeIndexedImage(&image));
+
+  MappedDescriptorDatabase db;
+  EXPECT_FALSE(db.Init(data.data(), data.size()));
+  // Too short for its tables.
+  EXPECT_FALSE(db.Init(image.data(), 30));
+  FileDescriptorProto output;
+  EXPECT_FALSE(db.FindFileByName("foo.proto", &output));
+
+  // The tables are intact, but the symbol name they point to is cut off.
+  std::string filename;
+  ASSERT_TRUE(db.Init(image.data(), image.size() - 1));
+  EXPECT_FALSE(db.FindNameOfFileContainingSymbol("Foo", &filename));
+  EXPECT_TRUE(db.FindFileByName("foo.proto", &output));
+
+  ASSERT_TRUE(db.Init(image.data(), image.size()));
+  ASSERT_TRUE(db.FindFileByName("foo.proto", &output));
+  EXPECT_THAT(output, EqualsProto(file));
+}
+
+#ifndef _WIN32
+TEST(MappedDescriptorDatabaseExtraTest, InitFromFile) {
+  FileDescriptorProto file;
+  ASSERT_TRUE(TextFormat::ParseFromString(
+      R"pb(
+        name: "foo.proto"
+        package: "foo"
+        message_type { name: "Foo" extension_range { start: 1 end: 100 } }
+        extension {
+          name: "bar"
+          extendee: ".foo.Foo"
+          number: 5
+          label: LABEL_OPTIONAL
+          type: TYPE_INT32
+        }
+      )pb",
+      &file));
+  std::string data = file.SerializeAsString();
+  EncodedDescriptorDatabase source;
+  ASSERT_TRUE(source.Add(data.data(), data.size()));
+  std::string image;
+  ASSERT_TRUE(source.SerializeIndexedImage(&image));
+
+  std::string filename = absl::StrCat(::testing::TempDir(),
+                                      "/mapped_descriptor_database_test");
+  int fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0777);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(write(fd, image.data(), image.size()),
+            static_cast<ssize_t>(image.size()));
+  ASSERT_EQ(lseek(fd, 0, SEEK_SET), 0);
+  MappedDescriptorDatabase db;
+  ASSERT_TRUE(db.InitFromFile(fd));
+  close(fd);
+
+  FileDescriptorProto output;
+  ASSERT_TRUE(db.FindFileContainingExtension("foo.Foo", 5, &output));
+  EXPECT_THAT(output, EqualsProto(file));
+  std::vector<int> numbers;
+  EXPECT_TRUE(db.FindAllExtensionNumbers("foo.Foo", &numbers));
+  EXPECT_THAT(numbers, testing::ElementsAre(5));
+  std::vector<std::string> files;
+  EXPECT_TRUE(db.FindAllFileNames(&files));
+  EXPECT_THAT(files, testing::ElementsAre("foo.proto"));
+}
+#endif  // !_WIN32
+
 TEST(SimpleDescriptorDatabaseExtraTest, FindAllFileNames) {
   FileDescriptorProto f;
   f.set_name("foo.proto");
@@ -24,6 +24,7 @@
 #include <limits>
 #include <memory>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -12055,6 +12056,123 @@ TEST_F(ValidationErrorTest, PackageTooLong) {
       "aaaaaaaa: NAME: Package name is too long\n");
 }
 
+// ===================================================================
+// BuildFilesParallel
+
+// Runs every task on a thread of its own.
+class ThreadPerTaskExecutor : public DescriptorPool::Executor {
+ public:
+  ~ThreadPerTaskExecutor() override {
+    for (auto& thread : threads_) thread.join();
+  }
+
+  void Schedule(absl::AnyInvocable<void() &&> task) override {
+    threads_.emplace_back(std::move(task));
+  }
+
+ private:
+  std::vector<std::thread> threads_;
+};
+
+TEST(BuildFilesParallelTest, BuildsFilesAfterTheirDependencies) {
+  FileDescriptorSet file_set;
+  ASSERT_TRUE(TextFormat::ParseFromString(
+      R"pb(
+        file {
+          name: "d.proto"
+          package: "pkg"
+          dependency: "c.proto"
+          message_type {
+            name: "D"
+            field { name: "c" number: 1 label: LABEL_OPTIONAL type_name: "C" }
+          }
+        }
+        file {
+          name: "c.proto"
+          package: "pkg"
+          dependency: "a.proto"
+          dependency: "b.proto"
+          message_type {
+            name: "C"
+            field { name: "a" number: 1 label: LABEL_OPTIONAL type_name: "A" }
+            field { name: "b" number: 2 label: LABEL_OPTIONAL type_name: "B" }
+          }
+        }
+        file {
+          name: "a.proto"
+          package: "pkg"
+          message_type { name: "A" }
+        }
+        file {
+          name: "b.proto"
+          package: "pkg.sub"
+          message_type { name: "B" }
+        }
+      )pb",
+      &file_set));
+
+  for (bool parallel : {false, true}) {
+    SCOPED_TRACE(parallel);
+    DescriptorPool pool;
+    MockErrorCollector error_collector;
+    ThreadPerTaskExecutor executor;
+    std::vector<const FileDescriptor*> files = pool.BuildFilesParallel(
+        file_set, parallel ? &executor : nullptr, &error_collector);
+    EXPECT_EQ(error_collector.text_, "");
+    ASSERT_EQ(files.size(), 4);
+    for (int i = 0; i < 4; ++i) {
+      ASSERT_NE(files[i], nullptr);
+      EXPECT_EQ(files[i]->name(), file_set.file(i).name());
+      EXPECT_EQ(files[i]->pool(), &pool);
+      EXPECT_EQ(pool.FindFileByName(files[i]->name()), files[i]);
+    }
+
+    const Descriptor* c = pool.FindMessageTypeByName("pkg.C");
+    ASSERT_NE(c, nullptr);
+    EXPECT_EQ(c->file(), files[1]);
+    EXPECT_EQ(c->field(0)->message_type(), pool.FindMessageTypeByName("pkg.A"));
+    EXPECT_EQ(c->field(1)->message_type(),
+              pool.FindMessageTypeByName("pkg.sub.B"));
+    EXPECT_EQ(pool.FindFileContainingSymbol("pkg.sub"), files[3]);
+  }
+}
+
+TEST(BuildFilesParallelTest, ReportsErrorsLikeBuildFile) {
+  FileDescriptorSet file_set;
+  ASSERT_TRUE(TextFormat::ParseFromString(
+      R"pb(
+        file {
+          name: "a.proto"
+          package: "pkg"
+          message_type { name: "Foo" }
+        }
+        file {
+          name: "b.proto"
+          package: "pkg"
+          message_type { name: "Foo" }
+        }
+        file { name: "c.proto" dependency: "d.proto" }
+        file { name: "d.proto" dependency: "c.proto" }
+      )pb",
+      &file_set));
+
+  DescriptorPool pool;
+  MockErrorCollector error_collector;
+  ThreadPerTaskExecutor executor;
+  std::vector<const FileDescriptor*> files =
+      pool.BuildFilesParallel(file_set, &executor, &error_collector);
+  ASSERT_EQ(files.size(), 4);
+  EXPECT_NE(files[0], nullptr);
+  EXPECT_EQ(files[1], nullptr);
+  EXPECT_EQ(files[2], nullptr);
+  EXPECT_EQ(files[3], nullptr);
+  EXPECT_THAT(error_collector.text_,
+              testing::StartsWith("b.proto: pkg.Foo: NAME: \"pkg.Foo\" is "
+                                  "already defined in file \"a.proto\".\n"));
+  EXPECT_THAT(error_collector.text_, testing::HasSubstr("c.proto: "));
+  EXPECT_EQ(pool.FindMessageTypeByName("pkg.Foo")->file(), files[0]);
+}
+
 
 // ===================================================================
 // DescriptorDatabase
@@ -55,6 +55,7 @@
 #include "google/protobuf/descriptor.pb.h"
 #include "google/protobuf/extension_set.h"
 #include "google/protobuf/generated_message_reflection.h"
+#include "google/protobuf/generated_message_tctable_impl.h"
 #include "google/protobuf/generated_message_util.h"
 #include "google/protobuf/map_field.h"
 #include "google/protobuf/message_lite.h"
@@ -88,6 +89,26 @@ inline bool InRealOneof(const FieldDescriptor* field) {
   return field->real_containing_oneof() != nullptr;
 }
 
+// Returns true if TcParser can serialize messages of this type from their
+// parse table.  It does not handle the representations of map, weak and lazy
+// fields, nor MessageSets.  Cord fields are excluded because DynamicMessage
+// stores them as plain strings.
+bool CanSerializeWithTable(const Descriptor* type) {
+  if (type->options().message_set_wire_format()) return false;
+  for (int i = 0; i < type->field_count(); i++) {
+    const FieldDescriptor* field = type->field(i);
+    if (field->is_map() || field->options().weak() ||
+        field->options().lazy() || field->options().unverified_lazy()) {
+      return false;
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_STRING &&
+        field->cpp_string_type() == FieldDescriptor::CppStringType::kCord) {
+      return false;
+    }
+  }
+  return true;
+}
+
 // Compute the byte size of the in-memory representation of the field.
 int FieldSpaceUsed(const FieldDescriptor* field) {
   typedef FieldDescriptor FD;  // avoid line wrapping
@@ -206,6 +227,13 @@ class DynamicMessage final : public Message {
 
   const ClassData* GetClassData() const PROTOBUF_FINAL;
 
+#if !defined(PROTOBUF_CUSTOM_VTABLE)
+  size_t ByteSizeLong() const PROTOBUF_FINAL;
+  uint8_t* _InternalSerialize(uint8_t* target,
+                              io::EpsCopyOutputStream* stream) const
+      PROTOBUF_FINAL;
+#endif  // !PROTOBUF_CUSTOM_VTABLE
+
 #if defined(__cpp_lib_destroying_delete) && defined(__cpp_sized_deallocation)
   static void operator delete(DynamicMessage* msg, std::destroying_delete_t);
 #else
@@ -238,6 +266,12 @@ class DynamicMessage final : public Message {
   }
 
   static void DeleteImpl(void* ptr, bool free_memory);
+  // ByteSizeLong() and _InternalSerialize() for types that pass
+  // CanSerializeWithTable().  They walk the reflection-built parse table
+  // instead of going through WireFormat.
+  static size_t TableByteSizeLongImpl(const MessageLite& msg);
+  static uint8_t* TableSerializeImpl(const MessageLite& msg, uint8_t* target,
+                                     io::EpsCopyOutputStream* stream);
 
   void* MutableRaw(int i);
   void* MutableExtensionsRaw();
@@ -264,6 +298,8 @@ struct DynamicMessageFactory::TypeInfo {
   std::unique_ptr<uint32_t[]> offsets;
   std::unique_ptr<uint32_t[]> has_bits_indices;
   int weak_field_map_offset;  // The offset for the weak_field_map;
+  // Whether CanSerializeWithTable() holds for the type.
+  bool serialize_with_table = false;
 
   DynamicMessage::ClassDataFull class_data = {
       DynamicMessage::ClassData{
@@ -623,6 +659,34 @@ const MessageLite::ClassData* DynamicMessage::GetClassData() const {
   return type_info_->class_data.base();
 }
 
+size_t DynamicMessage::TableByteSizeLongImpl(const MessageLite& msg) {
+  const auto& this_ = static_cast<const DynamicMessage&>(msg);
+  return internal::TcParser::ByteSize(this_, this_.GetTcParseTable());
+}
+
+uint8_t* DynamicMessage::TableSerializeImpl(const MessageLite& msg,
+                                            uint8_t* target,
+                                            io::EpsCopyOutputStream* stream) {
+  const auto& this_ = static_cast<const DynamicMessage&>(msg);
+  return internal::TcParser::Serialize(this_, this_.GetTcParseTable(), target,
+                                       stream);
+}
+
+#if !defined(PROTOBUF_CUSTOM_VTABLE)
+size_t DynamicMessage::ByteSizeLong() const {
+  if (type_info_->serialize_with_table) return TableByteSizeLongImpl(*this);
+  return Message::ByteSizeLong();
+}
+
+uint8_t* DynamicMessage::_InternalSerialize(
+    uint8_t* target, io::EpsCopyOutputStream* stream) const {
+  if (type_info_->serialize_with_table) {
+    return TableSerializeImpl(*this, target, stream);
+  }
+  return Message::_InternalSerialize(target, stream);
+}
+#endif  // !PROTOBUF_CUSTOM_VTABLE
+
 // ===================================================================
 
 DynamicMessageFactory::DynamicMessageFactory()
@@ -637,10 +701,30 @@ DynamicMessageFactory::~DynamicMessageFactory() {
   }
 }
 
+struct DynamicMessageFactory::TypeInfoDescriptor {
+  const Descriptor* operator()(const TypeInfo& type_info) const {
+    return type_info.class_data.descriptor;
+  }
+};
+
 const Message* DynamicMessageFactory::GetPrototype(const Descriptor* type) {
   ABSL_CHECK(type != nullptr);
+  // Fast path: the prototype was built before.  This takes no locks.  Types
+  // that may be delegated to the generated factory always take the slow path,
+  // which tries the generated factory first.
+  if (!delegate_to_generated_factory_ ||
+      type->file()->pool() != DescriptorPool::generated_pool()) {
+    if (const TypeInfo* type_info = completed_prototypes_.Find(type)) {
+      return static_cast<const Message*>(type_info->class_data.prototype);
+    }
+  }
   absl::MutexLock lock(&prototypes_mutex_);
-  return GetPrototypeNoLock(type);
+  const Message* result = GetPrototypeNoLock(type);
+  // All TypeInfos created by GetPrototypeNoLock(), including the ones for
+  // recursively referenced types, are complete once it returns.
+  auto it = prototypes_.find(type);
+  if (it != prototypes_.end()) completed_prototypes_.Insert(it->second);
+  return result;
 }
 
 const Message* DynamicMessageFactory::GetPrototypeNoLock(
@@ -798,6 +882,15 @@ const Message* DynamicMessageFactory::GetPrototypeNoLock(
   type_info->class_data.reflection = new Reflection(
       type_info->class_data.descriptor, schema, type_info->pool, this);
 
+  type_info->serialize_with_table = CanSerializeWithTable(type);
+#if defined(PROTOBUF_CUSTOM_VTABLE)
+  if (type_info->serialize_with_table) {
+    type_info->class_data.byte_size_long =
+        &DynamicMessage::TableByteSizeLongImpl;
+    type_info->class_data.serialize = &DynamicMessage::TableSerializeImpl;
+  }
+#endif  // PROTOBUF_CUSTOM_VTABLE
+
   // Cross link prototypes.
   prototype->CrossLinkPrototypes();
 
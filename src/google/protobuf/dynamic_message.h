@@ -25,6 +25,7 @@
 #include "absl/log/absl_log.h"
 #include "absl/synchronization/mutex.h"
 #include "google/protobuf/descriptor.h"
+#include "google/protobuf/lock_free_lookup_map.h"
 #include "google/protobuf/message.h"
 #include "google/protobuf/reflection.h"
 #include "google/protobuf/repeated_field.h"
@@ -121,6 +122,11 @@ class PROTOBUF_EXPORT DynamicMessageFactory : public MessageFactory {
   struct TypeInfo;
   absl::flat_hash_map<const Descriptor*, const TypeInfo*> prototypes_;
   mutable absl::Mutex prototypes_mutex_;
+  // The entries of prototypes_ that are fully constructed, for GetPrototype()
+  // calls that take no locks.
+  struct TypeInfoDescriptor;
+  internal::LockFreeLookupMap<const Descriptor*, TypeInfo, TypeInfoDescriptor>
+      completed_prototypes_;
 
   friend class DynamicMessage;
   const Message* GetPrototypeNoLock(const Descriptor* type);
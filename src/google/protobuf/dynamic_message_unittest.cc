@@ -30,6 +30,7 @@
 #include "google/protobuf/test_util.h"
 #include "google/protobuf/unittest.pb.h"
 #include "google/protobuf/unittest_no_field_presence.pb.h"
+#include "google/protobuf/unknown_field_set.h"
 
 
 namespace google {
@@ -176,6 +177,42 @@ TEST_P(DynamicMessageTest, PackedFields) {
   }
 }
 
+TEST_P(DynamicMessageTest, SerializeMatchesGenerated) {
+  // TestAllExtensions and TestPackedTypes serialize from their parse tables.
+  // TestAllTypes has a lazy field and goes through WireFormat instead.
+  Arena arena;
+  Arena* arena_ptr = GetParam() ? &arena : nullptr;
+
+  std::unique_ptr<Message> owned;
+  Message* message = prototype_->New(arena_ptr);
+  if (!GetParam()) owned.reset(message);
+  TestUtil::ReflectionTester(descriptor_).SetAllFieldsViaReflection(message);
+  unittest::TestAllTypes all_types;
+  ASSERT_TRUE(all_types.ParseFromString(message->SerializeAsString()));
+  EXPECT_EQ(all_types.SerializeAsString(), message->SerializeAsString());
+  EXPECT_EQ(all_types.ByteSizeLong(), message->ByteSizeLong());
+
+  std::unique_ptr<Message> owned_extensions;
+  Message* extensions = extensions_prototype_->New(arena_ptr);
+  if (!GetParam()) owned_extensions.reset(extensions);
+  TestUtil::ReflectionTester reflection_tester(extensions_descriptor_);
+  reflection_tester.SetAllFieldsViaReflection(extensions);
+  std::unique_ptr<Message> parsed(extensions_prototype_->New());
+  ASSERT_TRUE(parsed->ParseFromString(extensions->SerializeAsString()));
+  reflection_tester.ExpectAllFieldsSetViaReflection(*parsed);
+  EXPECT_EQ(parsed->SerializeAsString(), extensions->SerializeAsString());
+
+  std::unique_ptr<Message> owned_packed;
+  Message* packed = packed_prototype_->New(arena_ptr);
+  if (!GetParam()) owned_packed.reset(packed);
+  TestUtil::ReflectionTester(packed_descriptor_)
+      .SetPackedFieldsViaReflection(packed);
+  unittest::TestPackedTypes packed_types;
+  ASSERT_TRUE(packed_types.ParseFromString(packed->SerializeAsString()));
+  EXPECT_EQ(packed_types.SerializeAsString(), packed->SerializeAsString());
+  EXPECT_EQ(packed_types.ByteSizeLong(), packed->ByteSizeLong());
+}
+
 TEST_P(DynamicMessageTest, Oneof) {
   // Check that oneof fields work properly.
   Arena arena;
@@ -313,6 +350,33 @@ TEST_F(DynamicMessageTest, Proto3) {
   delete message;
 }
 
+TEST_F(DynamicMessageTest, ClosedSparseEnum) {
+  // The values of TestSparseEnum are not a single range, so the parse table
+  // validates them against encoded enum data rather than a range check.
+  const Descriptor* desc =
+      pool_.FindMessageTypeByName("protobuf_unittest.SparseEnumMessage");
+  ASSERT_TRUE(desc != nullptr);
+  const FieldDescriptor* sparse_enum = desc->FindFieldByName("sparse_enum");
+  ASSERT_TRUE(sparse_enum != nullptr);
+  std::unique_ptr<Message> message(factory_.GetPrototype(desc)->New());
+  const Reflection* refl = message->GetReflection();
+
+  unittest::SparseEnumMessage generated;
+  generated.set_sparse_enum(unittest::SPARSE_E);
+  ASSERT_TRUE(message->ParseFromString(generated.SerializeAsString()));
+  EXPECT_TRUE(refl->HasField(*message, sparse_enum));
+  EXPECT_EQ(unittest::SPARSE_E, refl->GetEnumValue(*message, sparse_enum));
+  EXPECT_EQ(generated.SerializeAsString(), message->SerializeAsString());
+
+  // 5 is not a value of the enum, so it is kept as an unknown field.
+  ASSERT_TRUE(message->ParseFromString(std::string("\x08\x05", 2)));
+  EXPECT_FALSE(refl->HasField(*message, sparse_enum));
+  const UnknownFieldSet& unknown = refl->GetUnknownFields(*message);
+  ASSERT_EQ(1, unknown.field_count());
+  EXPECT_EQ(1, unknown.field(0).number());
+  EXPECT_EQ(5, unknown.field(0).varint());
+}
+
 INSTANTIATE_TEST_SUITE_P(UseArena, DynamicMessageTest, ::testing::Bool());
 
 
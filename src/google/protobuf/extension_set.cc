@@ -24,6 +24,7 @@
 #include "absl/hash/hash.h"
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
+#include "absl/strings/cord.h"
 #include "google/protobuf/arena.h"
 #include "google/protobuf/extension_set_inl.h"
 #include "google/protobuf/io/coded_stream.h"
@@ -1562,6 +1563,235 @@ bool ExtensionSet::Extension::IsInitialized(const ExtensionSet* ext_set,
 // Dummy key method to avoid weak vtable.
 void ExtensionSet::LazyMessageExtension::UnusedKeyMethod() {}
 
+// Holds the serialized message until it is first accessed. Const accesses
+// parse it into `message_` and keep the bytes, which remain what gets
+// serialized; mutable accesses drop the bytes in favor of the message.
+//
+// The bytes are not verified when parsing the enclosing message, only when
+// first parsed here: if they are invalid, accessors return whatever could be
+// parsed and IsInitialized() returns false.
+class ExtensionSet::LazyMessage final : public LazyMessageExtension {
+ public:
+  explicit LazyMessage(Arena* arena) : arena_(arena) {}
+  ~LazyMessage() override {
+    if (arena_ == nullptr) delete message_.load(std::memory_order_relaxed);
+  }
+
+  LazyMessageExtension* New(Arena* arena) const override {
+    return Arena::Create<LazyMessage>(arena, arena);
+  }
+
+  const MessageLite& GetMessage(const MessageLite& prototype,
+                                Arena*) const override {
+    MessageLite* message = message_.load(std::memory_order_acquire);
+    return message != nullptr ? *message : *Parse(prototype);
+  }
+  const MessageLite& GetMessageIgnoreUnparsed(const MessageLite& prototype,
+                                              Arena*) const override {
+    MessageLite* message = message_.load(std::memory_order_acquire);
+    return message != nullptr ? *message : prototype;
+  }
+  MessageLite* MutableMessage(const MessageLite& prototype, Arena*) override {
+    MessageLite* message = message_.load(std::memory_order_relaxed);
+    if (message == nullptr) message = Parse(prototype);
+    DropUnparsed();
+    return message;
+  }
+
+  void SetAllocatedMessage(MessageLite* message, Arena*) override {
+    Arena* const message_arena = message->GetArena();
+    if (message_arena == nullptr && arena_ != nullptr) {
+      arena_->Own(message);
+    } else if (message_arena != arena_) {
+      MessageLite* copy = message->New(arena_);
+      copy->CheckTypeAndMergeFrom(*message);
+      message = copy;
+    }
+    UnsafeArenaSetAllocatedMessage(message, arena_);
+  }
+  void UnsafeArenaSetAllocatedMessage(MessageLite* message, Arena*) override {
+    if (arena_ == nullptr) delete message_.load(std::memory_order_relaxed);
+    message_.store(message, std::memory_order_relaxed);
+    DropUnparsed();
+  }
+  MessageLite* ReleaseMessage(const MessageLite& prototype,
+                              Arena* arena) override {
+    MessageLite* message = UnsafeArenaReleaseMessage(prototype, arena);
+    if (arena_ != nullptr) {
+      // ReleaseMessage() always returns a heap-allocated message.
+      MessageLite* copy = message->New();
+      copy->CheckTypeAndMergeFrom(*message);
+      message = copy;
+    }
+    return message;
+  }
+  MessageLite* UnsafeArenaReleaseMessage(const MessageLite& prototype,
+                                         Arena*) override {
+    MessageLite* message = message_.load(std::memory_order_relaxed);
+    if (message == nullptr) message = Parse(prototype);
+    message_.store(nullptr, std::memory_order_relaxed);
+    unparsed_.Clear();
+    dirty_ = false;
+    return message;
+  }
+
+  bool IsInitialized(const MessageLite* prototype,
+                     Arena*) const override {
+    MessageLite* message = message_.load(std::memory_order_acquire);
+    if (message == nullptr) {
+      const MessageLite& type = Prototype(prototype);
+      // Bytes of a type without required fields are always initialized, which
+      // avoids parsing them here.
+      if (internal::GetClassData(type)->is_initialized == nullptr) return true;
+      message = Parse(type);
+    }
+    return !parse_failed_.load(std::memory_order_relaxed) &&
+           message->IsInitialized();
+  }
+  bool IsEagerSerializeSafe(const MessageLite*, Arena*) const override {
+    return true;
+  }
+
+  size_t ByteSizeLong() const override {
+    if (!dirty_) return unparsed_.size();
+    return message_.load(std::memory_order_relaxed)->ByteSizeLong();
+  }
+  size_t SpaceUsedLong() const override {
+    // The message is accounted for by its serialized size, as MessageLite
+    // does not know its space used.
+    MessageLite* message = message_.load(std::memory_order_acquire);
+    return sizeof(*this) + unparsed_.size() +
+           (message != nullptr ? message->ByteSizeLong() : 0);
+  }
+
+  void MergeFrom(const MessageLite* prototype,
+                 const LazyMessageExtension& other, Arena*,
+                 Arena* other_arena) override {
+    // Lazy extensions are only created by ParseLazyMessage() and New().
+    const auto& other_lazy = static_cast<const LazyMessage&>(other);
+    if (prototype_ == nullptr) prototype_ = other_lazy.prototype_;
+    if (message_.load(std::memory_order_relaxed) == nullptr &&
+        !other_lazy.dirty_) {
+      // Serialized messages merge by concatenation.
+      unparsed_.Append(other_lazy.unparsed_);
+      return;
+    }
+    const MessageLite& type = Prototype(prototype);
+    MutableMessage(type, arena_)->CheckTypeAndMergeFrom(
+        other_lazy.GetMessage(type, other_arena));
+  }
+  void MergeFromMessage(const MessageLite& msg, Arena*) override {
+    MutableMessage(msg, arena_)->CheckTypeAndMergeFrom(msg);
+  }
+  void Clear() override {
+    MessageLite* message = message_.load(std::memory_order_relaxed);
+    if (message != nullptr) message->Clear();
+    unparsed_.Clear();
+    dirty_ = false;
+  }
+
+  const char* _InternalParse(const MessageLite& prototype, Arena*,
+                             const char* ptr, ParseContext* ctx) override {
+    if (prototype_ == nullptr) prototype_ = &prototype;
+    MessageLite* message = message_.load(std::memory_order_relaxed);
+    if (message != nullptr) {
+      DropUnparsed();
+      return ctx->ParseMessage(message, ptr);
+    }
+    int size = ReadSize(&ptr);
+    GOOGLE_PROTOBUF_PARSER_ASSERT(ptr);
+    // The bytes are a submessage, so they take one level of the recursion
+    // budget even though they are not parsed here.
+    if (ctx->depth() <= 0) return nullptr;
+    if (unparsed_.empty()) return ctx->ReadCord(ptr, size, &unparsed_);
+    absl::Cord more;
+    ptr = ctx->ReadCord(ptr, size, &more);
+    unparsed_.Append(std::move(more));
+    return ptr;
+  }
+  uint8_t* WriteMessageToArray(const MessageLite*, int number,
+                               uint8_t* target,
+                               io::EpsCopyOutputStream* stream) const override {
+    if (!dirty_) {
+      target = stream->EnsureSpace(target);
+      return stream->WriteString(number, unparsed_, target);
+    }
+    const MessageLite& message = *message_.load(std::memory_order_relaxed);
+    return WireFormatLite::InternalWriteMessage(
+        number, message, message.GetCachedSize(), target, stream);
+  }
+
+ private:
+  // `prototype` may be null for extensions not in the generated registry.
+  const MessageLite& Prototype(const MessageLite* prototype) const {
+    ABSL_DCHECK(prototype != nullptr || prototype_ != nullptr);
+    return prototype != nullptr ? *prototype : *prototype_;
+  }
+
+  // Parses `unparsed_` into `message_`, which may race with other const
+  // accesses; the first one to finish wins.
+  MessageLite* Parse(const MessageLite& prototype) const {
+    MessageLite* message = prototype.New(arena_);
+    if (!message->ParsePartialFromCord(unparsed_)) {
+      // The bytes are first verified here. What was parsed of them is
+      // dropped, and the message reports itself uninitialized.
+      ABSL_LOG(ERROR) << "Failed to parse lazy extension of type "
+                      << prototype.GetTypeName();
+      message->Clear();
+      parse_failed_.store(true, std::memory_order_relaxed);
+    }
+    MessageLite* expected = nullptr;
+    if (!message_.compare_exchange_strong(expected, message,
+                                          std::memory_order_acq_rel,
+                                          std::memory_order_acquire)) {
+      if (arena_ == nullptr) delete message;
+      return expected;
+    }
+    return message;
+  }
+
+  // Makes `message_` the value, after a mutable access.
+  void DropUnparsed() {
+    unparsed_.Clear();
+    dirty_ = true;
+  }
+
+  Arena* const arena_;
+  const MessageLite* prototype_ = nullptr;
+  // The value unless `dirty_`.
+  absl::Cord unparsed_;
+  // Set once parsed. The value if `dirty_`, otherwise equal to `unparsed_`.
+  mutable std::atomic<MessageLite*> message_{nullptr};
+  // Set if `unparsed_` failed to parse into `message_`.
+  mutable std::atomic<bool> parse_failed_{false};
+  bool dirty_ = false;
+};
+
+const char* ExtensionSet::ParseLazyMessage(int number,
+                                           const ExtensionInfo& info,
+                                           const char* ptr,
+                                           internal::ParseContext* ctx) {
+  ABSL_DCHECK(info.is_lazy == LazyAnnotation::kLazy);
+  const MessageLite& prototype = *info.message_info.prototype;
+  Extension* extension;
+  if (MaybeNewExtension(number, info.descriptor, &extension)) {
+    extension->type = WireFormatLite::TYPE_MESSAGE;
+    extension->is_repeated = false;
+    extension->is_lazy = true;
+    extension->lazymessage_value = Arena::Create<LazyMessage>(arena_, arena_);
+  } else {
+    ABSL_DCHECK(!extension->is_repeated);
+    ABSL_DCHECK_EQ(cpp_type(extension->type), WireFormatLite::CPPTYPE_MESSAGE);
+  }
+  extension->is_cleared = false;
+  // An extension set through a mutable accessor before parsing stays eager.
+  if (extension->is_lazy) {
+    return extension->lazymessage_value->_InternalParse(prototype, arena_, ptr,
+                                                        ctx);
+  }
+  return ctx->ParseMessage(extension->message_value, ptr);
+}
+
 const ExtensionSet::Extension* ExtensionSet::FindOrNull(int key) const {
   if (flat_size_ == 0) {
     return nullptr;
@@ -624,6 +624,9 @@ class PROTOBUF_EXPORT ExtensionSet {
    private:
     virtual void UnusedKeyMethod();  // Dummy key method to avoid weak vtable.
   };
+  // LazyMessageExtension keeping the serialized message until first access.
+  // Defined in extension_set.cc.
+  class LazyMessage;
   // Give access to function defined below to see LazyMessageExtension.
   static LazyMessageExtension* MaybeCreateLazyExtensionImpl(Arena* arena);
   static LazyMessageExtension* MaybeCreateLazyExtension(Arena* arena) {
@@ -921,6 +924,11 @@ class PROTOBUF_EXPORT ExtensionSet {
                                           internal::InternalMetadata* metadata,
                                           const char* ptr,
                                           internal::ParseContext* ctx);
+  // Parses a singular message extension registered as [lazy = true], keeping
+  // its bytes unparsed until first accessed. Defined after LazyMessage in
+  // extension_set.cc.
+  const char* ParseLazyMessage(int number, const ExtensionInfo& info,
+                               const char* ptr, internal::ParseContext* ctx);
   template <typename Msg, typename T>
   const char* ParseMessageSetItemTmpl(const char* ptr, const Msg* extendee,
                                       internal::InternalMetadata* metadata,
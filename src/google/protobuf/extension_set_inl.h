@@ -163,6 +163,10 @@ const char* ExtensionSet::ParseFieldWithExtensionInfo(
       }
 
       case WireFormatLite::TYPE_MESSAGE: {
+        if (!extension.is_repeated &&
+            extension.is_lazy == LazyAnnotation::kLazy) {
+          return ParseLazyMessage(number, extension, ptr, ctx);
+        }
         MessageLite* value =
             extension.is_repeated
                 ? AddMessage(number, WireFormatLite::TYPE_MESSAGE,
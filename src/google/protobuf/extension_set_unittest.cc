@@ -569,6 +569,84 @@ TEST(ExtensionSetTest, SerializationToStream) {
   TestUtil::ExpectAllFieldsSet(destination);
 }
 
+TEST(ExtensionSetTest, OnlyLazyMessageExtensionsKeepBytes) {
+  // optional_nested_message_extension, which is not [lazy = true], with
+  // bb = 1 as a two byte varint: the bytes are reserialized from the message.
+  const std::string data("\x92\x01\x03\x08\x81\x00", 6);
+  unittest::TestAllExtensions message;
+  ASSERT_TRUE(message.ParseFromString(data));
+  EXPECT_EQ(message.SerializeAsString(),
+            std::string("\x92\x01\x02\x08\x01", 5));
+}
+
+TEST(ExtensionSetTest, LazyMessageExtensionKeepsBytes) {
+  // optional_lazy_message_extension with bb = 1 as a two byte varint, which
+  // serializing the parsed message would shorten.
+  const std::string data("\xda\x01\x03\x08\x81\x00", 6);
+  unittest::TestAllExtensions message;
+  ASSERT_TRUE(message.ParseFromString(data));
+  EXPECT_EQ(message.SerializeAsString(), data);
+
+  // Const access parses the bytes but keeps them.
+  const auto& lazy =
+      message.GetExtension(unittest::optional_lazy_message_extension);
+  EXPECT_EQ(lazy.bb(), 1);
+  EXPECT_EQ(message.SerializeAsString(), data);
+
+  // Mutable access drops them.
+  message.MutableExtension(unittest::optional_lazy_message_extension)
+      ->set_bb(2);
+  EXPECT_EQ(message.SerializeAsString(),
+            std::string("\xda\x01\x02\x08\x02", 5));
+}
+
+TEST(ExtensionSetTest, LazyMessageExtensionMergesBytes) {
+  const std::string data("\xda\x01\x03\x08\x81\x00", 6);
+  Arena arena;
+  auto* message = Arena::Create<unittest::TestAllExtensions>(&arena);
+  ASSERT_TRUE(message->ParseFromString(data + data));
+  EXPECT_EQ(message->SerializeAsString(),
+            std::string("\xda\x01\x06\x08\x81\x00\x08\x81\x00", 9));
+
+  unittest::TestAllExtensions copy;
+  copy.MergeFrom(*message);
+  EXPECT_EQ(copy.SerializeAsString(), message->SerializeAsString());
+  EXPECT_EQ(copy.GetExtension(unittest::optional_lazy_message_extension).bb(),
+            1);
+}
+
+TEST(ExtensionSetTest, LazyMessageExtensionVerifiesBytesOnAccess) {
+  // bb holding a truncated varint.
+  const std::string data("\xda\x01\x02\x08\x80", 5);
+  unittest::TestAllExtensions message;
+  ASSERT_TRUE(message.ParseFromString(data));
+  EXPECT_EQ(message.SerializeAsString(), data);
+  EXPECT_TRUE(message.IsInitialized());
+
+  EXPECT_FALSE(message.GetExtension(unittest::optional_lazy_message_extension)
+                   .has_bb());
+  EXPECT_FALSE(message.IsInitialized());
+}
+
+TEST(ExtensionSetTest, LazyMessageExtensionRespectsRecursionLimit) {
+  const std::string data("\xda\x01\x03\x08\x81\x00", 6);
+  unittest::TestAllExtensions message;
+  {
+    io::CodedInputStream input(
+        reinterpret_cast<const uint8_t*>(data.data()),
+        static_cast<int>(data.size()));
+    input.SetRecursionLimit(0);
+    EXPECT_FALSE(message.ParseFromCodedStream(&input));
+  }
+  {
+    io::CodedInputStream input(
+        reinterpret_cast<const uint8_t*>(data.data()),
+        static_cast<int>(data.size()));
+    input.SetRecursionLimit(1);
+    EXPECT_TRUE(message.ParseFromCodedStream(&input));
+  }
+}
+
 TEST(ExtensionSetTest, PackedSerializationToArray) {
   // Serialize as TestPackedExtensions and parse as TestPackedTypes to insure
   // wire compatibility of extensions.
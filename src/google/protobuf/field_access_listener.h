@@ -145,7 +145,17 @@ struct NoOpAccessListener {
 }  // namespace protobuf
 }  // namespace google
 
-#ifndef REPLACE_PROTO_LISTENER_IMPL
+#if defined(PROTOBUF_FIELD_ACCESS_SAMPLING) && \
+    !defined(REPLACE_PROTO_LISTENER_IMPL)
+#include "google/protobuf/field_access_sampler.h"
+
+namespace google {
+namespace protobuf {
+template <class T>
+using AccessListener = internal::SamplingAccessListener<T>;
+}  // namespace protobuf
+}  // namespace google
+#elif !defined(REPLACE_PROTO_LISTENER_IMPL)
 namespace google {
 namespace protobuf {
 template <class T>
@@ -156,6 +166,6 @@ using AccessListener = NoOpAccessListener<T>;
 // You can put your implementations of hooks/listeners here.
 // All hooks are subject to approval by protobuf-team@.
 
-#endif  // !REPLACE_PROTO_LISTENER_IMPL
+#endif  // PROTOBUF_FIELD_ACCESS_SAMPLING && !REPLACE_PROTO_LISTENER_IMPL
 
 #endif  // GOOGLE_PROTOBUF_FIELD_ACCESS_LISTENER_H__
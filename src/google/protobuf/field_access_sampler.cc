@@ -0,0 +1,144 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/field_access_sampler.h"
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_replace.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+#include "google/protobuf/message_lite.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace internal {
+namespace {
+
+constexpr int32_t kDefaultSampleRate = 100;
+
+// Counters are only ever added, during static initialization of generated
+// code, so a lock free stack is enough.
+PROTOBUF_CONSTINIT std::atomic<MessageAccessCounters*> g_counters{nullptr};
+PROTOBUF_CONSTINIT std::atomic<int32_t> g_sample_rate{kDefaultSampleRate};
+
+// Returns the name of the C++ class generated for `descriptor`, without the
+// leading "::", as profiles name message types.
+std::string CppClassName(const Descriptor* descriptor) {
+  absl::string_view package = descriptor->file()->package();
+  absl::string_view name = descriptor->full_name();
+  if (package.empty()) return absl::StrReplaceAll(name, {{".", "_"}});
+  name.remove_prefix(package.size() + 1);
+  return absl::StrCat(absl::StrReplaceAll(package, {{".", "::"}}), "::",
+                      absl::StrReplaceAll(name, {{".", "_"}}));
+}
+
+}  // namespace
+
+PROTOBUF_THREAD_LOCAL int32_t field_access_countdown = 0;
+
+bool SampleFieldAccessSlow() {
+  const int32_t rate = g_sample_rate.load(std::memory_order_relaxed);
+  if (rate <= 0) {
+    // Disabled; check the rate again only occasionally.
+    field_access_countdown = std::numeric_limits<int32_t>::max();
+    return false;
+  }
+  field_access_countdown = rate;
+  return true;
+}
+
+MessageAccessCounters::MessageAccessCounters(
+    absl::string_view (*name_extractor)(), int field_count)
+    : name_extractor_(name_extractor),
+      field_count_(field_count),
+      present_(new std::atomic<uint64_t>[field_count]()),
+      accesses_(new std::atomic<uint64_t>[field_count]()) {
+  FieldAccessSampler::Register(this);
+}
+
+void MessageAccessCounters::RecordMessage(const MessageLite* msg) {
+  messages_.fetch_add(1, std::memory_order_relaxed);
+  const Message* message = DynamicCastMessage<Message>(msg);
+  if (message == nullptr) return;
+  // Singular fields without presence are listed when they are not zero, and
+  // repeated fields when they are not empty, as they would be serialized.
+  std::vector<const FieldDescriptor*> fields;
+  message->GetReflection()->ListFields(*message, &fields);
+  for (const FieldDescriptor* field : fields) {
+    if (field->is_extension() || field->index() >= field_count_) continue;
+    present_[field->index()].fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void FieldAccessSampler::Register(MessageAccessCounters* counters) {
+  MessageAccessCounters* head = g_counters.load(std::memory_order_relaxed);
+  do {
+    counters->next_ = head;
+  } while (!g_counters.compare_exchange_weak(head, counters,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed));
+}
+
+void FieldAccessSampler::SetSampleRate(int32_t rate) {
+  g_sample_rate.store(rate, std::memory_order_relaxed);
+  field_access_countdown = 0;
+}
+
+void FieldAccessSampler::Reset() {
+  for (MessageAccessCounters* c = g_counters.load(std::memory_order_acquire);
+       c != nullptr; c = c->next_) {
+    c->messages_.store(0, std::memory_order_relaxed);
+    for (int i = 0; i < c->field_count_; ++i) {
+      c->present_[i].store(0, std::memory_order_relaxed);
+      c->accesses_[i].store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+std::string FieldAccessSampler::ProfileToText() {
+  std::string out = "language: \"cpp\"\n";
+  for (MessageAccessCounters* c = g_counters.load(std::memory_order_acquire);
+       c != nullptr; c = c->next_) {
+    const Descriptor* descriptor =
+        DescriptorPool::generated_pool()->FindMessageTypeByName(
+            c->name_extractor_());
+    if (descriptor == nullptr || descriptor->field_count() != c->field_count_) {
+      continue;
+    }
+    std::string fields;
+    bool accessed = false;
+    for (int i = 0; i < c->field_count_; ++i) {
+      const uint64_t present = c->present_[i].load(std::memory_order_relaxed);
+      const uint64_t accesses = c->accesses_[i].load(std::memory_order_relaxed);
+      accessed |= accesses != 0;
+      absl::StrAppend(&fields, "  field { name: \"",
+                      descriptor->field(i)->name(), "\" getters_count: ",
+                      present, " configs_count: ", accesses, " }\n");
+    }
+    const uint64_t messages = c->messages_.load(std::memory_order_relaxed);
+    if (!accessed && messages == 0) continue;
+    absl::StrAppend(&out, "message {\n  name: \"", CppClassName(descriptor),
+                    "\"\n  count: ", messages, "\n", fields, "}\n");
+  }
+  return out;
+}
+
+}  // namespace internal
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
@@ -0,0 +1,234 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// Samples the fields of generated messages and exports how often each one is
+// present and accessed as a field access profile for the C++ code generator.
+//
+// Sampling is compiled in by defining PROTOBUF_FIELD_ACCESS_SAMPLING and
+// generating code with `--cpp_opt=inject_field_listener_events`, which makes
+// AccessListener<T> (see field_access_listener.h) a SamplingAccessListener<T>.
+// At the end of a representative run:
+//
+//   std::string profile = internal::FieldAccessSampler::ProfileToText();
+//
+// The saved profile is fed back with
+// `protoc --cpp_out=field_access_profile=<file>:<dir>`.  It is the text form
+// of the AccessInfo proto read by compiler/cpp/tools/analyze_profile_proto.cc.
+
+#ifndef GOOGLE_PROTOBUF_FIELD_ACCESS_SAMPLER_H__
+#define GOOGLE_PROTOBUF_FIELD_ACCESS_SAMPLER_H__
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "google/protobuf/message_lite.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace internal {
+
+// Sampled counts of one generated message type. Fields are identified by their
+// index in the message descriptor.
+class PROTOBUF_EXPORT MessageAccessCounters {
+ public:
+  MessageAccessCounters(absl::string_view (*name_extractor)(),
+                        int field_count);
+  MessageAccessCounters(const MessageAccessCounters&) = delete;
+  MessageAccessCounters& operator=(const MessageAccessCounters&) = delete;
+
+  // `msg` was parsed, is being serialized or is being merged from, so its
+  // fields are final: counts which of them are present.  Messages without
+  // reflection are only counted.
+  void RecordMessage(const MessageLite* msg);
+  void RecordAccess(int index) {
+    accesses_[index].fetch_add(1, std::memory_order_relaxed);
+  }
+
+ private:
+  friend class FieldAccessSampler;
+
+  absl::string_view (*name_extractor_)();
+  int field_count_;
+  std::atomic<uint64_t> messages_{0};
+  // How many of the sampled messages had each field set.
+  std::unique_ptr<std::atomic<uint64_t>[]> present_;
+  // Sampled accessor calls on each field, of any message.
+  std::unique_ptr<std::atomic<uint64_t>[]> accesses_;
+  // Intrusive list of all counters, see FieldAccessSampler.
+  MessageAccessCounters* next_ = nullptr;
+};
+
+class PROTOBUF_EXPORT FieldAccessSampler {
+ public:
+  // Records one in `rate` accesses. 1 records every access, 0 disables
+  // sampling. The default is 100.
+  static void SetSampleRate(int32_t rate);
+
+  // Zeroes all counters.
+  static void Reset();
+
+  // Returns the profile of all message types that were sampled, as a text
+  // format AccessInfo:
+  //
+  //   language: "cpp"
+  //   message {
+  //     name: "foo::Bar_Nested"  # The C++ class name.
+  //     count: 100               # Sampled messages.
+  //     field { name: "baz" getters_count: 98 configs_count: 310 }
+  //   }
+  //
+  // getters_count is the number of sampled messages that had the field set,
+  // which is what analyze_profile_proto takes as presence.  configs_count is
+  // the number of sampled accessor calls, which it takes as usage.  Class names
+  // are derived from the full names of the types, so types renamed for C++
+  // keywords are not matched.
+  //
+  // Field names are resolved through the generated pool, so only messages
+  // with descriptors are included.
+  static std::string ProfileToText();
+
+ private:
+  friend class MessageAccessCounters;
+
+  static void Register(MessageAccessCounters* counters);
+};
+
+extern PROTOBUF_THREAD_LOCAL int32_t field_access_countdown;
+
+PROTOBUF_EXPORT bool SampleFieldAccessSlow();
+
+inline bool SampleFieldAccess() {
+  if (PROTOBUF_PREDICT_TRUE(--field_access_countdown > 0)) return false;
+  return SampleFieldAccessSlow();
+}
+
+// An AccessListener that samples, per message type, which fields are present
+// in the messages that are parsed, serialized or merged from, and how often
+// each field is accessed.  Every accessor call counts as one access.
+template <typename Proto>
+struct SamplingAccessListener {
+  static constexpr int kFields = Proto::_kInternalFieldNumber;
+
+  // Runs during static initialization of the generated code. Accesses before
+  // that are not recorded.
+  explicit SamplingAccessListener(absl::string_view (*name_extractor)()) {
+    counters_ = new MessageAccessCounters(name_extractor, kFields);
+  }
+
+  static void OnSerialize(const MessageLite* msg) { Message(msg); }
+  // Called once the message has been parsed.
+  static void OnDeserialize(const MessageLite* msg) { Message(msg); }
+  static void OnByteSize(const MessageLite* /*msg*/) {}
+  static void OnMergeFrom(const MessageLite* /*to*/, const MessageLite* from) {
+    Message(from);
+  }
+  static void OnGetMetadata() {}
+
+  template <int kFieldNum>
+  static void OnAdd(const MessageLite* /*msg*/, const void* /*field*/) {
+    Access(kFieldNum);
+  }
+  template <int kFieldNum>
+  static void OnAddMutable(const MessageLite* /*msg*/, const void* /*field*/) {
+    Access(kFieldNum);
+  }
+  template <int kFieldNum>
+  static void OnGet(const MessageLite* /*msg*/, const void* /*field*/) {
+    Access(kFieldNum);
+  }
+  template <int kFieldNum>
+  static void OnClear(const MessageLite* /*msg*/, const void* /*field*/) {
+    Access(kFieldNum);
+  }
+  template <int kFieldNum>
+  static void OnHas(const MessageLite* /*msg*/, const void* /*field*/) {
+    Access(kFieldNum);
+  }
+  template <int kFieldNum>
+  static void OnList(const MessageLite* /*msg*/, const void* /*field*/) {
+    Access(kFieldNum);
+  }
+  template <int kFieldNum>
+  static void OnMutable(const MessageLite* /*msg*/, const void* /*field*/) {
+    Access(kFieldNum);
+  }
+  template <int kFieldNum>
+  static void OnMutableList(const MessageLite* /*msg*/, const void* /*field*/) {
+    Access(kFieldNum);
+  }
+  template <int kFieldNum>
+  static void OnRelease(const MessageLite* /*msg*/, const void* /*field*/) {
+    Access(kFieldNum);
+  }
+  template <int kFieldNum>
+  static void OnSet(const MessageLite* /*msg*/, const void* /*field*/) {
+    Access(kFieldNum);
+  }
+  template <int kFieldNum>
+  static void OnSize(const MessageLite* /*msg*/, const void* /*field*/) {
+    Access(kFieldNum);
+  }
+
+  static void OnUnknownFields(const MessageLite* /*msg*/) {}
+  static void OnMutableUnknownFields(const MessageLite* /*msg*/) {}
+
+  // Extensions are not part of the message layout and are not sampled.
+  static void OnHasExtension(const MessageLite* /*msg*/, int /*extension_tag*/,
+                             const void* /*field*/) {}
+  static void OnClearExtension(const MessageLite* /*msg*/,
+                               int /*extension_tag*/, const void* /*field*/) {}
+  static void OnExtensionSize(const MessageLite* /*msg*/, int /*extension_tag*/,
+                              const void* /*field*/) {}
+  static void OnGetExtension(const MessageLite* /*msg*/, int /*extension_tag*/,
+                             const void* /*field*/) {}
+  static void OnMutableExtension(const MessageLite* /*msg*/,
+                                 int /*extension_tag*/, const void* /*field*/) {
+  }
+  static void OnSetExtension(const MessageLite* /*msg*/, int /*extension_tag*/,
+                             const void* /*field*/) {}
+  static void OnReleaseExtension(const MessageLite* /*msg*/,
+                                 int /*extension_tag*/, const void* /*field*/) {
+  }
+  static void OnAddExtension(const MessageLite* /*msg*/, int /*extension_tag*/,
+                             const void* /*field*/) {}
+  static void OnAddMutableExtension(const MessageLite* /*msg*/,
+                                    int /*extension_tag*/,
+                                    const void* /*field*/) {}
+  static void OnListExtension(const MessageLite* /*msg*/, int /*extension_tag*/,
+                              const void* /*field*/) {}
+  static void OnMutableListExtension(const MessageLite* /*msg*/,
+                                     int /*extension_tag*/,
+                                     const void* /*field*/) {}
+
+ private:
+  static void Message(const MessageLite* msg) {
+    if (counters_ != nullptr && SampleFieldAccess()) {
+      counters_->RecordMessage(msg);
+    }
+  }
+  static void Access(int index) {
+    if (counters_ != nullptr && SampleFieldAccess()) {
+      counters_->RecordAccess(index);
+    }
+  }
+
+  static inline MessageAccessCounters* counters_ = nullptr;
+};
+
+}  // namespace internal
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_FIELD_ACCESS_SAMPLER_H__
@@ -0,0 +1,125 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/field_access_sampler.h"
+
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/strings/string_view.h"
+#include "google/protobuf/unittest.pb.h"
+#include "google/protobuf/unittest_lite.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace internal {
+namespace {
+
+using ::testing::HasSubstr;
+using ::testing::Not;
+using ::testing::StartsWith;
+
+// Stands in for a generated message compiled with field listener events.
+struct FakeForeignMessage {
+  static constexpr int _kInternalFieldNumber = 2;
+};
+
+absl::string_view ForeignMessageName() {
+  return protobuf_unittest::ForeignMessage::descriptor()->full_name();
+}
+
+using Listener = SamplingAccessListener<FakeForeignMessage>;
+
+Listener& GetListener() {
+  static Listener* listener = new Listener(&ForeignMessageName);
+  return *listener;
+}
+
+struct FakeNestedMessage {
+  static constexpr int _kInternalFieldNumber = 1;
+};
+
+absl::string_view NestedMessageName() {
+  return protobuf_unittest::TestAllTypes::NestedMessage::descriptor()
+      ->full_name();
+}
+
+using NestedListener = SamplingAccessListener<FakeNestedMessage>;
+
+TEST(FieldAccessSamplerTest, ProfileToText) {
+  GetListener();
+  FieldAccessSampler::SetSampleRate(1);
+  FieldAccessSampler::Reset();
+
+  protobuf_unittest::ForeignMessage message;
+  message.set_c(1);
+  Listener::OnDeserialize(&message);
+  message.set_d(2);
+  Listener::OnMergeFrom(nullptr, &message);
+  Listener::OnByteSize(&message);
+  Listener::OnGet<0>(nullptr, nullptr);
+  Listener::OnHas<0>(nullptr, nullptr);
+  Listener::OnSet<1>(nullptr, nullptr);
+
+  const std::string profile = FieldAccessSampler::ProfileToText();
+  EXPECT_THAT(profile, StartsWith("language: \"cpp\"\n"));
+  EXPECT_THAT(
+      profile,
+      HasSubstr("message {\n"
+                "  name: \"protobuf_unittest::ForeignMessage\"\n"
+                "  count: 2\n"
+                "  field { name: \"c\" getters_count: 2 configs_count: 2 }\n"
+                "  field { name: \"d\" getters_count: 1 configs_count: 1 }\n"
+                "}\n"));
+}
+
+TEST(FieldAccessSamplerTest, LiteMessagesAreOnlyCounted) {
+  GetListener();
+  FieldAccessSampler::SetSampleRate(1);
+  FieldAccessSampler::Reset();
+
+  protobuf_unittest::ForeignMessageLite message;
+  message.set_c(1);
+  Listener::OnSerialize(&message);
+
+  EXPECT_THAT(
+      FieldAccessSampler::ProfileToText(),
+      HasSubstr("  count: 1\n"
+                "  field { name: \"c\" getters_count: 0 configs_count: 0 }\n"));
+}
+
+TEST(FieldAccessSamplerTest, NestedMessageName) {
+  static NestedListener* listener = new NestedListener(&NestedMessageName);
+  (void)listener;
+  FieldAccessSampler::SetSampleRate(1);
+  FieldAccessSampler::Reset();
+
+  NestedListener::OnGet<0>(nullptr, nullptr);
+
+  EXPECT_THAT(
+      FieldAccessSampler::ProfileToText(),
+      HasSubstr("name: \"protobuf_unittest::TestAllTypes_NestedMessage\""));
+}
+
+TEST(FieldAccessSamplerTest, Disabled) {
+  GetListener();
+  FieldAccessSampler::SetSampleRate(0);
+  FieldAccessSampler::Reset();
+
+  Listener::OnDeserialize(nullptr);
+  Listener::OnGet<0>(nullptr, nullptr);
+
+  EXPECT_THAT(FieldAccessSampler::ProfileToText(),
+              Not(HasSubstr("protobuf_unittest::ForeignMessage")));
+  FieldAccessSampler::SetSampleRate(1);
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace protobuf
+}  // namespace google
@@ -34,6 +34,7 @@
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/descriptor.pb.h"
 #include "google/protobuf/extension_set.h"
+#include "google/protobuf/generated_enum_util.h"
 #include "google/protobuf/generated_message_tctable_decl.h"
 #include "google/protobuf/generated_message_tctable_gen.h"
 #include "google/protobuf/generated_message_tctable_impl.h"
@@ -3308,40 +3309,47 @@ static void PopulateTcParseLookupTable(
 }
 
 void Reflection::PopulateTcParseEntries(
-    internal::TailCallTableInfo& table_info,
+    const internal::TailCallTableInfo& table_info,
     TcParseTableBase::FieldEntry* entries) const {
   for (const auto& entry : table_info.field_entries) {
     const FieldDescriptor* field = entry.field;
-    if (field->type() == field->TYPE_ENUM &&
-        (entry.type_card & internal::field_layout::kTvMask) ==
-            internal::field_layout::kTvEnum &&
-        table_info.aux_entries[entry.aux_idx].type ==
-            internal::TailCallTableInfo::kEnumValidator) {
-      // Mini parse can't handle it. Fallback to reflection.
-      *entries = {};
-      table_info.aux_entries[entry.aux_idx] = {};
+    const OneofDescriptor* oneof = field->real_containing_oneof();
+    entries->offset = schema_.GetFieldOffset(field);
+    if (oneof != nullptr) {
+      entries->has_idx = schema_.oneof_case_offset_ + 4 * oneof->index();
+    } else if (schema_.HasHasbits()) {
+      entries->has_idx =
+          static_cast<int>(8 * schema_.HasBitsOffset() + entry.hasbit_idx);
     } else {
-      const OneofDescriptor* oneof = field->real_containing_oneof();
-      entries->offset = schema_.GetFieldOffset(field);
-      if (oneof != nullptr) {
-        entries->has_idx = schema_.oneof_case_offset_ + 4 * oneof->index();
-      } else if (schema_.HasHasbits()) {
-        entries->has_idx =
-            static_cast<int>(8 * schema_.HasBitsOffset() + entry.hasbit_idx);
-      } else {
-        entries->has_idx = 0;
-      }
-      entries->aux_idx = entry.aux_idx;
-      entries->type_card = entry.type_card;
+      entries->has_idx = 0;
     }
+    entries->aux_idx = entry.aux_idx;
+    entries->type_card = entry.type_card;
 
     ++entries;
   }
 }
 
+// Encodes the values of a closed enum the way generated code does for its
+// validation data, so the table parser can check them without a generated
+// _IsValid function.
+static std::vector<uint32_t> GenerateEnumValidationData(
+    const EnumDescriptor* enum_type) {
+  std::vector<int32_t> values;
+  values.reserve(enum_type->value_count());
+  for (int i = 0; i < enum_type->value_count(); ++i) {
+    values.push_back(enum_type->value(i)->number());
+  }
+  // Aliases repeat values, and declaration order need not be sorted.
+  std::sort(values.begin(), values.end());
+  values.erase(std::unique(values.begin(), values.end()), values.end());
+  return internal::GenerateEnumData(values);
+}
+
 void Reflection::PopulateTcParseFieldAux(
     const internal::TailCallTableInfo& table_info,
-    TcParseTableBase::FieldAux* field_aux) const {
+    TcParseTableBase::FieldAux* field_aux,
+    const uint32_t* const* enum_data) const {
   for (const auto& aux_entry : table_info.aux_entries) {
     switch (aux_entry.type) {
       case internal::TailCallTableInfo::kNothing:
@@ -3380,7 +3388,7 @@ void Reflection::PopulateTcParseFieldAux(
                                    aux_entry.enum_range.size};
         break;
       case internal::TailCallTableInfo::kEnumValidator:
-        ABSL_LOG(FATAL) << "Not supported.";
+        field_aux++->enum_data = *enum_data++;
         break;
       case internal::TailCallTableInfo::kNumericOffset:
         field_aux++->offset = aux_entry.offset;
@@ -3440,12 +3448,27 @@ const internal::TcParseTableBase* Reflection::CreateTcParseTable() const {
   const uint32_t aux_offset = AlignTo<TcParseTableBase::FieldAux>(
       field_entry_offset +
       sizeof(TcParseTableBase::FieldEntry) * fields.size());
-
-  int byte_size =
+  const uint32_t name_data_end =
       aux_offset +
       sizeof(TcParseTableBase::FieldAux) * table_info.aux_entries.size() +
       sizeof(char) * table_info.field_name_data.size();
 
+  // Closed enums that are not a single range are validated with encoded value
+  // sets.  They are stored after the name data, in the same allocation.
+  std::vector<std::vector<uint32_t>> enum_data;
+  size_t enum_data_size = 0;
+  for (const auto& aux_entry : table_info.aux_entries) {
+    if (aux_entry.type == internal::TailCallTableInfo::kEnumValidator) {
+      enum_data.push_back(
+          GenerateEnumValidationData(aux_entry.field->enum_type()));
+      enum_data_size += enum_data.back().size();
+    }
+  }
+  const uint32_t enum_data_offset =
+      enum_data.empty() ? name_data_end : AlignTo<uint32_t>(name_data_end);
+
+  int byte_size = enum_data_offset + sizeof(uint32_t) * enum_data_size;
+
   void* p = ::operator new(byte_size);
   auto* res = ::new (p) TcParseTableBase{
       static_cast<uint16_t>(schema_.HasHasbits() ? schema_.HasBitsOffset() : 0),
@@ -3482,7 +3505,16 @@ const internal::TcParseTableBase* Reflection::CreateTcParseTable() const {
 
   PopulateTcParseEntries(table_info, res->field_entries_begin());
 
-  PopulateTcParseFieldAux(table_info, res->field_aux(0u));
+  std::vector<const uint32_t*> enum_data_p;
+  enum_data_p.reserve(enum_data.size());
+  auto* next_enum_data = reinterpret_cast<uint32_t*>(
+      reinterpret_cast<char*>(res) + enum_data_offset);
+  for (const auto& data : enum_data) {
+    enum_data_p.push_back(next_enum_data);
+    next_enum_data = std::copy(data.begin(), data.end(), next_enum_data);
+  }
+
+  PopulateTcParseFieldAux(table_info, res->field_aux(0u), enum_data_p.data());
 
   // Copy the name data.
   if (!table_info.field_name_data.empty()) {
@@ -3492,6 +3524,9 @@ const internal::TcParseTableBase* Reflection::CreateTcParseTable() const {
   // Validation to make sure we used all the bytes correctly.
   ABSL_CHECK_EQ(res->name_data() + table_info.field_name_data.size() -
                     reinterpret_cast<char*>(res),
+                name_data_end);
+  ABSL_CHECK_EQ(reinterpret_cast<char*>(next_enum_data) -
+                    reinterpret_cast<char*>(res),
                 byte_size);
 
   return res;
@@ -28,6 +28,7 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <cstddef>
 #include <cstdint>
 
 #include "google/protobuf/extension_set.h"
@@ -97,6 +98,32 @@ const char* TcParser::MessageSetWireFormatParseLoop(
       PROTOBUF_TC_PARAM_NO_DATA_PASS);
 }
 
+size_t TcParser::ByteSize(const MessageLite& msg,
+                          const TcParseTableBase* table) {
+  size_t total_size = FieldsByteSize(msg, table);
+  if (PROTOBUF_PREDICT_FALSE(msg._internal_metadata_.have_unknown_fields())) {
+    total_size += WireFormat::ComputeUnknownFieldsSize(
+        msg._internal_metadata_.unknown_fields<UnknownFieldSet>(
+            UnknownFieldSet::default_instance));
+  }
+  RefAt<CachedSize>(&msg, table->class_data->cached_size_offset)
+      .Set(ToCachedSize(total_size));
+  return total_size;
+}
+
+uint8_t* TcParser::Serialize(const MessageLite& msg,
+                             const TcParseTableBase* table, uint8_t* target,
+                             io::EpsCopyOutputStream* stream) {
+  target = SerializeFields(msg, table, target, stream);
+  if (PROTOBUF_PREDICT_FALSE(msg._internal_metadata_.have_unknown_fields())) {
+    target = WireFormat::InternalSerializeUnknownFieldsToArray(
+        msg._internal_metadata_.unknown_fields<UnknownFieldSet>(
+            UnknownFieldSet::default_instance),
+        target, stream);
+  }
+  return target;
+}
+
 }  // namespace internal
 }  // namespace protobuf
 }  // namespace google
@@ -9,8 +9,11 @@
 #define GOOGLE_PROTOBUF_GENERATED_MESSAGE_TCTABLE_IMPL_H__
 
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <memory>
 #include <string>
 #include <type_traits>
 
@@ -20,6 +23,7 @@
 #include "absl/strings/string_view.h"
 #include "google/protobuf/extension_set.h"
 #include "google/protobuf/generated_message_tctable_decl.h"
+#include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/map.h"
 #include "google/protobuf/message_lite.h"
 #include "google/protobuf/metadata_lite.h"
@@ -373,6 +377,66 @@ inline void AlignFail(std::integral_constant<size_t, 1>,
 enum class TcParseFunction : uint8_t { kNone, PROTOBUF_TC_PARSE_FUNCTION_LIST };
 #undef PROTOBUF_TC_PARSE_FUNCTION_X
 
+// A buffer written from its end towards its front, by
+// TcParser::SerializeReverse(). It keeps its memory when cleared, so it can be
+// reused across messages.
+class PROTOBUF_EXPORT ReverseBuffer {
+ public:
+  ReverseBuffer() = default;
+  ReverseBuffer(const ReverseBuffer&) = delete;
+  ReverseBuffer& operator=(const ReverseBuffer&) = delete;
+
+  // The data written so far.
+  const char* data() const { return ptr_; }
+  size_t size() const { return static_cast<size_t>(end_ - ptr_); }
+
+  // Discards the data written so far.
+  void Clear() { ptr_ = end_; }
+  // Discards the data written after the first `size` bytes were.
+  void Truncate(size_t size) { ptr_ = end_ - size; }
+
+  // Returns room for `n` bytes in front of the data written so far.
+  char* Prepend(size_t n) {
+    if (PROTOBUF_PREDICT_FALSE(static_cast<size_t>(ptr_ - begin_) < n)) {
+      Grow(n);
+    }
+    ptr_ -= n;
+    return ptr_;
+  }
+
+  void WriteRaw(const void* data, size_t n) {
+    // `data` may be null if `n` is zero.
+    if (n != 0) std::memcpy(Prepend(n), data, n);
+  }
+  void WriteVarint(uint64_t value) {
+    io::CodedOutputStream::WriteVarint64ToArray(
+        value, reinterpret_cast<uint8_t*>(
+                   Prepend(io::CodedOutputStream::VarintSize64(value))));
+  }
+  void WriteFixed32(uint32_t value) {
+    io::CodedOutputStream::WriteLittleEndian32ToArray(
+        value, reinterpret_cast<uint8_t*>(Prepend(4)));
+  }
+  void WriteFixed64(uint64_t value) {
+    io::CodedOutputStream::WriteLittleEndian64ToArray(
+        value, reinterpret_cast<uint8_t*>(Prepend(8)));
+  }
+  void WriteTag(uint32_t field_num, WireFormatLite::WireType type) {
+    WriteVarint(WireFormatLite::MakeTag(static_cast<int>(field_num), type));
+  }
+  // Writes the length prefix of the data written after the first `start`
+  // bytes were.
+  void WriteLengthSince(size_t start) { WriteVarint(size() - start); }
+
+ private:
+  void Grow(size_t n);
+
+  std::unique_ptr<char[]> buffer_;
+  char* begin_ = nullptr;
+  char* end_ = nullptr;
+  char* ptr_ = nullptr;
+};
+
 // TcParser implements most of the parsing logic for tailcall tables.
 class PROTOBUF_EXPORT TcParser final {
  public:
@@ -439,6 +503,33 @@ class PROTOBUF_EXPORT TcParser final {
       MessageLite* msg, const char* ptr, ParseContext* ctx,
       const TcParseTableBase* table);
 
+  // Table-driven serialization:
+  // These compute the size of a message and serialize it using the field
+  // entries of its parse table, instead of per-field generated code. Messages
+  // generated with the `table_driven_serialization` option call them from
+  // ByteSizeLong() and _InternalSerialize(). Like those, ByteSize() updates
+  // the cached sizes used by Serialize().
+  // The Lite versions are for messages which keep unknown fields as a string,
+  // the others for messages which keep them in an UnknownFieldSet.
+  static size_t ByteSizeLite(const MessageLite& msg,
+                             const TcParseTableBase* table);
+  static size_t ByteSize(const MessageLite& msg, const TcParseTableBase* table);
+  static uint8_t* SerializeLite(const MessageLite& msg,
+                                const TcParseTableBase* table, uint8_t* target,
+                                io::EpsCopyOutputStream* stream);
+  static uint8_t* Serialize(const MessageLite& msg,
+                            const TcParseTableBase* table, uint8_t* target,
+                            io::EpsCopyOutputStream* stream);
+
+  // Writes `msg` in front of the data in `out`, using the field entries of its
+  // parse table like Serialize(), but from its last field to its first. The
+  // size of each submessage is then known when its length prefix is written,
+  // so no ByteSizeLong() pass is needed and no sizes are cached. The output
+  // is that of SerializePartialToString().
+  // Messages whose fields or extensions the tables cannot write are written
+  // with SerializePartialToString() instead; see SerializeFieldsReverse().
+  static void SerializeReverse(const MessageLite& msg, ReverseBuffer& out);
+
   // Functions referenced by generated fast tables (numeric types):
   //   F: fixed      V: varint     Z: zigzag
   //   8/32/64: storage type width (bits)
@@ -884,6 +975,33 @@ class PROTOBUF_EXPORT TcParser final {
 
   class ScopedArenaSwap;
 
+  // Table-driven serialization of the fields and extensions of a message,
+  // shared by the lite and full versions.
+  static size_t FieldsByteSize(const MessageLite& msg,
+                               const TcParseTableBase* table);
+  static uint8_t* SerializeFields(const MessageLite& msg,
+                                  const TcParseTableBase* table,
+                                  uint8_t* target,
+                                  io::EpsCopyOutputStream* stream);
+  static size_t FieldByteSize(const MessageLite& msg,
+                              const TcParseTableBase* table,
+                              const TcParseTableBase::FieldEntry& entry,
+                              uint32_t field_num);
+  static uint8_t* SerializeField(const MessageLite& msg,
+                                 const TcParseTableBase* table,
+                                 const TcParseTableBase::FieldEntry& entry,
+                                 uint32_t field_num, uint8_t* target,
+                                 io::EpsCopyOutputStream* stream);
+  // Return false, after writing some of the fields, if the message has a
+  // field that the table cannot write.
+  static bool SerializeFieldsReverse(const MessageLite& msg,
+                                     const TcParseTableBase* table,
+                                     ReverseBuffer& out);
+  static bool SerializeFieldReverse(const MessageLite& msg,
+                                    const TcParseTableBase* table,
+                                    const TcParseTableBase::FieldEntry& entry,
+                                    uint32_t field_num, ReverseBuffer& out);
+
   struct UnknownFieldOps {
     void (*write_varint)(MessageLite* msg, int number, int value);
     void (*write_length_delimited)(MessageLite* msg, int number,
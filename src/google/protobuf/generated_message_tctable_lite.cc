@@ -10,6 +10,7 @@
 #include <cstdint>
 #include <cstring>
 #include <limits>
+#include <memory>
 #include <new>  // IWYU pragma: keep for operator new
 #include <numeric>
 #include <string>
@@ -19,13 +20,16 @@
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
 #include "absl/numeric/bits.h"
+#include "absl/strings/cord.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "google/protobuf/arenastring.h"
 #include "google/protobuf/generated_enum_util.h"
+#include "google/protobuf/generated_message_util.h"
 #include "google/protobuf/generated_message_tctable_decl.h"
 #include "google/protobuf/generated_message_tctable_impl.h"
 #include "google/protobuf/inlined_string_field.h"
+#include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 #include "google/protobuf/map.h"
 #include "google/protobuf/message_lite.h"
@@ -954,6 +958,23 @@ PROTOBUF_NOINLINE const char* TcParser::FastZ64R2(PROTOBUF_TC_PARAM_DECL) {
       PROTOBUF_TC_PARAM_PASS);
 }
 
+namespace {
+
+// Returns the callback appending packed varints to `field`. Integer fields
+// use PackedVarintAppender, which the parser decodes into in bulk.
+template <bool zigzag, typename FieldType>
+PackedVarintAppender<FieldType, zigzag> PackedVarintAdder(
+    RepeatedField<FieldType>* field) {
+  return {field};
+}
+
+template <bool zigzag>
+auto PackedVarintAdder(RepeatedField<bool>* field) {
+  return [field](uint64_t varint) { field->Add(static_cast<bool>(varint)); };
+}
+
+}  // namespace
+
 template <typename FieldType, typename TagType, bool zigzag>
 PROTOBUF_ALWAYS_INLINE const char* TcParser::PackedVarint(
     PROTOBUF_TC_PARAM_DECL) {
@@ -965,19 +986,7 @@ PROTOBUF_ALWAYS_INLINE const char* TcParser::PackedVarint(
   // pending hasbits now:
   SyncHasbits(msg, hasbits, table);
   auto* field = &RefAt<RepeatedField<FieldType>>(msg, data.offset());
-  return ctx->ReadPackedVarint(ptr, [field](uint64_t varint) {
-    FieldType val;
-    if (zigzag) {
-      if (sizeof(FieldType) == 8) {
-        val = WireFormatLite::ZigZagDecode64(varint);
-      } else {
-        val = WireFormatLite::ZigZagDecode32(varint);
-      }
-    } else {
-      val = varint;
-    }
-    field->Add(val);
-  });
+  return ctx->ReadPackedVarint(ptr, PackedVarintAdder<zigzag>(field));
 }
 
 PROTOBUF_NOINLINE const char* TcParser::FastV8P1(PROTOBUF_TC_PARAM_DECL) {
@@ -1399,6 +1408,30 @@ PROTOBUF_ALWAYS_INLINE inline bool IsValidUTF8(ArenaStringPtr& field) {
   return utf8_range::IsStructurallyValid(field.Get());
 }
 
+// Validates the strings of `field` from index `from` on. Short strings, which
+// the SIMD validator would hand to its scalar tail, are checked together for
+// non-ASCII bytes first and only validated one by one if there are any.
+inline bool IsValidUTF8(const RepeatedPtrField<std::string>& field, int from) {
+  constexpr size_t kShort = 16;
+  uint8_t non_ascii = 0;
+  for (int i = from; i < field.size(); ++i) {
+    const std::string& str = field[i];
+    if (str.size() < kShort) {
+      for (char c : str) non_ascii |= static_cast<uint8_t>(c);
+    } else if (!utf8_range::IsStructurallyValid(str)) {
+      return false;
+    }
+  }
+  if (PROTOBUF_PREDICT_TRUE((non_ascii & 0x80) == 0)) return true;
+  for (int i = from; i < field.size(); ++i) {
+    const std::string& str = field[i];
+    if (str.size() < kShort && !utf8_range::IsStructurallyValid(str)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 
 }  // namespace
 
@@ -1519,7 +1552,10 @@ PROTOBUF_ALWAYS_INLINE const char* TcParser::RepeatedString(
   const auto expected_tag = UnalignedLoad<TagType>(ptr);
   auto& field = RefAt<FieldType>(msg, data.offset());
 
-  const auto validate_last_string = [expected_tag, table, &field] {
+  // The strings of a run of the field are validated together once the run
+  // ends.
+  const int old_size = field.size();
+  const auto validate_new_strings = [expected_tag, table, &field, old_size] {
     switch (utf8) {
       case kNoUtf8:
 #ifdef NDEBUG
@@ -1527,8 +1563,7 @@ PROTOBUF_ALWAYS_INLINE const char* TcParser::RepeatedString(
 #endif
         return true;
       default:
-        if (PROTOBUF_PREDICT_TRUE(
-                utf8_range::IsStructurallyValid(field[field.size() - 1]))) {
+        if (PROTOBUF_PREDICT_TRUE(IsValidUTF8(field, old_size))) {
           return true;
         }
         ReportFastUtf8Error(FastDecodeTag(expected_tag), table);
@@ -1546,7 +1581,7 @@ PROTOBUF_ALWAYS_INLINE const char* TcParser::RepeatedString(
       ptr += sizeof(TagType);
       ptr = ParseRepeatedStringOnce(ptr, serial_arena, ctx, field);
 
-      if (PROTOBUF_PREDICT_FALSE(ptr == nullptr || !validate_last_string())) {
+      if (PROTOBUF_PREDICT_FALSE(ptr == nullptr)) {
         PROTOBUF_MUSTTAIL return Error(PROTOBUF_TC_PARAM_NO_DATA_PASS);
       }
       if (PROTOBUF_PREDICT_FALSE(!ctx->DataAvailable(ptr))) goto parse_loop;
@@ -1556,14 +1591,20 @@ PROTOBUF_ALWAYS_INLINE const char* TcParser::RepeatedString(
       ptr += sizeof(TagType);
       std::string* str = field.Add();
       ptr = InlineGreedyStringParser(str, ptr, ctx);
-      if (PROTOBUF_PREDICT_FALSE(ptr == nullptr || !validate_last_string())) {
+      if (PROTOBUF_PREDICT_FALSE(ptr == nullptr)) {
         PROTOBUF_MUSTTAIL return Error(PROTOBUF_TC_PARAM_NO_DATA_PASS);
       }
       if (PROTOBUF_PREDICT_FALSE(!ctx->DataAvailable(ptr))) goto parse_loop;
     } while (UnalignedLoad<TagType>(ptr) == expected_tag);
   }
+  if (PROTOBUF_PREDICT_FALSE(!validate_new_strings())) {
+    PROTOBUF_MUSTTAIL return Error(PROTOBUF_TC_PARAM_NO_DATA_PASS);
+  }
   PROTOBUF_MUSTTAIL return ToTagDispatch(PROTOBUF_TC_PARAM_NO_DATA_PASS);
 parse_loop:
+  if (PROTOBUF_PREDICT_FALSE(!validate_new_strings())) {
+    PROTOBUF_MUSTTAIL return Error(PROTOBUF_TC_PARAM_NO_DATA_PASS);
+  }
   PROTOBUF_MUSTTAIL return ToParseLoop(PROTOBUF_TC_PARAM_NO_DATA_PASS);
 }
 
@@ -2029,14 +2070,10 @@ const char* TcParser::MpPackedVarintT(PROTOBUF_TC_PARAM_DECL) {
         field->Add(value);
       }
     });
+  } else if (is_zigzag) {
+    return ctx->ReadPackedVarint(ptr, PackedVarintAdder<true>(field));
   } else {
-    return ctx->ReadPackedVarint(ptr, [=](uint64_t value) {
-      field->Add(is_zigzag ? (sizeof(FieldType) == 8
-                                  ? WireFormatLite::ZigZagDecode64(value)
-                                  : WireFormatLite::ZigZagDecode32(
-                                        static_cast<uint32_t>(value)))
-                           : value);
-    });
+    return ctx->ReadPackedVarint(ptr, PackedVarintAdder<false>(field));
   }
 }
 
@@ -2907,6 +2944,931 @@ const char* TcParser::DiscardEverythingFallback(PROTOBUF_TC_PARAM_DECL) {
   return UnknownFieldParse(tag, nullptr, ptr, ctx);
 }
 
+//////////////////////////////////////////////////////////////////////////////
+// Table-driven serialization:
+//////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Calls `f(field_number, entry)` for each field entry of `table`, in field
+// number order. See the field lookup table layout above.
+template <typename F>
+PROTOBUF_ALWAYS_INLINE void ForEachFieldEntry(const TcParseTableBase* table,
+                                              F f) {
+  const FieldEntry* const field_entries = table->field_entries_begin();
+  const FieldEntry* entry = field_entries;
+  for (uint32_t present = ~table->skipmap32; present != 0;
+       present &= present - 1) {
+    f(static_cast<uint32_t>(absl::countr_zero(present)) + 1, *entry++);
+  }
+  const uint16_t* lookup_table = table->field_lookup_begin();
+  for (;;) {
+    const uint32_t fstart =
+        lookup_table[0] | (static_cast<uint32_t>(lookup_table[1]) << 16);
+    if (fstart == 0xFFFFFFFF) return;  // The end of the table.
+    const uint32_t num_skip_entries = lookup_table[2];
+    lookup_table += 3;
+    for (uint32_t i = 0; i < num_skip_entries; ++i, lookup_table += 2) {
+      entry = field_entries + lookup_table[1];
+      for (uint32_t present = ~static_cast<uint32_t>(lookup_table[0]) & 0xFFFF;
+           present != 0; present &= present - 1) {
+        f(fstart + 16 * i + static_cast<uint32_t>(absl::countr_zero(present)),
+          *entry++);
+      }
+    }
+  }
+}
+
+// Returns the object holding the field of `entry`: the message itself, or its
+// split part.
+const void* GetFieldBase(const MessageLite& msg, const TcParseTableBase* table,
+                         const FieldEntry& entry) {
+  if (entry.type_card & field_layout::kSplitMask) {
+    return TcParser::RefAt<const void*>(&msg, GetSplitOffset(table));
+  }
+  return &msg;
+}
+
+template <typename T>
+const T& GetRepeated(const void* base, const FieldEntry& entry) {
+  // Repeated fields of the split part are pointers. Until a field is first
+  // added to, it points to a zeroed buffer that reads as an empty container.
+  if (entry.type_card & field_layout::kSplitMask) {
+    return *static_cast<const T*>(
+        TcParser::RefAt<const void*>(base, entry.offset));
+  }
+  return TcParser::RefAt<T>(base, entry.offset);
+}
+
+bool IsZigZag(uint16_t type_card) {
+  return (type_card & field_layout::kTvMask) == field_layout::kTvZigZag;
+}
+
+bool IsUnsigned(uint16_t type_card) {
+  return (type_card & field_layout::kFmtMask) == field_layout::kFmtUnsigned;
+}
+
+// Returns whether a string field is checked for valid UTF-8 when serialized.
+// Like generated code, invalid data is only logged.
+bool IsUtf8Checked(uint16_t type_card) {
+  const uint16_t xform_val = type_card & field_layout::kTvMask;
+#ifdef NDEBUG
+  return xform_val == field_layout::kTvUtf8;
+#else   // NDEBUG
+  return xform_val == field_layout::kTvUtf8 ||
+         xform_val == field_layout::kTvUtf8Debug;
+#endif  // !NDEBUG
+}
+
+// Returns whether a singular field is set. Fields without presence are set if
+// their value is not the default.
+bool HasField(const MessageLite& msg, const void* base,
+              const FieldEntry& entry, uint32_t field_num) {
+  namespace fl = field_layout;
+  const uint16_t type_card = entry.type_card;
+  switch (type_card & fl::kFcMask) {
+    case fl::kFcOptional: {
+      const auto has_idx = static_cast<uint32_t>(entry.has_idx);
+      const uint32_t hasblock = TcParser::RefAt<uint32_t>(&msg, has_idx / 32 * 4);
+      return (hasblock >> (has_idx % 32)) & 1;
+    }
+    case fl::kFcOneof:
+      // The _oneof_case_ value offset is stored in the has-bit index.
+      return TcParser::RefAt<uint32_t>(&msg, entry.has_idx) == field_num;
+    default:
+      break;
+  }
+
+  switch (type_card & fl::kFkMask) {
+    case fl::kFkVarint:
+    case fl::kFkFixed:
+      // Floating point values are compared bitwise, so -0.0 is serialized.
+      switch (type_card & fl::kRepMask) {
+        case fl::kRep8Bits:
+          return TcParser::RefAt<uint8_t>(base, entry.offset) != 0;
+        case fl::kRep32Bits:
+          return TcParser::RefAt<uint32_t>(base, entry.offset) != 0;
+        default:
+          return TcParser::RefAt<uint64_t>(base, entry.offset) != 0;
+      }
+    case fl::kFkString:
+      switch (type_card & fl::kRepMask) {
+        case fl::kRepAString:
+          return !TcParser::RefAt<ArenaStringPtr>(base, entry.offset)
+                      .Get()
+                      .empty();
+        case fl::kRepIString:
+          return !TcParser::RefAt<InlinedStringField>(base, entry.offset)
+                      .Get()
+                      .empty();
+        case fl::kRepCord:
+          return !TcParser::RefAt<absl::Cord>(base, entry.offset).empty();
+        default:
+          Unreachable();
+      }
+    case fl::kFkMessage:
+      return TcParser::RefAt<const MessageLite*>(base, entry.offset) != nullptr;
+    default:
+      Unreachable();
+  }
+}
+
+// Returns the value of a singular varint field as it is encoded.
+uint64_t GetVarint(const void* base, const FieldEntry& entry) {
+  namespace fl = field_layout;
+  const uint16_t type_card = entry.type_card;
+  switch (type_card & fl::kRepMask) {
+    case fl::kRep8Bits:
+      return TcParser::RefAt<uint8_t>(base, entry.offset);
+    case fl::kRep32Bits: {
+      const uint32_t value = TcParser::RefAt<uint32_t>(base, entry.offset);
+      if (IsZigZag(type_card)) {
+        return WireFormatLite::ZigZagEncode32(static_cast<int32_t>(value));
+      }
+      if (IsUnsigned(type_card)) return value;
+      // int32 and enum values are sign-extended.
+      return static_cast<uint64_t>(int64_t{static_cast<int32_t>(value)});
+    }
+    default: {
+      const uint64_t value = TcParser::RefAt<uint64_t>(base, entry.offset);
+      if (IsZigZag(type_card)) {
+        return WireFormatLite::ZigZagEncode64(static_cast<int64_t>(value));
+      }
+      return value;
+    }
+  }
+}
+
+// Returns the encoded size of the values of a repeated varint field, without
+// tags, and sets `count` to the number of values.
+size_t RepeatedVarintSize(const void* base, const FieldEntry& entry,
+                          int& count) {
+  namespace fl = field_layout;
+  const uint16_t type_card = entry.type_card;
+  switch (type_card & fl::kRepMask) {
+    case fl::kRep8Bits:
+      count = GetRepeated<RepeatedField<bool>>(base, entry).size();
+      return static_cast<size_t>(count);
+    case fl::kRep32Bits: {
+      if (IsUnsigned(type_card)) {
+        const auto& field = GetRepeated<RepeatedField<uint32_t>>(base, entry);
+        count = field.size();
+        return WireFormatLite::UInt32Size(field);
+      }
+      const auto& field = GetRepeated<RepeatedField<int32_t>>(base, entry);
+      count = field.size();
+      return IsZigZag(type_card) ? WireFormatLite::SInt32Size(field)
+                                 : WireFormatLite::Int32Size(field);
+    }
+    default: {
+      if (IsZigZag(type_card)) {
+        const auto& field = GetRepeated<RepeatedField<int64_t>>(base, entry);
+        count = field.size();
+        return WireFormatLite::SInt64Size(field);
+      }
+      const auto& field = GetRepeated<RepeatedField<uint64_t>>(base, entry);
+      count = field.size();
+      return WireFormatLite::UInt64Size(field);
+    }
+  }
+}
+
+// Returns the number of values of a repeated fixed field.
+int RepeatedFixedCount(const void* base, const FieldEntry& entry) {
+  if ((entry.type_card & field_layout::kRepMask) == field_layout::kRep32Bits) {
+    return GetRepeated<RepeatedField<uint32_t>>(base, entry).size();
+  }
+  return GetRepeated<RepeatedField<uint64_t>>(base, entry).size();
+}
+
+size_t FixedSize(uint16_t type_card) {
+  return (type_card & field_layout::kRepMask) == field_layout::kRep32Bits ? 4
+                                                                          : 8;
+}
+
+template <typename T, typename Encode>
+uint8_t* WriteRepeatedVarint(uint32_t field_num, const RepeatedField<T>& field,
+                             Encode encode, uint8_t* target,
+                             io::EpsCopyOutputStream* stream) {
+  for (const T& value : field) {
+    target = stream->EnsureSpace(target);
+    target = WireFormatLite::WriteUInt64ToArray(field_num, encode(value),
+                                                target);
+  }
+  return target;
+}
+
+template <typename T>
+uint8_t* WriteRepeatedFixed(uint32_t field_num, const RepeatedField<T>& field,
+                            uint8_t* target, io::EpsCopyOutputStream* stream) {
+  for (const T& value : field) {
+    target = stream->EnsureSpace(target);
+    if constexpr (sizeof(T) == 4) {
+      target = WireFormatLite::WriteFixed32ToArray(field_num, value, target);
+    } else {
+      target = WireFormatLite::WriteFixed64ToArray(field_num, value, target);
+    }
+  }
+  return target;
+}
+
+}  // namespace
+
+size_t TcParser::FieldByteSize(const MessageLite& msg,
+                               const TcParseTableBase* table,
+                               const FieldEntry& entry, uint32_t field_num) {
+  namespace fl = field_layout;
+  const uint16_t type_card = entry.type_card;
+  const void* const base = GetFieldBase(msg, table, entry);
+  const size_t tag_size = io::CodedOutputStream::VarintSize32(field_num << 3);
+
+  if ((type_card & fl::kFcMask) != fl::kFcRepeated) {
+    if (!HasField(msg, base, entry, field_num)) return 0;
+    switch (type_card & fl::kFkMask) {
+      case fl::kFkVarint:
+        return tag_size +
+               io::CodedOutputStream::VarintSize64(GetVarint(base, entry));
+      case fl::kFkFixed:
+        return tag_size + FixedSize(type_card);
+      case fl::kFkString: {
+        size_t size;
+        switch (type_card & fl::kRepMask) {
+          case fl::kRepAString:
+            size = RefAt<ArenaStringPtr>(base, entry.offset).Get().size();
+            break;
+          case fl::kRepIString:
+            size = RefAt<InlinedStringField>(base, entry.offset).Get().size();
+            break;
+          case fl::kRepCord:
+            size = (type_card & fl::kFcMask) == fl::kFcOneof
+                       ? RefAt<const absl::Cord*>(base, entry.offset)->size()
+                       : RefAt<absl::Cord>(base, entry.offset).size();
+            break;
+          default:
+            Unreachable();
+        }
+        return tag_size + WireFormatLite::LengthDelimitedSize(size);
+      }
+      case fl::kFkMessage: {
+        const MessageLite* value =
+            RefAt<const MessageLite*>(base, entry.offset);
+        if ((type_card & fl::kRepMask) == fl::kRepGroup) {
+          return 2 * tag_size + value->ByteSizeLong();
+        }
+        return tag_size +
+               WireFormatLite::LengthDelimitedSize(value->ByteSizeLong());
+      }
+      default:
+        Unreachable();
+    }
+  }
+
+  switch (type_card & fl::kFkMask) {
+    case fl::kFkVarint: {
+      int count;
+      const size_t size = RepeatedVarintSize(base, entry, count);
+      return static_cast<size_t>(count) * tag_size + size;
+    }
+    case fl::kFkPackedVarint: {
+      int count;
+      const size_t size = RepeatedVarintSize(base, entry, count);
+      if (size == 0) return 0;
+      return tag_size + WireFormatLite::LengthDelimitedSize(size);
+    }
+    case fl::kFkFixed:
+      return static_cast<size_t>(RepeatedFixedCount(base, entry)) *
+             (tag_size + FixedSize(type_card));
+    case fl::kFkPackedFixed: {
+      const int count = RepeatedFixedCount(base, entry);
+      if (count == 0) return 0;
+      return tag_size + WireFormatLite::LengthDelimitedSize(
+                            static_cast<size_t>(count) * FixedSize(type_card));
+    }
+    case fl::kFkString: {
+      size_t size = 0;
+      if ((type_card & fl::kRepMask) == fl::kRepCord) {
+        const auto& field = GetRepeated<RepeatedField<absl::Cord>>(base, entry);
+        for (const absl::Cord& value : field) {
+          size += tag_size + WireFormatLite::LengthDelimitedSize(value.size());
+        }
+      } else {
+        ABSL_DCHECK_EQ(type_card & fl::kRepMask, +fl::kRepSString);
+        const auto& field =
+            GetRepeated<RepeatedPtrField<std::string>>(base, entry);
+        for (const std::string& value : field) {
+          size += tag_size + WireFormatLite::LengthDelimitedSize(value.size());
+        }
+      }
+      return size;
+    }
+    case fl::kFkMessage: {
+      const auto& field = GetRepeated<RepeatedPtrFieldBase>(base, entry);
+      const bool is_group = (type_card & fl::kRepMask) == fl::kRepGroup;
+      size_t size = 0;
+      for (int i = 0, n = field.size(); i < n; ++i) {
+        const size_t value_size =
+            field.Get<GenericTypeHandler<MessageLite>>(i).ByteSizeLong();
+        size += is_group
+                    ? 2 * tag_size + value_size
+                    : tag_size + WireFormatLite::LengthDelimitedSize(value_size);
+      }
+      return size;
+    }
+    default:
+      Unreachable();
+  }
+}
+
+uint8_t* TcParser::SerializeField(const MessageLite& msg,
+                                  const TcParseTableBase* table,
+                                  const FieldEntry& entry, uint32_t field_num,
+                                  uint8_t* target,
+                                  io::EpsCopyOutputStream* stream) {
+  namespace fl = field_layout;
+  const uint16_t type_card = entry.type_card;
+  const void* const base = GetFieldBase(msg, table, entry);
+  const auto verify_utf8 = [&](const std::string& value) {
+    if (IsUtf8Checked(type_card) &&
+        !utf8_range::IsStructurallyValid(value)) {
+      PrintUTF8ErrorLog(MessageName(table), FieldName(table, &entry),
+                        "serializing", false);
+    }
+  };
+
+  if ((type_card & fl::kFcMask) != fl::kFcRepeated) {
+    if (!HasField(msg, base, entry, field_num)) return target;
+    switch (type_card & fl::kFkMask) {
+      case fl::kFkVarint:
+        target = stream->EnsureSpace(target);
+        return WireFormatLite::WriteUInt64ToArray(
+            field_num, GetVarint(base, entry), target);
+      case fl::kFkFixed:
+        target = stream->EnsureSpace(target);
+        if ((type_card & fl::kRepMask) == fl::kRep32Bits) {
+          return WireFormatLite::WriteFixed32ToArray(
+              field_num, RefAt<uint32_t>(base, entry.offset), target);
+        }
+        return WireFormatLite::WriteFixed64ToArray(
+            field_num, RefAt<uint64_t>(base, entry.offset), target);
+      case fl::kFkString:
+        switch (type_card & fl::kRepMask) {
+          case fl::kRepAString: {
+            const std::string& value =
+                RefAt<ArenaStringPtr>(base, entry.offset).Get();
+            verify_utf8(value);
+            return stream->WriteStringMaybeAliased(field_num, value, target);
+          }
+          case fl::kRepIString: {
+            const std::string& value =
+                RefAt<InlinedStringField>(base, entry.offset).Get();
+            verify_utf8(value);
+            return stream->WriteStringMaybeAliased(field_num, value, target);
+          }
+          case fl::kRepCord:
+            return stream->WriteString(
+                field_num,
+                (type_card & fl::kFcMask) == fl::kFcOneof
+                    ? *RefAt<const absl::Cord*>(base, entry.offset)
+                    : RefAt<absl::Cord>(base, entry.offset),
+                target);
+          default:
+            Unreachable();
+        }
+      case fl::kFkMessage: {
+        const MessageLite& value =
+            *RefAt<const MessageLite*>(base, entry.offset);
+        if ((type_card & fl::kRepMask) == fl::kRepGroup) {
+          return WireFormatLite::InternalWriteGroup(field_num, value, target,
+                                                    stream);
+        }
+        return WireFormatLite::InternalWriteMessage(
+            field_num, value, value.GetCachedSize(), target, stream);
+      }
+      default:
+        Unreachable();
+    }
+  }
+
+  switch (type_card & fl::kFkMask) {
+    case fl::kFkVarint:
+      switch (type_card & fl::kRepMask) {
+        case fl::kRep8Bits:
+          return WriteRepeatedVarint(
+              field_num, GetRepeated<RepeatedField<bool>>(base, entry),
+              [](bool v) { return uint64_t{v}; }, target, stream);
+        case fl::kRep32Bits:
+          if (IsZigZag(type_card)) {
+            return WriteRepeatedVarint(
+                field_num, GetRepeated<RepeatedField<int32_t>>(base, entry),
+                WireFormatLite::ZigZagEncode32, target, stream);
+          }
+          if (IsUnsigned(type_card)) {
+            return WriteRepeatedVarint(
+                field_num, GetRepeated<RepeatedField<uint32_t>>(base, entry),
+                [](uint32_t v) { return uint64_t{v}; }, target, stream);
+          }
+          return WriteRepeatedVarint(
+              field_num, GetRepeated<RepeatedField<int32_t>>(base, entry),
+              [](int32_t v) { return static_cast<uint64_t>(int64_t{v}); },
+              target, stream);
+        default:
+          if (IsZigZag(type_card)) {
+            return WriteRepeatedVarint(
+                field_num, GetRepeated<RepeatedField<int64_t>>(base, entry),
+                WireFormatLite::ZigZagEncode64, target, stream);
+          }
+          return WriteRepeatedVarint(
+              field_num, GetRepeated<RepeatedField<uint64_t>>(base, entry),
+              [](uint64_t v) { return v; }, target, stream);
+      }
+    case fl::kFkPackedVarint: {
+      int count;
+      const int size =
+          static_cast<int>(RepeatedVarintSize(base, entry, count));
+      if (size == 0) return target;
+      switch (type_card & fl::kRepMask) {
+        case fl::kRep8Bits:
+          // Each value takes a single byte.
+          return stream->WriteFixedPacked(
+              field_num, GetRepeated<RepeatedField<bool>>(base, entry),
+              target);
+        case fl::kRep32Bits:
+          if (IsZigZag(type_card)) {
+            return stream->WriteSInt32Packed(
+                field_num, GetRepeated<RepeatedField<int32_t>>(base, entry),
+                size, target);
+          }
+          if (IsUnsigned(type_card)) {
+            return stream->WriteUInt32Packed(
+                field_num, GetRepeated<RepeatedField<uint32_t>>(base, entry),
+                size, target);
+          }
+          return stream->WriteInt32Packed(
+              field_num, GetRepeated<RepeatedField<int32_t>>(base, entry),
+              size, target);
+        default:
+          if (IsZigZag(type_card)) {
+            return stream->WriteSInt64Packed(
+                field_num, GetRepeated<RepeatedField<int64_t>>(base, entry),
+                size, target);
+          }
+          return stream->WriteUInt64Packed(
+              field_num, GetRepeated<RepeatedField<uint64_t>>(base, entry),
+              size, target);
+      }
+    }
+    case fl::kFkFixed:
+      if ((type_card & fl::kRepMask) == fl::kRep32Bits) {
+        return WriteRepeatedFixed(
+            field_num, GetRepeated<RepeatedField<uint32_t>>(base, entry),
+            target, stream);
+      }
+      return WriteRepeatedFixed(
+          field_num, GetRepeated<RepeatedField<uint64_t>>(base, entry), target,
+          stream);
+    case fl::kFkPackedFixed:
+      if ((type_card & fl::kRepMask) == fl::kRep32Bits) {
+        const auto& field = GetRepeated<RepeatedField<uint32_t>>(base, entry);
+        if (field.empty()) return target;
+        return stream->WriteFixedPacked(field_num, field, target);
+      } else {
+        const auto& field = GetRepeated<RepeatedField<uint64_t>>(base, entry);
+        if (field.empty()) return target;
+        return stream->WriteFixedPacked(field_num, field, target);
+      }
+    case fl::kFkString:
+      if ((type_card & fl::kRepMask) == fl::kRepCord) {
+        for (const absl::Cord& value :
+             GetRepeated<RepeatedField<absl::Cord>>(base, entry)) {
+          target = stream->WriteString(field_num, value, target);
+        }
+      } else {
+        for (const std::string& value :
+             GetRepeated<RepeatedPtrField<std::string>>(base, entry)) {
+          verify_utf8(value);
+          target = stream->WriteString(field_num, value, target);
+        }
+      }
+      return target;
+    case fl::kFkMessage: {
+      const auto& field = GetRepeated<RepeatedPtrFieldBase>(base, entry);
+      const bool is_group = (type_card & fl::kRepMask) == fl::kRepGroup;
+      for (int i = 0, n = field.size(); i < n; ++i) {
+        const MessageLite& value = field.Get<GenericTypeHandler<MessageLite>>(i);
+        target = is_group
+                     ? WireFormatLite::InternalWriteGroup(field_num, value,
+                                                          target, stream)
+                     : WireFormatLite::InternalWriteMessage(
+                           field_num, value, value.GetCachedSize(), target,
+                           stream);
+      }
+      return target;
+    }
+    default:
+      Unreachable();
+  }
+}
+
+size_t TcParser::FieldsByteSize(const MessageLite& msg,
+                                const TcParseTableBase* table) {
+  size_t total_size = 0;
+  if (table->extension_offset != 0) {
+    total_size += RefAt<ExtensionSet>(&msg, table->extension_offset).ByteSize();
+  }
+  ForEachFieldEntry(table, [&](uint32_t field_num, const FieldEntry& entry) {
+    total_size += FieldByteSize(msg, table, entry, field_num);
+  });
+  return total_size;
+}
+
+uint8_t* TcParser::SerializeFields(const MessageLite& msg,
+                                   const TcParseTableBase* table,
+                                   uint8_t* target,
+                                   io::EpsCopyOutputStream* stream) {
+  if (table->extension_offset == 0) {
+    ForEachFieldEntry(table, [&](uint32_t field_num, const FieldEntry& entry) {
+      target = SerializeField(msg, table, entry, field_num, target, stream);
+    });
+    return target;
+  }
+
+  // Extensions are written in field number order with the fields.
+  const ExtensionSet& extensions =
+      RefAt<ExtensionSet>(&msg, table->extension_offset);
+  const MessageLite* extendee = table->class_data->prototype;
+  int next_number = 1;
+  ForEachFieldEntry(table, [&](uint32_t field_num, const FieldEntry& entry) {
+    const int number = static_cast<int>(field_num);
+    if (next_number < number) {
+      target = extensions._InternalSerialize(extendee, next_number, number,
+                                             target, stream);
+    }
+    next_number = number + 1;
+    target = SerializeField(msg, table, entry, field_num, target, stream);
+  });
+  return extensions._InternalSerialize(extendee, next_number,
+                                       std::numeric_limits<int>::max(),
+                                       target, stream);
+}
+
+size_t TcParser::ByteSizeLite(const MessageLite& msg,
+                              const TcParseTableBase* table) {
+  size_t total_size = FieldsByteSize(msg, table);
+  if (PROTOBUF_PREDICT_FALSE(msg._internal_metadata_.have_unknown_fields())) {
+    total_size += msg._internal_metadata_
+                      .unknown_fields<std::string>(&GetEmptyString)
+                      .size();
+  }
+  RefAt<CachedSize>(&msg, table->class_data->cached_size_offset)
+      .Set(ToCachedSize(total_size));
+  return total_size;
+}
+
+uint8_t* TcParser::SerializeLite(const MessageLite& msg,
+                                 const TcParseTableBase* table,
+                                 uint8_t* target,
+                                 io::EpsCopyOutputStream* stream) {
+  target = SerializeFields(msg, table, target, stream);
+  if (PROTOBUF_PREDICT_FALSE(msg._internal_metadata_.have_unknown_fields())) {
+    const std::string& unknown_fields =
+        msg._internal_metadata_.unknown_fields<std::string>(&GetEmptyString);
+    target = stream->WriteRaw(unknown_fields.data(),
+                              static_cast<int>(unknown_fields.size()), target);
+  }
+  return target;
+}
+
+void ReverseBuffer::Grow(size_t n) {
+  const size_t size = this->size();
+  const size_t capacity = std::max<size_t>(
+      {2 * static_cast<size_t>(end_ - begin_), size + n, 1024});
+  std::unique_ptr<char[]> buffer(new char[capacity]);
+  char* const end = buffer.get() + capacity;
+  if (size != 0) std::memcpy(end - size, ptr_, size);
+  buffer_ = std::move(buffer);
+  begin_ = buffer_.get();
+  end_ = end;
+  ptr_ = end - size;
+}
+
+namespace {
+
+// Calls `f(field_number, entry)` for the field entries of the lookup table
+// blocks starting at `lookup_table`, in reverse field number order, until it
+// returns false. Returns false if `f` did.
+template <typename F>
+bool ForEachLookupEntryReverse(const TcParseTableBase::FieldEntry* entries,
+                               const uint16_t* lookup_table, F& f) {
+  const uint32_t fstart =
+      lookup_table[0] | (static_cast<uint32_t>(lookup_table[1]) << 16);
+  if (fstart == 0xFFFFFFFF) return true;  // The end of the table.
+  const uint32_t num_skip_entries = lookup_table[2];
+  const uint16_t* const skip_entries = lookup_table + 3;
+  // The later blocks come first.
+  if (!ForEachLookupEntryReverse(entries, skip_entries + 2 * num_skip_entries,
+                                 f)) {
+    return false;
+  }
+  for (uint32_t i = num_skip_entries; i-- > 0;) {
+    const uint16_t* const skip_entry = skip_entries + 2 * i;
+    uint32_t present = ~static_cast<uint32_t>(skip_entry[0]) & 0xFFFF;
+    const TcParseTableBase::FieldEntry* entry =
+        entries + skip_entry[1] + absl::popcount(present);
+    while (present != 0) {
+      const int bit = 31 - absl::countl_zero(present);
+      present &= ~(uint32_t{1} << bit);
+      if (!f(fstart + 16 * i + static_cast<uint32_t>(bit), *--entry)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Like ForEachFieldEntry(), but in reverse field number order, and stops
+// once `f` returns false. Returns false if it did.
+template <typename F>
+bool ForEachFieldEntryReverse(const TcParseTableBase* table, F f) {
+  const TcParseTableBase::FieldEntry* const field_entries =
+      table->field_entries_begin();
+  if (!ForEachLookupEntryReverse(field_entries, table->field_lookup_begin(),
+                                 f)) {
+    return false;
+  }
+  uint32_t present = ~table->skipmap32;
+  const TcParseTableBase::FieldEntry* entry =
+      field_entries + absl::popcount(present);
+  while (present != 0) {
+    const int bit = 31 - absl::countl_zero(present);
+    present &= ~(uint32_t{1} << bit);
+    if (!f(static_cast<uint32_t>(bit) + 1, *--entry)) return false;
+  }
+  return true;
+}
+
+// Writes the values of `field` from last to first, each after `tag` unless it
+// is zero, as for packed fields.
+template <typename T, typename Encode>
+void WriteVarintsReverse(const RepeatedField<T>& field, Encode encode,
+                         uint32_t tag, ReverseBuffer& out) {
+  for (int i = field.size(); i-- > 0;) {
+    out.WriteVarint(encode(field.Get(i)));
+    if (tag != 0) out.WriteVarint(tag);
+  }
+}
+
+void WriteRepeatedVarintReverse(const void* base,
+                                const TcParseTableBase::FieldEntry& entry,
+                                uint32_t tag, ReverseBuffer& out) {
+  namespace fl = field_layout;
+  const uint16_t type_card = entry.type_card;
+  switch (type_card & fl::kRepMask) {
+    case fl::kRep8Bits:
+      return WriteVarintsReverse(
+          GetRepeated<RepeatedField<bool>>(base, entry),
+          [](bool v) { return uint64_t{v}; }, tag, out);
+    case fl::kRep32Bits:
+      if (IsZigZag(type_card)) {
+        return WriteVarintsReverse(
+            GetRepeated<RepeatedField<int32_t>>(base, entry),
+            WireFormatLite::ZigZagEncode32, tag, out);
+      }
+      if (IsUnsigned(type_card)) {
+        return WriteVarintsReverse(
+            GetRepeated<RepeatedField<uint32_t>>(base, entry),
+            [](uint32_t v) { return uint64_t{v}; }, tag, out);
+      }
+      return WriteVarintsReverse(
+          GetRepeated<RepeatedField<int32_t>>(base, entry),
+          [](int32_t v) { return static_cast<uint64_t>(int64_t{v}); }, tag,
+          out);
+    default:
+      if (IsZigZag(type_card)) {
+        return WriteVarintsReverse(
+            GetRepeated<RepeatedField<int64_t>>(base, entry),
+            WireFormatLite::ZigZagEncode64, tag, out);
+      }
+      return WriteVarintsReverse(
+          GetRepeated<RepeatedField<uint64_t>>(base, entry),
+          [](uint64_t v) { return v; }, tag, out);
+  }
+}
+
+template <typename T>
+void WriteFixedsReverse(const RepeatedField<T>& field, uint32_t tag,
+                        ReverseBuffer& out) {
+  for (int i = field.size(); i-- > 0;) {
+    if constexpr (sizeof(T) == 4) {
+      out.WriteFixed32(field.Get(i));
+    } else {
+      out.WriteFixed64(field.Get(i));
+    }
+    if (tag != 0) out.WriteVarint(tag);
+  }
+}
+
+void WriteRepeatedFixedReverse(const void* base,
+                               const TcParseTableBase::FieldEntry& entry,
+                               uint32_t tag, ReverseBuffer& out) {
+  if ((entry.type_card & field_layout::kRepMask) == field_layout::kRep32Bits) {
+    WriteFixedsReverse(GetRepeated<RepeatedField<uint32_t>>(base, entry), tag,
+                       out);
+  } else {
+    WriteFixedsReverse(GetRepeated<RepeatedField<uint64_t>>(base, entry), tag,
+                       out);
+  }
+}
+
+void WriteCordReverse(const absl::Cord& value, ReverseBuffer& out) {
+  char* target = out.Prepend(value.size());
+  for (absl::string_view chunk : value.Chunks()) {
+    std::memcpy(target, chunk.data(), chunk.size());
+    target += chunk.size();
+  }
+}
+
+}  // namespace
+
+void TcParser::SerializeReverse(const MessageLite& msg, ReverseBuffer& out) {
+  const TcParseTableBase* table = msg.GetTcParseTable();
+  const size_t start = out.size();
+  if (table != nullptr && SerializeFieldsReverse(msg, table, out)) return;
+  out.Truncate(start);
+  const size_t size = msg.ByteSizeLong();
+  msg.SerializeWithCachedSizesToArray(
+      reinterpret_cast<uint8_t*>(out.Prepend(size)));
+}
+
+bool TcParser::SerializeFieldsReverse(const MessageLite& msg,
+                                      const TcParseTableBase* table,
+                                      ReverseBuffer& out) {
+  // Extensions are serialized by the ExtensionSet, which only writes forward.
+  if (table->extension_offset != 0 &&
+      RefAt<ExtensionSet>(&msg, table->extension_offset).NumExtensions() !=
+          0) {
+    return false;
+  }
+  // Unknown fields go after the known ones. Those of full messages are kept in
+  // an UnknownFieldSet, which lite code cannot serialize.
+  if (PROTOBUF_PREDICT_FALSE(msg._internal_metadata_.have_unknown_fields())) {
+    if (!table->class_data->is_lite) return false;
+    const std::string& unknown_fields =
+        msg._internal_metadata_.unknown_fields<std::string>(&GetEmptyString);
+    out.WriteRaw(unknown_fields.data(), unknown_fields.size());
+  }
+  return ForEachFieldEntryReverse(
+      table, [&](uint32_t field_num, const FieldEntry& entry) {
+        return SerializeFieldReverse(msg, table, entry, field_num, out);
+      });
+}
+
+bool TcParser::SerializeFieldReverse(const MessageLite& msg,
+                                     const TcParseTableBase* table,
+                                     const FieldEntry& entry,
+                                     uint32_t field_num, ReverseBuffer& out) {
+  namespace fl = field_layout;
+  const uint16_t type_card = entry.type_card;
+  const uint16_t rep = type_card & fl::kRepMask;
+  // Same exclusions as UseTableDrivenSerialization() in the code generator.
+  switch (type_card & fl::kFkMask) {
+    case fl::kFkNone:
+    case fl::kFkMap:
+      return false;
+    case fl::kFkString:
+      if (rep == fl::kRepSPiece) return false;
+      break;
+    case fl::kFkMessage:
+      if (rep == fl::kRepLazy ||
+          (type_card & fl::kTvMask) == fl::kTvWeakPtr) {
+        return false;
+      }
+      break;
+    default:
+      break;
+  }
+
+  const void* const base = GetFieldBase(msg, table, entry);
+  const auto write_string = [&](const std::string& value) {
+    if (IsUtf8Checked(type_card) &&
+        !utf8_range::IsStructurallyValid(value)) {
+      PrintUTF8ErrorLog(MessageName(table), FieldName(table, &entry),
+                        "serializing", false);
+    }
+    out.WriteRaw(value.data(), value.size());
+    out.WriteVarint(value.size());
+    out.WriteTag(field_num, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+  };
+  const auto write_cord = [&](const absl::Cord& value) {
+    WriteCordReverse(value, out);
+    out.WriteVarint(value.size());
+    out.WriteTag(field_num, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+  };
+  const auto write_message = [&](const MessageLite& value) {
+    if (rep == fl::kRepGroup) {
+      out.WriteTag(field_num, WireFormatLite::WIRETYPE_END_GROUP);
+      SerializeReverse(value, out);
+      out.WriteTag(field_num, WireFormatLite::WIRETYPE_START_GROUP);
+    } else {
+      const size_t start = out.size();
+      SerializeReverse(value, out);
+      out.WriteLengthSince(start);
+      out.WriteTag(field_num, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+    }
+  };
+
+  if ((type_card & fl::kFcMask) != fl::kFcRepeated) {
+    if (!HasField(msg, base, entry, field_num)) return true;
+    switch (type_card & fl::kFkMask) {
+      case fl::kFkVarint:
+        out.WriteVarint(GetVarint(base, entry));
+        out.WriteTag(field_num, WireFormatLite::WIRETYPE_VARINT);
+        return true;
+      case fl::kFkFixed:
+        if (rep == fl::kRep32Bits) {
+          out.WriteFixed32(RefAt<uint32_t>(base, entry.offset));
+          out.WriteTag(field_num, WireFormatLite::WIRETYPE_FIXED32);
+        } else {
+          out.WriteFixed64(RefAt<uint64_t>(base, entry.offset));
+          out.WriteTag(field_num, WireFormatLite::WIRETYPE_FIXED64);
+        }
+        return true;
+      case fl::kFkString:
+        switch (rep) {
+          case fl::kRepAString:
+            write_string(RefAt<ArenaStringPtr>(base, entry.offset).Get());
+            return true;
+          case fl::kRepIString:
+            write_string(RefAt<InlinedStringField>(base, entry.offset).Get());
+            return true;
+          case fl::kRepCord:
+            write_cord((type_card & fl::kFcMask) == fl::kFcOneof
+                           ? *RefAt<const absl::Cord*>(base, entry.offset)
+                           : RefAt<absl::Cord>(base, entry.offset));
+            return true;
+          default:
+            Unreachable();
+        }
+      case fl::kFkMessage:
+        write_message(*RefAt<const MessageLite*>(base, entry.offset));
+        return true;
+      default:
+        Unreachable();
+    }
+  }
+
+  switch (type_card & fl::kFkMask) {
+    case fl::kFkVarint:
+      WriteRepeatedVarintReverse(
+          base, entry,
+          WireFormatLite::MakeTag(field_num, WireFormatLite::WIRETYPE_VARINT),
+          out);
+      return true;
+    case fl::kFkFixed:
+      WriteRepeatedFixedReverse(
+          base, entry,
+          WireFormatLite::MakeTag(field_num,
+                                  rep == fl::kRep32Bits
+                                      ? WireFormatLite::WIRETYPE_FIXED32
+                                      : WireFormatLite::WIRETYPE_FIXED64),
+          out);
+      return true;
+    case fl::kFkPackedVarint:
+    case fl::kFkPackedFixed: {
+      const size_t start = out.size();
+      if ((type_card & fl::kFkMask) == fl::kFkPackedVarint) {
+        WriteRepeatedVarintReverse(base, entry, 0, out);
+      } else {
+        WriteRepeatedFixedReverse(base, entry, 0, out);
+      }
+      // Empty packed fields are not written.
+      if (out.size() == start) return true;
+      out.WriteLengthSince(start);
+      out.WriteTag(field_num, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+      return true;
+    }
+    case fl::kFkString:
+      if (rep == fl::kRepCord) {
+        const auto& field = GetRepeated<RepeatedField<absl::Cord>>(base, entry);
+        for (int i = field.size(); i-- > 0;) write_cord(field.Get(i));
+      } else {
+        ABSL_DCHECK_EQ(rep, +fl::kRepSString);
+        const auto& field =
+            GetRepeated<RepeatedPtrField<std::string>>(base, entry);
+        for (int i = field.size(); i-- > 0;) write_string(field.Get(i));
+      }
+      return true;
+    case fl::kFkMessage: {
+      const auto& field = GetRepeated<RepeatedPtrFieldBase>(base, entry);
+      for (int i = field.size(); i-- > 0;) {
+        write_message(field.Get<GenericTypeHandler<MessageLite>>(i));
+      }
+      return true;
+    }
+    default:
+      Unreachable();
+  }
+}
+
 }  // namespace internal
 }  // namespace protobuf
 }  // namespace google
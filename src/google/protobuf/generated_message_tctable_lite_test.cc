@@ -8,6 +8,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <string>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -19,8 +20,14 @@
 #include "google/protobuf/generated_message_tctable_decl.h"
 #include "google/protobuf/generated_message_tctable_impl.h"
 #include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 #include "google/protobuf/parse_context.h"
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/test_util_lite.h"
 #include "google/protobuf/unittest.pb.h"
+#include "google/protobuf/unittest_lite.pb.h"
+#include "google/protobuf/unittest_proto3.pb.h"
+#include "google/protobuf/unittest_table_driven_serialization.pb.h"
 #include "google/protobuf/wire_format_lite.h"
 
 
@@ -947,6 +954,233 @@ TEST(GeneratedMessageTctableLiteTest,
 }
 
 
+// Serializes `msg` with the table-driven serializer, and checks that the size
+// it computes matches the output.
+template <typename T>
+std::string TableDrivenSerialize(const T& msg) {
+  const TcParseTableBase* table = TcParser::GetTable<T>();
+  const bool is_lite = table->class_data->is_lite;
+  const size_t size = is_lite ? TcParser::ByteSizeLite(msg, table)
+                              : TcParser::ByteSize(msg, table);
+  std::string output;
+  {
+    io::StringOutputStream stream(&output);
+    io::CodedOutputStream coded(&stream);
+    uint8_t* ptr = coded.Cur();
+    ptr = is_lite ? TcParser::SerializeLite(msg, table, ptr, coded.EpsCopy())
+                  : TcParser::Serialize(msg, table, ptr, coded.EpsCopy());
+    coded.SetCur(ptr);
+  }
+  EXPECT_EQ(output.size(), size);
+  return output;
+}
+
+TEST(TableDrivenSerializationTest, AllFieldsLite) {
+  protobuf_unittest::TestAllTypesLite message;
+  TestUtilLite::SetAllFields(&message);
+  EXPECT_EQ(TableDrivenSerialize(message), message.SerializeAsString());
+}
+
+TEST(TableDrivenSerializationTest, PackedFieldsLite) {
+  protobuf_unittest::TestPackedTypesLite message;
+  TestUtilLite::SetPackedFields(&message);
+  EXPECT_EQ(TableDrivenSerialize(message), message.SerializeAsString());
+}
+
+TEST(TableDrivenSerializationTest, UnknownFieldsLite) {
+  protobuf_unittest::TestAllTypesLite all;
+  TestUtilLite::SetAllFields(&all);
+  protobuf_unittest::TestEmptyMessageLite message;
+  ASSERT_TRUE(message.ParseFromString(all.SerializeAsString()));
+  EXPECT_EQ(TableDrivenSerialize(message), all.SerializeAsString());
+}
+
+TEST(TableDrivenSerializationTest, AllFields) {
+  protobuf_unittest::TestAllTypes message;
+  TestUtil::SetAllFields(&message);
+  EXPECT_EQ(TableDrivenSerialize(message), message.SerializeAsString());
+  // Submessages have their cached sizes set.
+  EXPECT_EQ(message.optional_nested_message().GetCachedSize(),
+            message.optional_nested_message().ByteSizeLong());
+}
+
+TEST(TableDrivenSerializationTest, PackedFields) {
+  protobuf_unittest::TestPackedTypes message;
+  TestUtil::SetPackedFields(&message);
+  EXPECT_EQ(TableDrivenSerialize(message), message.SerializeAsString());
+}
+
+TEST(TableDrivenSerializationTest, UnknownFields) {
+  protobuf_unittest::TestAllTypes all;
+  TestUtil::SetAllFields(&all);
+  protobuf_unittest::TestEmptyMessage message;
+  ASSERT_TRUE(message.ParseFromString(all.SerializeAsString()));
+  EXPECT_EQ(TableDrivenSerialize(message), message.SerializeAsString());
+}
+
+TEST(TableDrivenSerializationTest, ExtensionsInFieldNumberOrder) {
+  protobuf_unittest::TestFieldOrderings message;
+  message.set_my_int(1);
+  message.set_my_string("foo");
+  message.set_my_float(1.5);
+  message.mutable_optional_nested_message()->set_bb(2);
+  message.SetExtension(protobuf_unittest::my_extension_int, 5);
+  message.SetExtension(protobuf_unittest::my_extension_string, "bar");
+  EXPECT_EQ(TableDrivenSerialize(message), message.SerializeAsString());
+}
+
+TEST(TableDrivenSerializationTest, ImplicitPresence) {
+  proto3_unittest::TestAllTypes message;
+  EXPECT_EQ(TableDrivenSerialize(message), "");
+
+  message.set_optional_int32(0);
+  message.set_optional_int64(-1);
+  message.set_optional_sint32(-2);
+  message.set_optional_bool(true);
+  message.set_optional_float(-0.0f);
+  message.set_optional_string("foo");
+  message.set_optional_nested_enum(proto3_unittest::TestAllTypes::BAZ);
+  message.set_oneof_uint32(0);
+  EXPECT_EQ(TableDrivenSerialize(message), message.SerializeAsString());
+}
+
+// The messages in unittest_table_driven_serialization.proto are compiled with
+// the table_driven_serialization option, so their ByteSizeLong() and
+// _InternalSerialize() run the table-driven serializer.  They have the fields
+// of messages in unittest.proto, whose generated code must produce the same
+// bytes.
+TEST(TableDrivenSerializationTest, GeneratedAllFieldsRoundTrip) {
+  protobuf_unittest::TestAllTypes all;
+  TestUtil::SetAllFields(&all);
+  // Fields that TestTableDrivenAllTypes leaves out.
+  all.clear_optional_string_piece();
+  all.clear_optional_lazy_message();
+  all.clear_optional_unverified_lazy_message();
+  all.clear_repeated_string_piece();
+  all.clear_repeated_lazy_message();
+  all.clear_default_string_piece();
+  const std::string data = all.SerializeAsString();
+
+  protobuf_unittest::TestTableDrivenAllTypes message;
+  ASSERT_TRUE(message.ParseFromString(data));
+  EXPECT_TRUE(message.GetReflection()->GetUnknownFields(message).empty());
+  EXPECT_EQ(message.ByteSizeLong(), data.size());
+  EXPECT_EQ(message.SerializeAsString(), data);
+  EXPECT_EQ(message.optional_nested_message().GetCachedSize(),
+            message.optional_nested_message().ByteSizeLong());
+
+  protobuf_unittest::TestAllTypes parsed;
+  ASSERT_TRUE(parsed.ParseFromString(message.SerializeAsString()));
+  EXPECT_EQ(parsed.SerializeAsString(), data);
+}
+
+TEST(TableDrivenSerializationTest, GeneratedPackedFieldsRoundTrip) {
+  protobuf_unittest::TestPackedTypes packed;
+  TestUtil::SetPackedFields(&packed);
+  const std::string data = packed.SerializeAsString();
+
+  protobuf_unittest::TestTableDrivenPackedTypes message;
+  ASSERT_TRUE(message.ParseFromString(data));
+  EXPECT_EQ(message.ByteSizeLong(), data.size());
+  EXPECT_EQ(message.SerializeAsString(), data);
+
+  // Modifying the fields changes the packed lengths, which are recomputed.
+  message.add_packed_int32(-1);
+  message.set_packed_uint64(0, 1);
+  packed.add_packed_int32(-1);
+  packed.set_packed_uint64(0, 1);
+  EXPECT_EQ(message.SerializeAsString(), packed.SerializeAsString());
+}
+
+TEST(TableDrivenSerializationTest, GeneratedFieldOrderingsRoundTrip) {
+  protobuf_unittest::TestTableDrivenFieldOrderings message;
+  message.set_my_int(1);
+  message.set_my_string("foo");
+  message.set_my_float(1.5);
+  message.SetExtension(protobuf_unittest::table_driven_extension_int, 5);
+  message.SetExtension(protobuf_unittest::table_driven_extension_string,
+                       "bar");
+
+  protobuf_unittest::TestFieldOrderings expected;
+  expected.set_my_int(1);
+  expected.set_my_string("foo");
+  expected.set_my_float(1.5);
+  expected.SetExtension(protobuf_unittest::my_extension_int, 5);
+  expected.SetExtension(protobuf_unittest::my_extension_string, "bar");
+  EXPECT_EQ(message.SerializeAsString(), expected.SerializeAsString());
+
+  protobuf_unittest::TestTableDrivenFieldOrderings parsed;
+  ASSERT_TRUE(parsed.ParseFromString(expected.SerializeAsString()));
+  EXPECT_EQ(parsed.SerializeAsString(), expected.SerializeAsString());
+}
+
+std::string ReverseSerialize(const MessageLite& msg) {
+  ReverseBuffer out;
+  TcParser::SerializeReverse(msg, out);
+  return std::string(out.data(), out.size());
+}
+
+TEST(ReverseSerializationTest, AllFieldsLite) {
+  protobuf_unittest::TestAllTypesLite message;
+  TestUtilLite::SetAllFields(&message);
+  EXPECT_EQ(ReverseSerialize(message), message.SerializeAsString());
+}
+
+TEST(ReverseSerializationTest, PackedFieldsLite) {
+  protobuf_unittest::TestPackedTypesLite message;
+  TestUtilLite::SetPackedFields(&message);
+  EXPECT_EQ(ReverseSerialize(message), message.SerializeAsString());
+}
+
+TEST(ReverseSerializationTest, UnknownFieldsLite) {
+  protobuf_unittest::TestAllTypesLite all;
+  TestUtilLite::SetAllFields(&all);
+  protobuf_unittest::TestEmptyMessageLite message;
+  ASSERT_TRUE(message.ParseFromString(all.SerializeAsString()));
+  EXPECT_EQ(ReverseSerialize(message), all.SerializeAsString());
+}
+
+TEST(ReverseSerializationTest, AllFields) {
+  protobuf_unittest::TestAllTypes message;
+  TestUtil::SetAllFields(&message);
+  EXPECT_EQ(ReverseSerialize(message), message.SerializeAsString());
+}
+
+TEST(ReverseSerializationTest, ExtensionsAndUnknownFields) {
+  // Both are written by the regular serializer.
+  protobuf_unittest::TestAllExtensions extensions;
+  TestUtil::SetAllExtensions(&extensions);
+  EXPECT_EQ(ReverseSerialize(extensions), extensions.SerializeAsString());
+  protobuf_unittest::TestAllTypes all;
+  TestUtil::SetAllFields(&all);
+  protobuf_unittest::TestEmptyMessage message;
+  ASSERT_TRUE(message.ParseFromString(all.SerializeAsString()));
+  EXPECT_EQ(ReverseSerialize(message), all.SerializeAsString());
+}
+
+TEST(ReverseSerializationTest, ImplicitPresence) {
+  proto3_unittest::TestAllTypes message;
+  EXPECT_EQ(ReverseSerialize(message), "");
+  message.set_optional_int32(0);
+  message.set_optional_int64(-1);
+  message.set_optional_float(-0.0f);
+  message.set_optional_string("foo");
+  message.add_repeated_int32(-5);
+  message.add_repeated_int32(300);
+  message.set_oneof_uint32(0);
+  EXPECT_EQ(ReverseSerialize(message), message.SerializeAsString());
+}
+
+TEST(ReverseSerializationTest, WritesInFrontOfExistingData) {
+  protobuf_unittest::TestAllTypes message;
+  message.set_optional_int32(1);
+  ReverseBuffer out;
+  out.WriteRaw("tail", 4);
+  TcParser::SerializeReverse(message, out);
+  EXPECT_EQ(std::string(out.data(), out.size()),
+            message.SerializeAsString() + "tail");
+}
+
 }  // namespace internal
 }  // namespace protobuf
 }  // namespace google
@@ -0,0 +1,220 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/huge_page_block_allocator.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#include "absl/base/attributes.h"
+#include "absl/log/absl_check.h"
+#include "absl/numeric/bits.h"
+#include "absl/synchronization/mutex.h"
+#include "google/protobuf/port.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace internal {
+
+#ifdef __linux__
+
+namespace {
+
+constexpr size_t kSlabSize = HugePageBlockAllocator::kSlabSize;
+constexpr int kMinClass = 8;   // log2(kMinBlockSize)
+constexpr int kMaxClass = 19;  // log2(kMaxSlabBlockSize)
+constexpr int kNumClasses = kMaxClass - kMinClass + 1;
+static_assert(size_t{1} << kMinClass == HugePageBlockAllocator::kMinBlockSize,
+              "");
+static_assert(size_t{1} << kMaxClass ==
+                  HugePageBlockAllocator::kMaxSlabBlockSize,
+              "");
+
+// NUMA nodes beyond this are folded onto the ones below, so that a node mask
+// fits in a single word.
+constexpr int kMaxNodes = 8 * sizeof(unsigned long);  // NOLINT
+
+// From <linux/mempolicy.h>; spelled out to avoid depending on libnuma.
+constexpr int kMpolPreferred = 1;
+
+std::atomic<size_t> bytes_mapped{0};
+
+struct FreeBlock {
+  FreeBlock* next;
+};
+
+// Each slab starts with this header, so the owning node of any slab block can
+// be found by aligning the block address down to kSlabSize.
+struct SlabHeader {
+  int node;
+};
+constexpr size_t kSlabHeaderSize = 64;
+static_assert(sizeof(SlabHeader) <= kSlabHeaderSize, "");
+
+struct NodeState {
+  absl::Mutex mu;
+  char* ptr ABSL_GUARDED_BY(mu) = nullptr;
+  char* limit ABSL_GUARDED_BY(mu) = nullptr;
+  FreeBlock* free_lists[kNumClasses] ABSL_GUARDED_BY(mu) = {};
+};
+
+NodeState& GetNode(int node) {
+  static NodeState* const nodes = new NodeState[kMaxNodes];
+  return nodes[node];
+}
+
+int CurrentNode() {
+  unsigned cpu = 0;
+  unsigned node = 0;
+#if defined(SYS_getcpu)
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) return 0;
+#endif
+  return static_cast<int>(node % kMaxNodes);
+}
+
+// Maps `size` bytes aligned to kSlabSize, asks for transparent huge pages and
+// prefers the memory of `node`. Returns nullptr on failure.
+char* MapHugePages(size_t size, int node) {
+  // Over-map so that an aligned range of `size` bytes can be cut out.
+  const size_t mapped = size + kSlabSize;
+  void* p = mmap(nullptr, mapped, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED) return nullptr;
+  const uintptr_t start = reinterpret_cast<uintptr_t>(p);
+  const uintptr_t aligned = (start + kSlabSize - 1) & ~(kSlabSize - 1);
+  if (aligned != start) munmap(p, aligned - start);
+  const size_t tail = (start + mapped) - (aligned + size);
+  if (tail != 0) munmap(reinterpret_cast<void*>(aligned + size), tail);
+
+  char* res = reinterpret_cast<char*>(aligned);
+#if defined(MADV_HUGEPAGE)
+  madvise(res, size, MADV_HUGEPAGE);
+#endif
+#if defined(SYS_mbind)
+  unsigned long nodemask = 1UL << node;  // NOLINT
+  // Best effort: failing to bind leaves the default (first touch) policy.
+  syscall(SYS_mbind, res, size, kMpolPreferred, &nodemask, kMaxNodes + 1, 0);
+#endif
+  bytes_mapped.fetch_add(size, std::memory_order_relaxed);
+  return res;
+}
+
+int SizeClass(size_t size) {
+  if (size <= HugePageBlockAllocator::kMinBlockSize) return kMinClass;
+  return absl::bit_width(size - 1);
+}
+
+// Pushes [p, limit) onto the free lists of `state`, largest classes first.
+void ReleaseTail(NodeState& state, char* p, char* limit)
+    ABSL_EXCLUSIVE_LOCKS_REQUIRED(state.mu) {
+  for (int c = kMaxClass; c >= kMinClass; --c) {
+    const size_t block_size = size_t{1} << c;
+    while (static_cast<size_t>(limit - p) >= block_size) {
+      state.free_lists[c - kMinClass] =
+          new (p) FreeBlock{state.free_lists[c - kMinClass]};
+      p += block_size;
+    }
+  }
+}
+
+void* AllocateFromSlab(int size_class) {
+  const int node = CurrentNode();
+  NodeState& state = GetNode(node);
+  const size_t block_size = size_t{1} << size_class;
+
+  absl::MutexLock lock(&state.mu);
+  FreeBlock*& head = state.free_lists[size_class - kMinClass];
+  if (head != nullptr) {
+    FreeBlock* block = head;
+    head = block->next;
+    return block;
+  }
+  if (static_cast<size_t>(state.limit - state.ptr) < block_size) {
+    char* slab = MapHugePages(kSlabSize, node);
+    if (slab == nullptr) return nullptr;
+    // Keep what is left of the previous slab for smaller blocks.
+    ReleaseTail(state, state.ptr, state.limit);
+    new (slab) SlabHeader{node};
+    state.ptr = slab + kSlabHeaderSize;
+    state.limit = slab + kSlabSize;
+  }
+  void* res = state.ptr;
+  state.ptr += block_size;
+  return res;
+}
+
+void DeallocateToSlab(void* p, int size_class) {
+  const uintptr_t slab = reinterpret_cast<uintptr_t>(p) & ~(kSlabSize - 1);
+  const int node = reinterpret_cast<const SlabHeader*>(slab)->node;
+  NodeState& state = GetNode(node);
+
+  absl::MutexLock lock(&state.mu);
+  FreeBlock*& head = state.free_lists[size_class - kMinClass];
+  head = new (p) FreeBlock{head};
+}
+
+size_t DedicatedMappingSize(size_t size) {
+  return (size + kSlabSize - 1) & ~(kSlabSize - 1);
+}
+
+}  // namespace
+
+void* HugePageBlockAllocator::Allocate(size_t size) {
+  void* res;
+  if (size <= kMaxSlabBlockSize) {
+    res = AllocateFromSlab(SizeClass(size));
+  } else {
+    res = MapHugePages(DedicatedMappingSize(size), CurrentNode());
+  }
+  ABSL_CHECK(res != nullptr) << "Failed to map " << size << " bytes";
+  return res;
+}
+
+void HugePageBlockAllocator::Deallocate(void* p, size_t size) {
+  if (size <= kMaxSlabBlockSize) {
+    DeallocateToSlab(p, SizeClass(size));
+    return;
+  }
+  const size_t mapped = DedicatedMappingSize(size);
+  munmap(p, mapped);
+  bytes_mapped.fetch_sub(mapped, std::memory_order_relaxed);
+}
+
+size_t HugePageBlockAllocator::BytesMapped() {
+  return bytes_mapped.load(std::memory_order_relaxed);
+}
+
+#else  // __linux__
+
+void* HugePageBlockAllocator::Allocate(size_t size) {
+  return ::operator new(size);
+}
+
+void HugePageBlockAllocator::Deallocate(void* p, size_t size) {
+  internal::SizedDelete(p, size);
+}
+
+size_t HugePageBlockAllocator::BytesMapped() { return 0; }
+
+#endif  // __linux__
+
+}  // namespace internal
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
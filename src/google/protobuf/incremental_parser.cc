@@ -0,0 +1,200 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2026 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/incremental_parser.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/message_lite.h"
+#include "google/protobuf/wire_format_lite.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace {
+
+using internal::WireFormatLite;
+
+enum class ScanResult { kComplete, kIncomplete, kMalformed };
+
+// Reads a varint from [*ptr, end) without reading past `end`.
+ScanResult ReadVarint(const char** ptr, const char* end, uint64_t* value) {
+  uint64_t res = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (*ptr == end) return ScanResult::kIncomplete;
+    const uint8_t byte = static_cast<uint8_t>(*(*ptr)++);
+    res |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (byte < 0x80) {
+      *value = res;
+      return ScanResult::kComplete;
+    }
+  }
+  return ScanResult::kMalformed;
+}
+
+// Skips the `n` bytes of the value of a field starting at `field`.
+ScanResult SkipValue(const char** ptr, const char* end, const char* field,
+                     uint64_t n, size_t* size) {
+  if (static_cast<uint64_t>(end - *ptr) < n) {
+    *size = static_cast<size_t>(*ptr - field + n);
+    return ScanResult::kIncomplete;
+  }
+  *ptr += n;
+  return ScanResult::kComplete;
+}
+
+// Skips the tag and value at *ptr. A START_GROUP tag pushes the end tag of the
+// group on `open_groups` and a matching END_GROUP tag pops it, so a group is
+// scanned one item at a time and the scan can stop and resume between any two
+// of them. If the item is incomplete, sets `size` to its total size if that is
+// known from the bytes seen so far, and leaves it unchanged otherwise.
+ScanResult ScanItem(const char** ptr, const char* end,
+                    std::vector<uint32_t>& open_groups, size_t* size) {
+  const char* const item = *ptr;
+  uint64_t tag;
+  ScanResult res = ReadVarint(ptr, end, &tag);
+  if (res != ScanResult::kComplete) return res;
+  if (tag > std::numeric_limits<uint32_t>::max() ||
+      WireFormatLite::GetTagFieldNumber(static_cast<uint32_t>(tag)) == 0) {
+    return ScanResult::kMalformed;
+  }
+  uint64_t value;
+  switch (WireFormatLite::GetTagWireType(static_cast<uint32_t>(tag))) {
+    case WireFormatLite::WIRETYPE_VARINT:
+      return ReadVarint(ptr, end, &value);
+    case WireFormatLite::WIRETYPE_FIXED64:
+      return SkipValue(ptr, end, item, 8, size);
+    case WireFormatLite::WIRETYPE_FIXED32:
+      return SkipValue(ptr, end, item, 4, size);
+    case WireFormatLite::WIRETYPE_LENGTH_DELIMITED:
+      res = ReadVarint(ptr, end, &value);
+      if (res != ScanResult::kComplete) return res;
+      if (value > static_cast<uint64_t>(std::numeric_limits<int32_t>::max())) {
+        return ScanResult::kMalformed;
+      }
+      return SkipValue(ptr, end, item, value, size);
+    case WireFormatLite::WIRETYPE_START_GROUP:
+      if (static_cast<int>(open_groups.size()) >=
+          io::CodedInputStream::GetDefaultRecursionLimit()) {
+        return ScanResult::kMalformed;
+      }
+      open_groups.push_back(static_cast<uint32_t>(tag) + 1);
+      return ScanResult::kComplete;
+    case WireFormatLite::WIRETYPE_END_GROUP:
+      if (open_groups.empty() || open_groups.back() != tag) {
+        return ScanResult::kMalformed;
+      }
+      open_groups.pop_back();
+      return ScanResult::kComplete;
+    default:
+      // An invalid wire type.
+      return ScanResult::kMalformed;
+  }
+}
+
+}  // namespace
+
+IncrementalParser::IncrementalParser(MessageLite* message, int64_t size)
+    : message_(message), size_(size) {
+  message_->Clear();
+}
+
+int64_t IncrementalParser::ParseFields(absl::string_view data) {
+  // The field at the start of `data` was scanned up to `scanned_` by the
+  // previous call, with its open groups in `open_groups_`.
+  const char* ptr = data.data() + scanned_;
+  const char* const end = data.data() + data.size();
+  const char* boundary = data.data();
+  needed_ = 0;
+  while (ptr < end) {
+    const char* const item = ptr;
+    size_t size = 0;
+    ScanResult res = ScanItem(&ptr, end, open_groups_, &size);
+    if (res == ScanResult::kMalformed) return -1;
+    if (res == ScanResult::kIncomplete) {
+      if (size != 0 && open_groups_.empty()) {
+        needed_ = size - static_cast<size_t>(end - boundary);
+      }
+      ptr = item;
+      break;
+    }
+    if (open_groups_.empty()) boundary = ptr;
+  }
+  scanned_ = static_cast<size_t>(ptr - boundary);
+  const int64_t parsed = boundary - data.data();
+  if (parsed > 0 &&
+      !message_->ParseFrom<MessageLite::kMergePartial>(
+          absl::string_view(data.data(), static_cast<size_t>(parsed)))) {
+    return -1;
+  }
+  return parsed;
+}
+
+IncrementalParser::Status IncrementalParser::Feed(absl::string_view chunk) {
+  if (status_ != Status::kNeedMore) {
+    return status_ == Status::kDone && !chunk.empty() ? Fail() : status_;
+  }
+  byte_count_ += static_cast<int64_t>(chunk.size());
+  if (size_ >= 0 && byte_count_ > size_) return Fail();
+
+  if (!pending_.empty()) {
+    if (needed_ == 0) {
+      // The size of the pending field is unknown, so its scan is resumed
+      // with the new bytes.
+      pending_.append(chunk.data(), chunk.size());
+      chunk = {};
+      const int64_t parsed = ParseFields(pending_);
+      if (parsed < 0) return Fail();
+      pending_.erase(0, static_cast<size_t>(parsed));
+    } else {
+      // Only the rest of the pending field is copied; the fields after it are
+      // parsed from `chunk` below.
+      const size_t n = std::min(needed_, chunk.size());
+      pending_.append(chunk.data(), n);
+      chunk.remove_prefix(n);
+      needed_ -= n;
+      if (needed_ == 0) {
+        if (!message_->ParseFrom<MessageLite::kMergePartial>(
+                absl::string_view(pending_))) {
+          return Fail();
+        }
+        pending_.clear();
+      }
+    }
+  }
+  if (!chunk.empty()) {
+    const int64_t parsed = ParseFields(chunk);
+    if (parsed < 0) return Fail();
+    chunk.remove_prefix(static_cast<size_t>(parsed));
+    pending_.assign(chunk.data(), chunk.size());
+  }
+
+  if (byte_count_ == size_) return Finish();
+  return status_;
+}
+
+IncrementalParser::Status IncrementalParser::Finish() {
+  if (status_ != Status::kNeedMore) return status_;
+  if (!pending_.empty() || (size_ >= 0 && byte_count_ != size_) ||
+      !message_->IsInitialized()) {
+    return Fail();
+  }
+  return status_ = Status::kDone;
+}
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
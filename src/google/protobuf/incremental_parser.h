@@ -0,0 +1,101 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2026 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// Push-style parsing of a message received in chunks.
+
+#ifndef GOOGLE_PROTOBUF_INCREMENTAL_PARSER_H__
+#define GOOGLE_PROTOBUF_INCREMENTAL_PARSER_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "google/protobuf/message_lite.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+
+// Parses a message from chunks of input as they become available, e.g.
+//
+//   IncrementalParser parser(&message, frame_size);
+//   // For each chunk received:
+//   switch (parser.Feed(chunk)) {
+//     case IncrementalParser::Status::kNeedMore: ...  // wait for more
+//     case IncrementalParser::Status::kDone: ...      // `message` is ready
+//     case IncrementalParser::Status::kError: ...
+//   }
+//
+// Each call parses the top-level fields that are complete so far and keeps
+// the bytes of the last field if it is incomplete. Only those bytes are
+// buffered, so a message made of many fields is parsed while it is received
+// using memory for about one field. A single field, such as a large
+// submessage, is buffered until it is complete.
+//
+// The result is the same as MessageLite::ParseFromString() on the
+// concatenation of all chunks.
+class PROTOBUF_EXPORT IncrementalParser {
+ public:
+  enum class Status {
+    kNeedMore,  // The input may continue.
+    kDone,      // The message was parsed successfully.
+    kError,     // The input is invalid or required fields are missing.
+  };
+
+  // Parses into `message`, which is cleared. If `size` is not -1, the input
+  // is exactly `size` bytes and Feed() returns kDone once all of them were
+  // fed. Otherwise the end of the input is signaled with Finish().
+  explicit IncrementalParser(MessageLite* message, int64_t size = -1);
+
+  IncrementalParser(const IncrementalParser&) = delete;
+  IncrementalParser& operator=(const IncrementalParser&) = delete;
+
+  // Parses the next chunk of input. Once kDone or kError were returned, they
+  // are returned again without parsing; more input after kDone is an error.
+  Status Feed(absl::string_view chunk);
+
+  // Signals the end of the input. Returns kDone if it ended at a field
+  // boundary (and, with a size, after `size` bytes) and all required fields
+  // are set.
+  Status Finish();
+
+  // Number of bytes fed so far.
+  int64_t ByteCount() const { return byte_count_; }
+
+ private:
+  // Parses the complete fields at the start of `data` and returns their
+  // size, or -1 on error. Resumes the scan of the first field at `scanned_`
+  // and sets `needed_`, `scanned_` and `open_groups_` for the field left
+  // incomplete.
+  int64_t ParseFields(absl::string_view data);
+  Status Fail() { return status_ = Status::kError; }
+
+  MessageLite* message_;
+  const int64_t size_;
+  int64_t byte_count_ = 0;
+  // Bytes of the incomplete field at the end of the input fed so far.
+  std::string pending_;
+  // Bytes still needed to complete the pending field, or 0 if unknown.
+  size_t needed_ = 0;
+  // Number of bytes of the pending field that were already scanned, and the
+  // end tags of the groups open at that point. An incomplete group is thus
+  // scanned once rather than from its start on every Feed().
+  size_t scanned_ = 0;
+  std::vector<uint32_t> open_groups_;
+  Status status_ = Status::kNeedMore;
+};
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_INCREMENTAL_PARSER_H__
@@ -0,0 +1,172 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2026 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/incremental_parser.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <gtest/gtest.h>
+#include "absl/strings/string_view.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/unittest.pb.h"
+#include "google/protobuf/wire_format_lite.h"
+
+namespace google {
+namespace protobuf {
+namespace {
+
+using Status = IncrementalParser::Status;
+using ::google::protobuf::internal::WireFormatLite;
+using ::protobuf_unittest::TestAllTypes;
+using ::protobuf_unittest::TestRequired;
+
+std::string AllFields() {
+  TestAllTypes message;
+  TestUtil::SetAllFields(&message);
+  // A field larger than most chunks.
+  message.set_optional_bytes(std::string(1000, 'x'));
+  return message.SerializeAsString();
+}
+
+// Feeds `data` in chunks of `chunk_size` bytes, returning the last status.
+Status FeedChunks(IncrementalParser& parser, absl::string_view data,
+                  size_t chunk_size) {
+  Status status = Status::kNeedMore;
+  for (size_t i = 0; i < data.size(); i += chunk_size) {
+    status = parser.Feed(data.substr(i, chunk_size));
+  }
+  return status;
+}
+
+TEST(IncrementalParserTest, MatchesParseFromString) {
+  const std::string data = AllFields();
+  TestAllTypes expected;
+  ASSERT_TRUE(expected.ParseFromString(data));
+
+  for (size_t chunk_size : {1, 2, 3, 7, 16, 100, 4096}) {
+    SCOPED_TRACE(chunk_size);
+    TestAllTypes message;
+    IncrementalParser parser(&message);
+    EXPECT_EQ(FeedChunks(parser, data, chunk_size), Status::kNeedMore);
+    EXPECT_EQ(parser.Finish(), Status::kDone);
+    EXPECT_EQ(parser.ByteCount(), static_cast<int64_t>(data.size()));
+    EXPECT_EQ(message.SerializeAsString(), expected.SerializeAsString());
+  }
+}
+
+TEST(IncrementalParserTest, DoneAfterSize) {
+  const std::string data = AllFields();
+  TestAllTypes message;
+  message.set_optional_int32(1);  // Cleared by the parser.
+  IncrementalParser parser(&message, data.size());
+  EXPECT_EQ(FeedChunks(parser, data, 10), Status::kDone);
+  TestAllTypes expected;
+  ASSERT_TRUE(expected.ParseFromString(data));
+  EXPECT_EQ(message.SerializeAsString(), expected.SerializeAsString());
+
+  // Once done, further input is an error.
+  EXPECT_EQ(parser.Feed(""), Status::kDone);
+  EXPECT_EQ(parser.Feed("\x08\x01"), Status::kError);
+}
+
+TEST(IncrementalParserTest, RejectsTruncatedInput) {
+  const std::string data = AllFields();
+  for (size_t size : {size_t{1}, data.size() / 2, data.size() - 1}) {
+    SCOPED_TRACE(size);
+    TestAllTypes message;
+    IncrementalParser parser(&message);
+    FeedChunks(parser, absl::string_view(data).substr(0, size), 5);
+    EXPECT_EQ(parser.Finish(), Status::kError);
+  }
+}
+
+TEST(IncrementalParserTest, RejectsInputLongerThanSize) {
+  const std::string data = AllFields();
+  TestAllTypes message;
+  IncrementalParser parser(&message, data.size() - 1);
+  EXPECT_EQ(parser.Feed(data), Status::kError);
+}
+
+TEST(IncrementalParserTest, RejectsMalformedInput) {
+  TestAllTypes message;
+  IncrementalParser parser(&message);
+  // An END_GROUP tag outside of a group.
+  EXPECT_EQ(parser.Feed("\x08\x01\x0c"), Status::kError);
+  EXPECT_EQ(parser.Finish(), Status::kError);
+}
+
+TEST(IncrementalParserTest, ParsesLargeGroups) {
+  // A top-level group, unknown to TestAllTypes, of many small fields and a
+  // nested group. Its size isn't known until its end tag, so it stays pending
+  // over many chunks.
+  std::string data;
+  {
+    io::StringOutputStream output(&data);
+    io::CodedOutputStream coded(&output);
+    coded.WriteTag(WireFormatLite::MakeTag(
+        1000, WireFormatLite::WIRETYPE_START_GROUP));
+    for (int i = 0; i < 1000; ++i) {
+      coded.WriteTag(
+          WireFormatLite::MakeTag(1, WireFormatLite::WIRETYPE_VARINT));
+      coded.WriteVarint32(i);
+    }
+    coded.WriteTag(
+        WireFormatLite::MakeTag(2, WireFormatLite::WIRETYPE_START_GROUP));
+    coded.WriteTag(
+        WireFormatLite::MakeTag(3, WireFormatLite::WIRETYPE_FIXED64));
+    coded.WriteLittleEndian64(3);
+    coded.WriteTag(
+        WireFormatLite::MakeTag(2, WireFormatLite::WIRETYPE_END_GROUP));
+    coded.WriteTag(
+        WireFormatLite::MakeTag(1000, WireFormatLite::WIRETYPE_END_GROUP));
+  }
+  data += AllFields();
+  TestAllTypes expected;
+  ASSERT_TRUE(expected.ParseFromString(data));
+
+  for (size_t chunk_size : {1, 5, 64}) {
+    SCOPED_TRACE(chunk_size);
+    TestAllTypes message;
+    IncrementalParser parser(&message);
+    EXPECT_EQ(FeedChunks(parser, data, chunk_size), Status::kNeedMore);
+    EXPECT_EQ(parser.Finish(), Status::kDone);
+    EXPECT_EQ(message.SerializeAsString(), expected.SerializeAsString());
+  }
+
+  // The end tag of the nested group doesn't match the enclosing group.
+  TestAllTypes message;
+  IncrementalParser parser(&message);
+  EXPECT_EQ(parser.Feed("\x83\x3e\x08\x01"), Status::kNeedMore);
+  EXPECT_EQ(parser.Feed("\x13\x08\x01"), Status::kNeedMore);
+  EXPECT_EQ(parser.Feed("\x84\x3e"), Status::kError);
+}
+
+TEST(IncrementalParserTest, ChecksRequiredFields) {
+  TestRequired required;
+  required.set_a(1);
+  required.set_b(2);
+  const std::string partial = required.SerializePartialAsString();
+
+  TestRequired message;
+  IncrementalParser parser(&message);
+  EXPECT_EQ(parser.Feed(partial), Status::kNeedMore);
+  EXPECT_EQ(parser.Finish(), Status::kError);
+
+  required.set_c(3);
+  IncrementalParser complete(&message);
+  EXPECT_EQ(complete.Feed(required.SerializeAsString()), Status::kNeedMore);
+  EXPECT_EQ(complete.Finish(), Status::kDone);
+  EXPECT_EQ(message.c(), 3);
+}
+
+}  // namespace
+}  // namespace protobuf
+}  // namespace google
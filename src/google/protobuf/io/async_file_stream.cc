@@ -0,0 +1,707 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/io/async_file_stream.h"
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+#include <errno.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "google/protobuf/io/io_win32.h"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
+
+// io_uring is driven through its system calls directly, so that there is no
+// dependency on liburing.
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && \
+    defined(__NR_io_uring_register)
+#define GOOGLE_PROTOBUF_IO_URING_AVAILABLE 1
+#endif
+#endif
+#endif
+
+namespace google {
+namespace protobuf {
+namespace io {
+
+#ifdef _WIN32
+// DO NOT include <io.h>, instead create functions in io_win32.{h,cc} and import
+// them like we do below.
+using google::protobuf::io::win32::close;
+#endif
+
+#ifdef GOOGLE_PROTOBUF_IO_URING_AVAILABLE
+
+// A minimal io_uring: one submission per system call, and completions are
+// identified by the index of the buffer they belong to.
+class IoUring {
+ public:
+  // Sets up a ring for `num_buffers` buffers of `buffer_size` bytes each,
+  // stored contiguously at `data`.  Returns nullptr if io_uring is not
+  // available.
+  static std::unique_ptr<IoUring> Create(int num_buffers, char* data,
+                                         int buffer_size) {
+    std::unique_ptr<IoUring> ring(new IoUring);
+    if (!ring->Setup(static_cast<unsigned>(num_buffers))) return nullptr;
+    ring->iovecs_.resize(num_buffers);
+    for (int i = 0; i < num_buffers; ++i) {
+      ring->iovecs_[i].iov_base = data + static_cast<size_t>(i) * buffer_size;
+      ring->iovecs_[i].iov_len = static_cast<size_t>(buffer_size);
+    }
+    // Registered buffers save the kernel from mapping the pages on every
+    // request, but are limited by RLIMIT_MEMLOCK.  Without them we fall back
+    // to vectored I/O.
+    ring->registered_ =
+        syscall(__NR_io_uring_register, ring->ring_fd_,
+                IORING_REGISTER_BUFFERS, ring->iovecs_.data(),
+                static_cast<unsigned>(num_buffers)) == 0;
+    return ring;
+  }
+
+  IoUring(const IoUring&) = delete;
+  IoUring& operator=(const IoUring&) = delete;
+
+  ~IoUring() {
+    if (sqes_ != nullptr) munmap(sqes_, sqes_size_);
+    if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != nullptr) munmap(sq_ring_, sq_ring_size_);
+    if (ring_fd_ >= 0) close(ring_fd_);
+  }
+
+  // Queues a read or write of the first `size` bytes of buffer `index` at
+  // `offset` in `fd`.  Returns zero or an errno.
+  int Submit(bool write, int fd, int index, int size, int64_t offset) {
+    io_uring_sqe* sqe = NextSqe();
+    sqe->fd = fd;
+    sqe->off = static_cast<uint64_t>(offset);
+    sqe->user_data = static_cast<uint64_t>(index);
+    if (registered_) {
+      sqe->opcode = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+      sqe->addr = reinterpret_cast<uintptr_t>(iovecs_[index].iov_base);
+      sqe->len = static_cast<unsigned>(size);
+      sqe->buf_index = static_cast<uint16_t>(index);
+    } else {
+      // The kernel may read the iovec only once the request runs, so it has
+      // to stay put until then; each buffer has its own.
+      iovecs_[index].iov_len = static_cast<size_t>(size);
+      sqe->opcode = write ? IORING_OP_WRITEV : IORING_OP_READV;
+      sqe->addr = reinterpret_cast<uintptr_t>(&iovecs_[index]);
+      sqe->len = 1;
+    }
+    return Enter();
+  }
+
+  // Asks the kernel to cancel the request for buffer `index`.  The request
+  // still completes, with -ECANCELED if it was cancelled in time.  Returns
+  // zero or an errno.
+  int Cancel(int index) {
+    io_uring_sqe* sqe = NextSqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = static_cast<uint64_t>(index);
+    sqe->user_data = kCancelUserData;
+    return Enter();
+  }
+
+  // Waits for the next completion of a read or write.  Returns zero or an
+  // errno.
+  int Wait(int* index, int* result) {
+    while (true) {
+      const unsigned head = *cq_head_;
+      if (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+        const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+        const uint64_t user_data = cqe.user_data;
+        *index = static_cast<int>(user_data);
+        *result = cqe.res;
+        __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+        if (user_data == kCancelUserData) continue;
+        return 0;
+      }
+      if (syscall(__NR_io_uring_enter, ring_fd_, 0, 1, IORING_ENTER_GETEVENTS,
+                  nullptr, 0) < 0 &&
+          errno != EINTR) {
+        return errno;
+      }
+    }
+  }
+
+ private:
+  // Marks the completions of cancel requests, which Wait() skips.
+  static constexpr uint64_t kCancelUserData = ~uint64_t{0};
+
+  IoUring() = default;
+
+  // Returns a cleared submission queue entry to fill in before Enter().
+  io_uring_sqe* NextSqe() {
+    const unsigned slot = *sq_tail_ & sq_mask_;
+    io_uring_sqe* sqe = &sqes_[slot];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array_[slot] = slot;
+    return sqe;
+  }
+
+  // Submits the entry returned by NextSqe().  Returns zero or an errno.
+  int Enter() {
+    __atomic_store_n(sq_tail_, *sq_tail_ + 1, __ATOMIC_RELEASE);
+    int result;
+    do {
+      result = static_cast<int>(
+          syscall(__NR_io_uring_enter, ring_fd_, 1, 0, 0, nullptr, 0));
+    } while (result < 0 && errno == EINTR);
+    return result < 0 ? errno : 0;
+  }
+
+  bool Setup(unsigned entries) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (ring_fd_ < 0) return false;
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = false;
+#ifdef IORING_FEAT_SINGLE_MMAP
+    single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+#endif
+    if (single_mmap) {
+      sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    sq_ring_ = Map(sq_ring_size_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == nullptr) return false;
+    cq_ring_ = single_mmap ? sq_ring_ : Map(cq_ring_size_, IORING_OFF_CQ_RING);
+    if (cq_ring_ == nullptr) return false;
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(Map(sqes_size_, IORING_OFF_SQES));
+    if (sqes_ == nullptr) return false;
+
+    char* sq = static_cast<char*>(sq_ring_);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    char* cq = static_cast<char*>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+  }
+
+  void* Map(size_t size, off_t offset) {
+    void* result = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring_fd_, offset);
+    return result == MAP_FAILED ? nullptr : result;
+  }
+
+  int ring_fd_ = -1;
+  void* sq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  void* cq_ring_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+
+  // Only this thread submits and reaps, so the submission tail and the
+  // completion head are read without synchronization.
+  unsigned* sq_tail_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned* sq_array_ = nullptr;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  io_uring_cqe* cqes_ = nullptr;
+
+  std::vector<iovec> iovecs_;
+  bool registered_ = false;
+};
+
+namespace {
+
+int ReadAt(int fd, char* data, int size, int64_t offset) {
+  return static_cast<int>(pread(fd, data, static_cast<size_t>(size), offset));
+}
+
+int WriteAt(int fd, const char* data, int size, int64_t offset) {
+  return static_cast<int>(pwrite(fd, data, static_cast<size_t>(size), offset));
+}
+
+int SeekTo(int fd, int64_t offset) {
+  return lseek(fd, offset, SEEK_SET) < 0 ? -1 : 0;
+}
+
+}  // namespace
+
+#else  // GOOGLE_PROTOBUF_IO_URING_AVAILABLE
+
+// The streams always fall back to FileInputStream and FileOutputStream, so
+// none of this is ever called.
+class IoUring {
+ public:
+  static std::unique_ptr<IoUring> Create(int, char*, int) { return nullptr; }
+  int Submit(bool, int, int, int, int64_t) { return ENOSYS; }
+  int Cancel(int) { return ENOSYS; }
+  int Wait(int*, int*) { return ENOSYS; }
+};
+
+namespace {
+
+int ReadAt(int, char*, int, int64_t) {
+  errno = ENOSYS;
+  return -1;
+}
+
+int WriteAt(int, const char*, int, int64_t) {
+  errno = ENOSYS;
+  return -1;
+}
+
+int SeekTo(int, int64_t) {
+  errno = ENOSYS;
+  return -1;
+}
+
+}  // namespace
+
+#endif  // !GOOGLE_PROTOBUF_IO_URING_AVAILABLE
+
+namespace {
+
+// EINTR sucks.
+int close_no_eintr(int fd) {
+  int result;
+  do {
+    result = close(fd);
+  } while (result < 0 && errno == EINTR);
+  return result;
+}
+
+// Called when waiting for a completion failed.  The kernel may still be
+// reading into or writing from the buffers that are in flight, so cancels
+// their requests and waits for them to finish.  If even that fails, the ring
+// and the buffers are leaked rather than freed under the kernel.
+template <typename Buffer>
+void AbandonRequests(std::unique_ptr<IoUring>& ring,
+                     std::unique_ptr<char[]>& storage,
+                     std::vector<Buffer>& buffers) {
+  int in_flight = 0;
+  for (int i = 0; i < static_cast<int>(buffers.size()); ++i) {
+    if (!buffers[i].in_flight) continue;
+    ++in_flight;
+    // If the cancel cannot be queued the request still completes, just later.
+    ring->Cancel(i);
+  }
+  while (in_flight > 0) {
+    int index;
+    int result;
+    if (ring->Wait(&index, &result) != 0) {
+      (void)ring.release();
+      (void)storage.release();
+      break;
+    }
+    if (index >= 0 && index < static_cast<int>(buffers.size()) &&
+        buffers[index].in_flight) {
+      buffers[index].in_flight = false;
+      --in_flight;
+    }
+  }
+  for (Buffer& buffer : buffers) buffer.in_flight = false;
+}
+
+}  // namespace
+
+// ===================================================================
+
+AsyncFileInputStream::AsyncFileInputStream(
+    int file_descriptor, const AsyncFileStreamOptions& options)
+    : file_(file_descriptor) {
+  if (!Init(options)) {
+    ring_.reset();
+    fallback_ = std::make_unique<FileInputStream>(file_descriptor);
+  }
+}
+
+AsyncFileInputStream::~AsyncFileInputStream() {
+  // The kernel may still be writing into the buffers.
+  for (const Buffer& buffer : buffers_) {
+    while (buffer.in_flight) Reap();
+  }
+}
+
+bool AsyncFileInputStream::Init(const AsyncFileStreamOptions& options) {
+#ifdef GOOGLE_PROTOBUF_IO_URING_AVAILABLE
+  if (options.buffer_size <= 0 || options.num_buffers <= 0) return false;
+  struct stat info;
+  if (fstat(file_, &info) != 0 || !S_ISREG(info.st_mode)) return false;
+  const off_t offset = lseek(file_, 0, SEEK_CUR);
+  if (offset < 0) return false;
+
+  buffer_size_ = options.buffer_size;
+  storage_.reset(
+      new char[static_cast<size_t>(buffer_size_) * options.num_buffers]);
+  ring_ = IoUring::Create(options.num_buffers, storage_.get(), buffer_size_);
+  if (ring_ == nullptr) return false;
+  for (int i = 0; i < options.num_buffers; ++i) {
+    buffers_.push_back(
+        {storage_.get() + static_cast<size_t>(i) * buffer_size_, 0, 0, false});
+  }
+
+  next_offset_ = offset;
+  for (int i = 0; i < options.num_buffers; ++i) Submit(i);
+  if (errno_ != 0) {
+    // The ring was set up but refuses requests, e.g. in a sandbox.
+    for (const Buffer& buffer : buffers_) {
+      while (buffer.in_flight) Reap();
+    }
+    buffers_.clear();
+    errno_ = 0;
+    return false;
+  }
+  return true;
+#else
+  (void)options;
+  return false;
+#endif
+}
+
+void AsyncFileInputStream::Submit(int index) {
+  if (eof_queued_ || errno_ != 0) return;
+  Buffer& buffer = buffers_[index];
+  buffer.offset = next_offset_;
+  buffer.size = 0;
+  next_offset_ += buffer_size_;
+  const int error =
+      ring_->Submit(/*write=*/false, file_, index, buffer_size_, buffer.offset);
+  if (error != 0) {
+    errno_ = error;
+    return;
+  }
+  buffer.in_flight = true;
+}
+
+void AsyncFileInputStream::Reap() {
+  int index;
+  int result;
+  const int error = ring_->Wait(&index, &result);
+  if (error != 0) {
+    errno_ = error;
+    AbandonRequests(ring_, storage_, buffers_);
+    return;
+  }
+  buffers_[index].size = result;
+  buffers_[index].in_flight = false;
+}
+
+bool AsyncFileInputStream::Wait(int index) {
+  Buffer& buffer = buffers_[index];
+  while (buffer.in_flight) Reap();
+  if (errno_ != 0) return false;
+  if (buffer.size < 0) {
+    errno_ = -buffer.size;
+    return false;
+  }
+  // Reads come up short at the end of the file, and occasionally before it.
+  // Complete the buffer synchronously; a read of zero bytes means the end of
+  // the file.
+  while (buffer.size < buffer_size_) {
+    const int bytes = ReadAt(file_, buffer.data + buffer.size,
+                             buffer_size_ - buffer.size,
+                             buffer.offset + buffer.size);
+    if (bytes < 0) {
+      if (errno == EINTR) continue;
+      errno_ = errno;
+      return false;
+    }
+    if (bytes == 0) {
+      eof_queued_ = true;
+      break;
+    }
+    buffer.size += bytes;
+  }
+  return true;
+}
+
+int AsyncFileInputStream::GetErrno() const {
+  return fallback_ != nullptr ? fallback_->GetErrno() : errno_;
+}
+
+bool AsyncFileInputStream::Next(const void** data, int* size) {
+  if (fallback_ != nullptr) return fallback_->Next(data, size);
+  if (errno_ != 0) return false;
+
+  if (current_ >= 0) {
+    const Buffer& buffer = buffers_[current_];
+    if (current_position_ < buffer.size) {
+      // The caller backed up into this buffer.
+      last_returned_size_ = buffer.size - current_position_;
+      *data = buffer.data + current_position_;
+      *size = last_returned_size_;
+      current_position_ = buffer.size;
+      position_ += last_returned_size_;
+      return true;
+    }
+    if (buffer.size < buffer_size_) {
+      // This was the last buffer of the file.
+      last_returned_size_ = 0;
+      return false;
+    }
+    // The caller is done with this buffer; reuse it further ahead.
+    Submit(current_);
+    current_ = (current_ + 1) % static_cast<int>(buffers_.size());
+  } else {
+    current_ = 0;
+  }
+
+  current_position_ = 0;
+  if (!Wait(current_) || buffers_[current_].size == 0) {
+    last_returned_size_ = 0;
+    return false;
+  }
+  const Buffer& buffer = buffers_[current_];
+  last_returned_size_ = buffer.size;
+  *data = buffer.data;
+  *size = buffer.size;
+  current_position_ = buffer.size;
+  position_ += buffer.size;
+  return true;
+}
+
+void AsyncFileInputStream::BackUp(int count) {
+  if (fallback_ != nullptr) {
+    fallback_->BackUp(count);
+    return;
+  }
+  ABSL_CHECK_GT(last_returned_size_, 0)
+      << "BackUp() can only be called after a successful Next().";
+  ABSL_CHECK_LE(count, last_returned_size_);
+  ABSL_CHECK_GE(count, 0);
+  current_position_ -= count;
+  position_ -= count;
+  last_returned_size_ = 0;  // Don't let caller back up further.
+}
+
+bool AsyncFileInputStream::Skip(int count) {
+  if (fallback_ != nullptr) return fallback_->Skip(count);
+  ABSL_CHECK_GE(count, 0);
+  const void* data;
+  int size;
+  while (count > 0) {
+    if (!Next(&data, &size)) return false;
+    if (size > count) {
+      BackUp(size - count);
+      return true;
+    }
+    count -= size;
+  }
+  last_returned_size_ = 0;  // Don't let caller back up.
+  return true;
+}
+
+int64_t AsyncFileInputStream::ByteCount() const {
+  return fallback_ != nullptr ? fallback_->ByteCount() : position_;
+}
+
+// ===================================================================
+
+AsyncFileOutputStream::AsyncFileOutputStream(
+    int file_descriptor, const AsyncFileStreamOptions& options)
+    : file_(file_descriptor) {
+  if (!Init(options)) {
+    ring_.reset();
+    fallback_ = std::make_unique<FileOutputStream>(file_descriptor);
+  }
+}
+
+AsyncFileOutputStream::~AsyncFileOutputStream() {
+  if (fallback_ == nullptr && !is_closed_) Flush();
+  // Flush() waits for all writes, unless the ring itself failed.
+  for (const Buffer& buffer : buffers_) {
+    while (buffer.in_flight) Reap();
+  }
+}
+
+bool AsyncFileOutputStream::Init(const AsyncFileStreamOptions& options) {
+#ifdef GOOGLE_PROTOBUF_IO_URING_AVAILABLE
+  if (options.buffer_size <= 0 || options.num_buffers <= 0) return false;
+  struct stat info;
+  if (fstat(file_, &info) != 0 || !S_ISREG(info.st_mode)) return false;
+  // Appends have to be ordered by the kernel, which positioned writes don't
+  // allow.
+  const int flags = fcntl(file_, F_GETFL);
+  if (flags < 0 || (flags & O_APPEND) != 0) return false;
+  const off_t offset = lseek(file_, 0, SEEK_CUR);
+  if (offset < 0) return false;
+
+  buffer_size_ = options.buffer_size;
+  storage_.reset(
+      new char[static_cast<size_t>(buffer_size_) * options.num_buffers]);
+  ring_ = IoUring::Create(options.num_buffers, storage_.get(), buffer_size_);
+  if (ring_ == nullptr) return false;
+  for (int i = 0; i < options.num_buffers; ++i) {
+    buffers_.push_back({storage_.get() + static_cast<size_t>(i) * buffer_size_,
+                        0, 0, 0, false});
+  }
+  position_ = start_offset_ = offset;
+  return true;
+#else
+  (void)options;
+  return false;
+#endif
+}
+
+void AsyncFileOutputStream::SubmitCurrent() {
+  if (current_size_ == 0 || errno_ != 0) return;
+  Buffer& buffer = buffers_[current_];
+  buffer.offset = position_;
+  buffer.size = current_size_;
+  buffer.result = 0;
+  position_ += current_size_;
+  current_size_ = 0;
+  const int error =
+      ring_->Submit(/*write=*/true, file_, current_, buffer.size, buffer.offset);
+  if (error != 0) {
+    errno_ = error;
+    return;
+  }
+  buffer.in_flight = true;
+}
+
+void AsyncFileOutputStream::Reap() {
+  int index;
+  int result;
+  const int error = ring_->Wait(&index, &result);
+  if (error != 0) {
+    errno_ = error;
+    AbandonRequests(ring_, storage_, buffers_);
+    return;
+  }
+  buffers_[index].result = result;
+  buffers_[index].in_flight = false;
+}
+
+bool AsyncFileOutputStream::Wait(int index) {
+  Buffer& buffer = buffers_[index];
+  while (buffer.in_flight) Reap();
+  if (errno_ != 0) return false;
+  if (buffer.result < 0) {
+    errno_ = -buffer.result;
+    return false;
+  }
+  // Complete short writes synchronously.
+  int written = buffer.result;
+  while (written < buffer.size) {
+    const int bytes = WriteAt(file_, buffer.data + written,
+                              buffer.size - written, buffer.offset + written);
+    if (bytes < 0) {
+      if (errno == EINTR) continue;
+      errno_ = errno;
+      return false;
+    }
+    written += bytes;
+  }
+  buffer.size = 0;
+  buffer.result = 0;
+  return true;
+}
+
+bool AsyncFileOutputStream::Flush() {
+  if (fallback_ != nullptr) return fallback_->Flush();
+  if (current_ >= 0) SubmitCurrent();
+  bool ok = errno_ == 0;
+  for (int i = 0; i < static_cast<int>(buffers_.size()); ++i) {
+    ok &= Wait(i);
+  }
+  if (!ok) return false;
+  // Leave the descriptor where a FileOutputStream would have left it.
+  if (SeekTo(file_, position_) < 0) {
+    errno_ = errno;
+    return false;
+  }
+  return true;
+}
+
+bool AsyncFileOutputStream::Close() {
+  if (fallback_ != nullptr) return fallback_->Close();
+  ABSL_CHECK(!is_closed_);
+  const bool flush_succeeded = Flush();
+  is_closed_ = true;
+  if (close_no_eintr(file_) != 0) {
+    if (errno_ == 0) errno_ = errno;
+    return false;
+  }
+  return flush_succeeded;
+}
+
+int AsyncFileOutputStream::GetErrno() const {
+  return fallback_ != nullptr ? fallback_->GetErrno() : errno_;
+}
+
+bool AsyncFileOutputStream::Next(void** data, int* size) {
+  if (fallback_ != nullptr) return fallback_->Next(data, size);
+  if (errno_ != 0 || is_closed_) return false;
+
+  if (current_ >= 0 && current_size_ < buffer_size_) {
+    // Room is left in the current buffer, after a BackUp() or Flush().
+    *data = buffers_[current_].data + current_size_;
+    *size = buffer_size_ - current_size_;
+    current_size_ = buffer_size_;
+    return true;
+  }
+  if (current_ >= 0) {
+    SubmitCurrent();
+    current_ = (current_ + 1) % static_cast<int>(buffers_.size());
+  } else {
+    current_ = 0;
+  }
+  // Wait for the previous write from this buffer.
+  if (!Wait(current_)) return false;
+  *data = buffers_[current_].data;
+  *size = buffer_size_;
+  current_size_ = buffer_size_;
+  return true;
+}
+
+void AsyncFileOutputStream::BackUp(int count) {
+  if (fallback_ != nullptr) {
+    fallback_->BackUp(count);
+    return;
+  }
+  ABSL_CHECK_GE(count, 0);
+  ABSL_CHECK_LE(count, current_size_)
+      << "Can't back up over more bytes than were returned by the last call"
+         " to Next().";
+  current_size_ -= count;
+}
+
+int64_t AsyncFileOutputStream::ByteCount() const {
+  if (fallback_ != nullptr) return fallback_->ByteCount();
+  return position_ - start_offset_ + current_size_;
+}
+
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
@@ -0,0 +1,185 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// File streams that keep several reads or writes in flight with io_uring, so
+// that disk I/O overlaps with parsing and serialization.  Where io_uring is not
+// available (other platforms, old kernels, or sandboxes that block it) they
+// behave like FileInputStream and FileOutputStream.
+
+#ifndef GOOGLE_PROTOBUF_IO_ASYNC_FILE_STREAM_H__
+#define GOOGLE_PROTOBUF_IO_ASYNC_FILE_STREAM_H__
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "google/protobuf/io/zero_copy_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace io {
+
+class IoUring;
+
+struct AsyncFileStreamOptions {
+  // Size of each buffer returned by Next().
+  int buffer_size = 256 << 10;
+  // Number of buffers, and so the number of reads or writes in flight.
+  int num_buffers = 4;
+};
+
+// ===================================================================
+
+// A ZeroCopyInputStream which reads a regular file ahead of the caller.
+//
+// Reads of the next `num_buffers` buffers are queued as soon as the stream is
+// created, and each buffer is queued again as soon as the caller moves past it.
+// Reading starts at the current offset of the file descriptor, which is not
+// advanced.  Descriptors that are not regular files are read like
+// FileInputStream does.
+class PROTOBUF_EXPORT AsyncFileInputStream final : public ZeroCopyInputStream {
+ public:
+  explicit AsyncFileInputStream(
+      int file_descriptor,
+      const AsyncFileStreamOptions& options = AsyncFileStreamOptions());
+  AsyncFileInputStream(const AsyncFileInputStream&) = delete;
+  AsyncFileInputStream& operator=(const AsyncFileInputStream&) = delete;
+  ~AsyncFileInputStream() override;
+
+  // Returns true if reads go through io_uring.
+  bool is_async() const { return fallback_ == nullptr; }
+
+  // If an I/O error has occurred, this is the errno from that error.
+  // Otherwise, this is zero.  Once an error occurs, the stream is broken and
+  // all subsequent operations will fail.
+  int GetErrno() const;
+
+  // implements ZeroCopyInputStream ----------------------------------
+  bool Next(const void** data, int* size) override;
+  void BackUp(int count) override;
+  bool Skip(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  struct Buffer {
+    char* data;
+    int64_t offset;
+    int size;  // Bytes read, valid once the read has completed.
+    bool in_flight;
+  };
+
+  bool Init(const AsyncFileStreamOptions& options);
+  // Queues the read of buffer `index` at the next offset.
+  void Submit(int index);
+  // Waits for the read of buffer `index`.  Returns false on error.
+  bool Wait(int index);
+  // Waits for one completion.
+  void Reap();
+
+  const int file_;
+  std::unique_ptr<char[]> storage_;
+  std::vector<Buffer> buffers_;
+  std::unique_ptr<IoUring> ring_;  // Destroyed before the buffers.
+  int buffer_size_ = 0;
+  int64_t next_offset_ = 0;  // Offset of the next read to queue.
+  bool eof_queued_ = false;  // A read reached the end of the file.
+
+  int current_ = -1;          // Buffer last returned by Next().
+  int current_position_ = 0;  // Bytes of it consumed by the caller.
+  int last_returned_size_ = 0;
+  int64_t position_ = 0;
+  int errno_ = 0;
+
+  // Set when io_uring cannot be used.
+  std::unique_ptr<FileInputStream> fallback_;
+};
+
+// ===================================================================
+
+// A ZeroCopyOutputStream which writes a regular file behind the caller.
+//
+// Each buffer is queued for writing as soon as it is full, and the caller
+// continues in the next buffer while the write is in flight.  Writing starts at
+// the current offset of the file descriptor, which is moved to the end of the
+// written data by Flush().  Descriptors that are not regular files, or were
+// opened with O_APPEND, are written like FileOutputStream does.
+class PROTOBUF_EXPORT AsyncFileOutputStream final
+    : public ZeroCopyOutputStream {
+ public:
+  explicit AsyncFileOutputStream(
+      int file_descriptor,
+      const AsyncFileStreamOptions& options = AsyncFileStreamOptions());
+  AsyncFileOutputStream(const AsyncFileOutputStream&) = delete;
+  AsyncFileOutputStream& operator=(const AsyncFileOutputStream&) = delete;
+  ~AsyncFileOutputStream() override;  // Flushes.
+
+  // Writes out all buffered data and waits for the writes to complete.
+  // Returns false if an error occurs; use GetErrno() to examine the error.
+  bool Flush();
+
+  // Flushes and closes the underlying file.  Even if an error occurs, the file
+  // descriptor is closed when this returns.
+  bool Close();
+
+  // Returns true if writes go through io_uring.
+  bool is_async() const { return fallback_ == nullptr; }
+
+  // If an I/O error has occurred, this is the errno from that error.
+  // Otherwise, this is zero.  Once an error occurs, the stream is broken and
+  // all subsequent operations will fail.
+  int GetErrno() const;
+
+  // implements ZeroCopyOutputStream ---------------------------------
+  bool Next(void** data, int* size) override;
+  void BackUp(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  struct Buffer {
+    char* data;
+    int64_t offset;
+    int size;    // Bytes queued for writing.
+    int result;  // Result of the write, valid once it has completed.
+    bool in_flight;
+  };
+
+  bool Init(const AsyncFileStreamOptions& options);
+  // Queues the write of the current buffer.
+  void SubmitCurrent();
+  // Waits for the write of buffer `index`.  Returns false on error.
+  bool Wait(int index);
+  // Waits for one completion.
+  void Reap();
+
+  const int file_;
+  std::unique_ptr<char[]> storage_;
+  std::vector<Buffer> buffers_;
+  std::unique_ptr<IoUring> ring_;  // Destroyed before the buffers.
+  int buffer_size_ = 0;
+
+  int current_ = -1;      // Buffer last returned by Next().
+  int current_size_ = 0;  // Bytes of it filled by the caller.
+  int64_t position_ = 0;  // File offset of the current buffer.
+  int64_t start_offset_ = 0;
+  bool is_closed_ = false;
+  int errno_ = 0;
+
+  // Set when io_uring cannot be used.
+  std::unique_ptr<FileOutputStream> fallback_;
+};
+
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_IO_ASYNC_FILE_STREAM_H__
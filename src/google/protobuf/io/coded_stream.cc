@@ -724,6 +724,7 @@ bool CodedInputStream::Refresh() {
 
 void EpsCopyOutputStream::EnableAliasing(bool enabled) {
   aliasing_enabled_ = enabled && stream_->AllowsAliasing();
+  prefer_aliasing_ = aliasing_enabled_ && stream_->PrefersAliasing();
 }
 
 int64_t EpsCopyOutputStream::ByteCount(uint8_t* ptr) const {
@@ -906,8 +907,10 @@ uint8_t* EpsCopyOutputStream::WriteRawFallback(const void* data, int size,
 
 uint8_t* EpsCopyOutputStream::WriteAliasedRaw(const void* data, int size,
                                             uint8_t* ptr) {
-  if (size < GetSize(ptr)
-  ) {
+  // Values that fit in the buffer are copied, except that streams that keep
+  // references (e.g. SegmentOutputStream) get the large ones, like cords.
+  if (size < GetSize(ptr) &&
+      (size < kMaxCordBytesToCopy || !prefer_aliasing_)) {
     return WriteRaw(data, size, ptr);
   } else {
     ptr = Trim(ptr);
@@ -88,6 +88,7 @@
 
 #include <assert.h>
 
+#include <algorithm>
 #include <atomic>
 #include <climits>
 #include <cstddef>
@@ -822,6 +823,9 @@ class PROTOBUF_EXPORT EpsCopyOutputStream {
   ZeroCopyOutputStream* stream_;
   bool had_error_ = false;
   bool aliasing_enabled_ = false;  // See EnableAliasing().
+  // Whether large values that fit in the buffer are aliased rather than
+  // copied. See ZeroCopyOutputStream::PrefersAliasing().
+  bool prefer_aliasing_ = false;
   bool is_serialization_deterministic_;
   bool skip_check_consistency = false;
 
@@ -870,6 +874,10 @@ class PROTOBUF_EXPORT EpsCopyOutputStream {
   uint8_t* WriteStringOutline(uint32_t num, absl::string_view s, uint8_t* ptr);
   uint8_t* WriteCordOutline(const absl::Cord& c, uint8_t* ptr);
 
+  // `size` is the encoded length of the elements. The length prefix comes
+  // before them and a flushed buffer can't be patched, so the caller has to
+  // know it up front; generated code passes the size it cached in
+  // ByteSizeLong() rather than sizing the elements again.
   template <typename T, typename E>
   PROTOBUF_ALWAYS_INLINE uint8_t* WriteVarintPacked(int num, const T& r,
                                                     int size, uint8_t* ptr,
@@ -878,13 +886,52 @@ class PROTOBUF_EXPORT EpsCopyOutputStream {
     ptr = WriteLengthDelim(num, size, ptr);
     auto it = r.data();
     auto end = it + r.size();
+    // The longest encoding of an element.
+    constexpr int kMaxSize = sizeof(encode(*it)) == 4 ? 5 : 10;
     do {
       ptr = EnsureSpace(ptr);
-      ptr = UnsafeVarint(encode(*it++), ptr);
+      // Encode as many elements as are sure to fit in the buffer, slop
+      // included, without checking for space in between.
+      auto batch_end =
+          it + std::min<ptrdiff_t>(end - it, GetSize(ptr) / kMaxSize);
+      ptr = UnsafeVarintArray(it, batch_end, ptr, encode);
+      it = batch_end;
     } while (it < end);
     return ptr;
   }
 
+  // Encodes the elements in [it, end) as varints without bounds checks.
+  // Values of packed fields are mostly small: groups of 8 elements that all
+  // take a single byte are written with one store. The group loop is written
+  // so that it vectorizes into a compare and a pack. Each element is encoded
+  // once; a group with a multi-byte element writes the values it already
+  // encoded.
+  template <typename T, typename E>
+  PROTOBUF_ALWAYS_INLINE static uint8_t* UnsafeVarintArray(const T* it,
+                                                           const T* end,
+                                                           uint8_t* ptr,
+                                                           const E& encode) {
+    using Encoded = decltype(encode(*it));
+    for (; end - it >= 8; it += 8) {
+      Encoded all = 0;
+      Encoded values[8];
+      for (int i = 0; i < 8; ++i) {
+        values[i] = encode(it[i]);
+        all |= values[i];
+      }
+      if (PROTOBUF_PREDICT_TRUE(all < 0x80)) {
+        uint8_t bytes[8];
+        for (int i = 0; i < 8; ++i) bytes[i] = static_cast<uint8_t>(values[i]);
+        std::memcpy(ptr, bytes, sizeof(bytes));
+        ptr += sizeof(bytes);
+      } else {
+        for (int i = 0; i < 8; ++i) ptr = UnsafeVarint(values[i], ptr);
+      }
+    }
+    while (it < end) ptr = UnsafeVarint(encode(*it++), ptr);
+    return ptr;
+  }
+
   static uint32_t Encode32(uint32_t v) { return v; }
   static uint64_t Encode64(uint64_t v) { return v; }
   static uint32_t ZigZagEncode32(int32_t v) {
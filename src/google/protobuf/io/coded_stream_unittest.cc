@@ -755,6 +755,44 @@ TEST_P(BlockSizes, WriteRaw) {
   EXPECT_EQ(0, memcmp(buffer_, kRawBytes, sizeof(kRawBytes)));
 }
 
+TEST_P(BlockSizes, WriteVarintPacked) {
+  int kBlockSizes_case = GetParam();
+  // Runs of single byte values with multi-byte and negative ones mixed in.
+  std::vector<int32_t> values;
+  for (int i = 0; i < 1000; i++) {
+    values.push_back(i % 37 == 0 ? -i : i % 11 == 0 ? i << 12 : i % 100);
+  }
+
+  std::string expected;
+  {
+    StringOutputStream output(&expected);
+    CodedOutputStream coded_output(&output);
+    for (int32_t value : values) {
+      coded_output.WriteVarint32SignExtended(value);
+    }
+  }
+  std::string expected_field = "\x0a";
+  {
+    StringOutputStream output(&expected_field);
+    CodedOutputStream coded_output(&output);
+    coded_output.WriteVarint32(static_cast<uint32_t>(expected.size()));
+  }
+  expected_field += expected;
+
+  ArrayOutputStream output(buffer_, sizeof(buffer_), kBlockSizes_case);
+  {
+    CodedOutputStream coded_output(&output);
+    coded_output.SetCur(coded_output.EpsCopy()->WriteInt32Packed(
+        1, values, static_cast<int>(expected.size()), coded_output.Cur()));
+    EXPECT_FALSE(coded_output.HadError());
+  }
+
+  EXPECT_EQ(expected_field.size(), output.ByteCount());
+  EXPECT_EQ(expected_field,
+            absl::string_view(reinterpret_cast<const char*>(buffer_),
+                              expected_field.size()));
+}
+
 TEST_P(BlockSizes, ReadString) {
   int kBlockSizes_case = GetParam();
   memcpy(buffer_, kRawBytes, sizeof(kRawBytes));
@@ -240,6 +240,12 @@ class PROTOBUF_EXPORT ZeroCopyOutputStream {
   virtual bool WriteAliasedRaw(const void* data, int size);
   virtual bool AllowsAliasing() const { return false; }
 
+  // Returns true if WriteAliasedRaw() references the data rather than copying
+  // it, so that values that would fit in the buffer returned by Next() are
+  // still worth passing to it when they are large. Only meaningful if
+  // AllowsAliasing() is true.
+  virtual bool PrefersAliasing() const { return false; }
+
   // Writes the given Cord to the output.
   //
   // The default implementation iterates over all Cord chunks copying all cord
@@ -15,10 +15,17 @@
 #include <sys/types.h>
 #include <unistd.h>
 #endif
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
 #include <errno.h>
 
 #include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <memory>
 
 #include "google/protobuf/stubs/common.h"
 #include "absl/log/absl_check.h"
@@ -147,6 +154,112 @@ int FileInputStream::CopyingFileInputStream::Skip(int count) {
 
 // ===================================================================
 
+MmapInputStream::MmapInputStream(int file_descriptor)
+    : MmapInputStream(file_descriptor, Options()) {}
+
+MmapInputStream::MmapInputStream(int file_descriptor, const Options& options) {
+  if (!Map(file_descriptor, options)) {
+    fallback_ = std::make_unique<FileInputStream>(file_descriptor);
+  }
+}
+
+MmapInputStream::~MmapInputStream() {
+#ifndef _WIN32
+  if (mapping_ != nullptr) munmap(mapping_, mapping_size_);
+#endif
+}
+
+bool MmapInputStream::Map(int file_descriptor, const Options& options) {
+#ifdef _WIN32
+  (void)file_descriptor;
+  (void)options;
+  return false;
+#else
+  struct stat info;
+  if (fstat(file_descriptor, &info) != 0 || !S_ISREG(info.st_mode)) {
+    return false;
+  }
+  const off_t offset = lseek(file_descriptor, 0, SEEK_CUR);
+  if (offset < 0) return false;
+  if (offset >= info.st_size) {
+    // Nothing left to read; there is nothing to map either.
+    return true;
+  }
+  // Mappings have to start at a page boundary.
+  const off_t page_size = sysconf(_SC_PAGESIZE);
+  const off_t map_offset = offset - offset % page_size;
+  const size_t map_size = static_cast<size_t>(info.st_size - map_offset);
+  int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+  if (options.populate) flags |= MAP_POPULATE;
+#endif
+  void* mapping =
+      mmap(nullptr, map_size, PROT_READ, flags, file_descriptor, map_offset);
+  if (mapping == MAP_FAILED) return false;
+#ifdef MADV_SEQUENTIAL
+  if (options.sequential) madvise(mapping, map_size, MADV_SEQUENTIAL);
+#endif
+  mapping_ = mapping;
+  mapping_size_ = map_size;
+  data_ = static_cast<const char*>(mapping) + (offset - map_offset);
+  size_ = static_cast<size_t>(info.st_size - offset);
+  return true;
+#endif  // _WIN32
+}
+
+int MmapInputStream::GetErrno() const {
+  return fallback_ == nullptr ? 0 : fallback_->GetErrno();
+}
+
+bool MmapInputStream::Next(const void** data, int* size) {
+  if (fallback_ != nullptr) return fallback_->Next(data, size);
+  if (position_ < size_) {
+    last_returned_size_ =
+        static_cast<int>(std::min<size_t>(INT_MAX, size_ - position_));
+    *data = data_ + position_;
+    *size = last_returned_size_;
+    position_ += last_returned_size_;
+    return true;
+  } else {
+    // We're at the end of the file.
+    last_returned_size_ = 0;  // Don't let caller back up.
+    return false;
+  }
+}
+
+void MmapInputStream::BackUp(int count) {
+  if (fallback_ != nullptr) {
+    fallback_->BackUp(count);
+    return;
+  }
+  ABSL_CHECK_GT(last_returned_size_, 0)
+      << "BackUp() can only be called after a successful Next().";
+  ABSL_CHECK_LE(count, last_returned_size_);
+  ABSL_CHECK_GE(count, 0);
+  position_ -= count;
+  last_returned_size_ = 0;  // Don't let caller back up further.
+}
+
+bool MmapInputStream::Skip(int count) {
+  if (fallback_ != nullptr) return fallback_->Skip(count);
+  ABSL_CHECK_GE(count, 0);
+  last_returned_size_ = 0;  // Don't let caller back up.
+  if (static_cast<size_t>(count) > size_ - position_) {
+    position_ = size_;
+    return false;
+  } else {
+    position_ += count;
+    return true;
+  }
+}
+
+int64_t MmapInputStream::ByteCount() const {
+  if (fallback_ != nullptr) return fallback_->ByteCount();
+  return static_cast<int64_t>(position_);
+}
+
+// ===================================================================
+
 FileOutputStream::FileOutputStream(int file_descriptor, int block_size)
     : CopyingOutputStreamAdaptor(&copying_output_, block_size),
       copying_output_(file_descriptor) {}
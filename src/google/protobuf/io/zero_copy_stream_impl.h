@@ -17,10 +17,14 @@
 #ifndef GOOGLE_PROTOBUF_IO_ZERO_COPY_STREAM_IMPL_H__
 #define GOOGLE_PROTOBUF_IO_ZERO_COPY_STREAM_IMPL_H__
 
+#include <cstddef>
+#include <cstdint>
 #include <iosfwd>
+#include <memory>
 #include <string>
 
 #include "google/protobuf/stubs/common.h"
+#include "absl/strings/string_view.h"
 #include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 
@@ -110,6 +114,77 @@ class PROTOBUF_EXPORT FileInputStream final : public ZeroCopyInputStream {
 
 // ===================================================================
 
+// A ZeroCopyInputStream which memory-maps a file instead of reading it.
+//
+// The contents are returned straight from the mapping, in as few calls to
+// Next() as possible (each returns at most INT_MAX bytes), so a parser sees
+// one flat buffer and nothing is copied.  Reading starts at the current offset
+// of the file descriptor, which is not advanced.
+//
+// The file must not be truncated while the stream exists: touching mapped
+// pages past the new end of the file raises SIGBUS.  If the descriptor cannot
+// be mapped, e.g. because it is a pipe or mmap() is not available, the stream
+// reads it like FileInputStream instead.
+//
+// The stream never closes the descriptor.  Once it is constructed, the caller
+// may close the descriptor only if is_mapped() is true; otherwise the fallback
+// keeps read()ing from it and it must stay open until the stream is destroyed.
+class PROTOBUF_EXPORT MmapInputStream final : public ZeroCopyInputStream {
+ public:
+  struct Options {
+    // Tells the kernel the mapping is read sequentially (MADV_SEQUENTIAL), so
+    // that it reads ahead aggressively and drops pages behind the reader.
+    bool sequential = true;
+    // Reads the whole file into memory when mapping it (MAP_POPULATE, Linux
+    // only) instead of faulting pages in as they are first touched.
+    bool populate = false;
+  };
+
+  explicit MmapInputStream(int file_descriptor);
+  MmapInputStream(int file_descriptor, const Options& options);
+  MmapInputStream(const MmapInputStream&) = delete;
+  MmapInputStream& operator=(const MmapInputStream&) = delete;
+  ~MmapInputStream() override;
+
+  // Returns the mapped contents, from the starting offset to the end of the
+  // file.  They stay valid until the stream is destroyed.  Empty if the file
+  // is not mapped.
+  absl::string_view mapped_data() const {
+    return absl::string_view(data_, size_);
+  }
+
+  // Returns true if the file is read through a mapping rather than read().
+  bool is_mapped() const { return fallback_ == nullptr; }
+
+  // If an I/O error has occurred while reading an unmapped file, this is the
+  // errno from that error.  Otherwise, this is zero.
+  int GetErrno() const;
+
+  // implements ZeroCopyInputStream ----------------------------------
+  bool Next(const void** data, int* size) override;
+  void BackUp(int count) override;
+  bool Skip(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  // Maps the file from its current offset.  Returns false if that fails.
+  bool Map(int file_descriptor, const Options& options);
+
+  // The whole mapping, which starts at a page boundary at or before data_.
+  void* mapping_ = nullptr;
+  size_t mapping_size_ = 0;
+
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+  size_t position_ = 0;
+  int last_returned_size_ = 0;
+
+  // Set when the file could not be mapped.
+  std::unique_ptr<FileInputStream> fallback_;
+};
+
+// ===================================================================
+
 // A ZeroCopyOutputStream which writes to a file descriptor.
 //
 // FileOutputStream is preferred over using an ofstream with
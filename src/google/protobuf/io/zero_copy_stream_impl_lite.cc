@@ -20,6 +20,8 @@
 #include "absl/log/absl_check.h"
 #include "absl/strings/cord.h"
 #include "absl/strings/internal/resize_uninitialized.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/arena.h"
 
 // Must be included last
 #include "google/protobuf/port_def.inc"
@@ -679,6 +681,79 @@ absl::Cord CordOutputStream::Consume() {
   return std::move(cord_);
 }
 
+// ===================================================================
+
+SegmentOutputStream::SegmentOutputStream(Arena* arena, int block_size)
+    : arena_(arena), next_block_size_(static_cast<size_t>(block_size)) {
+  ABSL_DCHECK_GT(block_size, 0);
+}
+
+SegmentOutputStream::~SegmentOutputStream() = default;
+
+bool SegmentOutputStream::Next(void** data, int* size) {
+  // Blocks double in size up to this, so a large message takes few blocks
+  // without wasting much memory on a small one.
+  static const size_t kMaxBlockSize = 1 << 20;
+
+  if (block_ptr_ == block_end_) {
+    const size_t block_size = next_block_size_;
+    next_block_size_ = std::min(2 * next_block_size_, kMaxBlockSize);
+    if (arena_ != nullptr) {
+      block_ptr_ = Arena::CreateArray<char>(arena_, block_size);
+    } else {
+      owned_blocks_.emplace_back(new char[block_size]);
+      block_ptr_ = owned_blocks_.back().get();
+    }
+    block_end_ = block_ptr_ + block_size;
+  }
+
+  const size_t n = static_cast<size_t>(block_end_ - block_ptr_);
+  if (!segments_.empty() &&
+      segments_.back().data() + segments_.back().size() == block_ptr_) {
+    // Continues the last segment after a BackUp().
+    segments_.back() =
+        absl::string_view(segments_.back().data(), segments_.back().size() + n);
+  } else {
+    segments_.emplace_back(block_ptr_, n);
+  }
+  *data = block_ptr_;
+  *size = static_cast<int>(n);
+  block_ptr_ = block_end_;
+  byte_count_ += static_cast<int64_t>(n);
+  return true;
+}
+
+void SegmentOutputStream::BackUp(int count) {
+  if (count == 0) return;
+  // BackUp() returns part of the buffer of the last call to Next().
+  ABSL_DCHECK(!segments_.empty());
+  ABSL_DCHECK_EQ(segments_.back().data() + segments_.back().size(),
+                 block_ptr_);
+  ABSL_DCHECK_LE(static_cast<size_t>(count), segments_.back().size());
+  segments_.back().remove_suffix(static_cast<size_t>(count));
+  if (segments_.back().empty()) segments_.pop_back();
+  block_ptr_ -= count;
+  byte_count_ -= count;
+}
+
+int64_t SegmentOutputStream::ByteCount() const { return byte_count_; }
+
+bool SegmentOutputStream::WriteAliasedRaw(const void* data, int size) {
+  if (size == 0) return true;
+  segments_.emplace_back(static_cast<const char*>(data),
+                         static_cast<size_t>(size));
+  byte_count_ += size;
+  return true;
+}
+
+bool SegmentOutputStream::WriteCord(const absl::Cord& cord) {
+  for (absl::string_view chunk : cord.Chunks()) {
+    segments_.push_back(chunk);
+  }
+  byte_count_ += static_cast<int64_t>(cord.size());
+  return true;
+}
+
 
 }  // namespace io
 }  // namespace protobuf
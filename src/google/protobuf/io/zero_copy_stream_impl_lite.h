@@ -21,10 +21,13 @@
 #ifndef GOOGLE_PROTOBUF_IO_ZERO_COPY_STREAM_IMPL_LITE_H__
 #define GOOGLE_PROTOBUF_IO_ZERO_COPY_STREAM_IMPL_LITE_H__
 
+#include <cstddef>
+#include <cstdint>
 #include <iosfwd>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "google/protobuf/stubs/callback.h"
 #include "google/protobuf/stubs/common.h"
@@ -32,6 +35,8 @@
 #include "absl/base/macros.h"
 #include "absl/strings/cord.h"
 #include "absl/strings/cord_buffer.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/port.h"
 
@@ -41,6 +46,9 @@
 
 namespace google {
 namespace protobuf {
+
+class Arena;
+
 namespace io {
 
 // ===================================================================
@@ -490,6 +498,59 @@ class PROTOBUF_EXPORT CordOutputStream final : public ZeroCopyOutputStream {
   absl::CordBuffer buffer_;
 };
 
+// ===================================================================
+
+// A ZeroCopyOutputStream that produces its output as a sequence of segments,
+// e.g. to be passed to writev() or sendmsg(), rather than as one buffer.
+//
+// Data written through Next() is stored in blocks owned by the stream, or
+// allocated on `arena` if not null. Data written with WriteAliasedRaw() or
+// WriteCord() is not copied but referenced by the segments, so it must remain
+// unchanged while they are in use. Serializing a message with aliasing
+// enabled references its large string, bytes and Cord fields in place:
+//
+//   SegmentOutputStream stream;
+//   {
+//     CodedOutputStream output(&stream);
+//     output.EnableAliasing(true);
+//     message.SerializeToCodedStream(&output);
+//   }
+//   // Send stream.segments() before modifying or destroying `message`.
+class PROTOBUF_EXPORT SegmentOutputStream final : public ZeroCopyOutputStream {
+ public:
+  // `block_size` is the size of the first block; later ones are larger.
+  explicit SegmentOutputStream(Arena* arena = nullptr, int block_size = 1024);
+  ~SegmentOutputStream() override;
+
+  // `SegmentOutputStream` is neither copiable nor assignable
+  SegmentOutputStream(const SegmentOutputStream&) = delete;
+  SegmentOutputStream& operator=(const SegmentOutputStream&) = delete;
+
+  // implements `ZeroCopyOutputStream` ---------------------------------
+  bool Next(void** data, int* size) final;
+  void BackUp(int count) final;
+  int64_t ByteCount() const final;
+  bool WriteAliasedRaw(const void* data, int size) final;
+  bool AllowsAliasing() const final { return true; }
+  bool PrefersAliasing() const final { return true; }
+  bool WriteCord(const absl::Cord& cord) final;
+
+  // The data written so far, in order. Adjacent data written through Next()
+  // is returned as a single segment.
+  absl::Span<const absl::string_view> segments() const { return segments_; }
+
+ private:
+  Arena* const arena_;
+  size_t next_block_size_;
+  // Unused part of the current block.
+  char* block_ptr_ = nullptr;
+  char* block_end_ = nullptr;
+  std::vector<absl::string_view> segments_;
+  int64_t byte_count_ = 0;
+  // Blocks allocated without an arena.
+  std::vector<std::unique_ptr<char[]>> owned_blocks_;
+};
+
 
 // ===================================================================
 
@@ -53,6 +53,8 @@
 #include "absl/strings/cord_buffer.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/io/async_file_stream.h"
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/io_win32.h"
 #include "google/protobuf/io/zero_copy_stream_impl.h"
@@ -1398,6 +1400,116 @@ TEST_F(IoTest, CordOutputBufferEndsAtSizeHint) {
   output.Consume();
 }
 
+std::string JoinSegments(const SegmentOutputStream& output) {
+  std::string res;
+  for (absl::string_view segment : output.segments()) {
+    absl::StrAppend(&res, segment);
+  }
+  return res;
+}
+
+TEST(SegmentOutputStreamTest, ReferencesAliasedData) {
+  SegmentOutputStream output(nullptr, 16);
+  void* data;
+  int size;
+  ASSERT_TRUE(output.Next(&data, &size));
+  ASSERT_GE(size, 3);
+  memcpy(data, "foo", 3);
+  output.BackUp(size - 3);
+
+  const std::string aliased(1000, 'a');
+  ASSERT_TRUE(output.WriteAliasedRaw(aliased.data(),
+                                     static_cast<int>(aliased.size())));
+  absl::Cord cord =
+      MakeFragmentedCord(std::vector<absl::string_view>{"bar", "baz"});
+  ASSERT_TRUE(output.WriteCord(cord));
+
+  // The rest of the first block is used after the aliased data.
+  ASSERT_TRUE(output.Next(&data, &size));
+  EXPECT_EQ(size, 13);
+  memcpy(data, "qux", 3);
+  output.BackUp(size - 3);
+
+  EXPECT_EQ(JoinSegments(output), absl::StrCat("foo", aliased, "barbazqux"));
+  EXPECT_EQ(output.ByteCount(), 1012);
+  ASSERT_GE(output.segments().size(), 2);
+  EXPECT_EQ(output.segments()[1].data(), aliased.data());
+}
+
+TEST(SegmentOutputStreamTest, MergesContiguousBuffers) {
+  Arena arena;
+  SegmentOutputStream output(&arena);
+  void* data;
+  int size;
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(output.Next(&data, &size));
+    memset(data, 'x', 1);
+    output.BackUp(size - 1);
+  }
+  EXPECT_EQ(JoinSegments(output), "xxx");
+  EXPECT_EQ(output.segments().size(), 1);
+}
+
+TEST(SegmentOutputStreamTest, SerializeWithoutCopyingLargeFields) {
+  protobuf_unittest::TestAllTypes message;
+  TestUtil::SetAllFields(&message);
+  message.set_optional_bytes(std::string(10000, 'x'));
+  message.add_repeated_nested_message()->set_bb(1);
+
+  SegmentOutputStream output;
+  {
+    CodedOutputStream coded_output(&output);
+    coded_output.EnableAliasing(true);
+    ASSERT_TRUE(message.SerializeToCodedStream(&coded_output));
+  }
+
+  EXPECT_EQ(JoinSegments(output), message.SerializeAsString());
+  bool aliased = false;
+  for (absl::string_view segment : output.segments()) {
+    aliased |= segment.data() == message.optional_bytes().data();
+  }
+  EXPECT_TRUE(aliased);
+}
+
+// Allows aliasing but copies the data, like CopyingOutputStreamAdaptor.
+class AliasCountingStream final : public ZeroCopyOutputStream {
+ public:
+  explicit AliasCountingStream(std::string* target)
+      : target_(target), output_(target) {}
+
+  bool Next(void** data, int* size) final { return output_.Next(data, size); }
+  void BackUp(int count) final { output_.BackUp(count); }
+  int64_t ByteCount() const final { return output_.ByteCount(); }
+  bool WriteAliasedRaw(const void* data, int size) final {
+    ++aliased_writes_;
+    target_->append(static_cast<const char*>(data), size);
+    return true;
+  }
+  bool AllowsAliasing() const final { return true; }
+
+  int aliased_writes() const { return aliased_writes_; }
+
+ private:
+  std::string* target_;
+  StringOutputStream output_;
+  int aliased_writes_ = 0;
+};
+
+TEST(SegmentOutputStreamTest, OtherStreamsCopyLargeValuesThatFit) {
+  std::string target;
+  target.reserve(4096);
+  AliasCountingStream output(&target);
+  const std::string value(1000, 'x');
+  {
+    CodedOutputStream coded_output(&output);
+    coded_output.EnableAliasing(true);
+    coded_output.WriteRawMaybeAliased(value.data(),
+                                      static_cast<int>(value.size()));
+  }
+  EXPECT_EQ(target, value);
+  EXPECT_EQ(output.aliased_writes(), 0);
+}
+
 
 // To test files, we create a temporary file, write, read, truncate, repeat.
 TEST_F(IoTest, FileIo) {
@@ -1431,6 +1543,144 @@ TEST_F(IoTest, FileIo) {
   }
 }
 
+TEST_F(IoTest, MmapIo) {
+  std::string filename =
+      absl::StrCat(::testing::TempDir(), "/zero_copy_stream_test_file");
+
+  for (int i = 0; i < kBlockSizeCount; i++) {
+    // Make a temporary file.
+    int file =
+        open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0777);
+    ASSERT_GE(file, 0);
+
+    {
+      FileOutputStream output(file, kBlockSizes[i]);
+      WriteStuff(&output);
+      EXPECT_EQ(0, output.GetErrno());
+    }
+
+    // Rewind.
+    ASSERT_NE(lseek(file, 0, SEEK_SET), (off_t)-1);
+
+    {
+      MmapInputStream input(file);
+#ifndef _WIN32
+      EXPECT_TRUE(input.is_mapped());
+#endif
+      ReadStuff(&input);
+      EXPECT_EQ(0, input.GetErrno());
+    }
+
+    close(file);
+  }
+}
+
+#ifndef _WIN32
+TEST_F(IoTest, MmapFromOffset) {
+  std::string filename =
+      absl::StrCat(::testing::TempDir(), "/zero_copy_stream_test_file");
+  int file =
+      open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0777);
+  ASSERT_GE(file, 0);
+  std::string contents(10000, 'x');
+  for (size_t i = 0; i < contents.size(); ++i) contents[i] += i % 7;
+  ASSERT_EQ(write(file, contents.data(), contents.size()),
+            static_cast<ssize_t>(contents.size()));
+  ASSERT_EQ(lseek(file, 5000, SEEK_SET), 5000);
+
+  MmapInputStream::Options options;
+  options.populate = true;
+  MmapInputStream input(file, options);
+  close(file);
+
+  EXPECT_EQ(input.mapped_data(), absl::string_view(contents).substr(5000));
+  const void* data;
+  int size;
+  ASSERT_TRUE(input.Next(&data, &size));
+  EXPECT_EQ(absl::string_view(static_cast<const char*>(data), size),
+            absl::string_view(contents).substr(5000));
+  input.BackUp(100);
+  EXPECT_EQ(input.ByteCount(), 4900);
+  EXPECT_FALSE(input.Skip(101));
+  EXPECT_FALSE(input.Next(&data, &size));
+}
+
+TEST_F(IoTest, MmapFallsBackForPipes) {
+  int fd[2];
+  ASSERT_EQ(pipe(fd), 0);
+  ASSERT_EQ(write(fd[1], "abc", 3), 3);
+  close(fd[1]);
+
+  MmapInputStream input(fd[0]);
+  EXPECT_FALSE(input.is_mapped());
+  EXPECT_TRUE(input.mapped_data().empty());
+  const void* data;
+  int size;
+  ASSERT_TRUE(input.Next(&data, &size));
+  EXPECT_EQ(absl::string_view(static_cast<const char*>(data), size), "abc");
+  EXPECT_FALSE(input.Next(&data, &size));
+  close(fd[0]);
+}
+#endif  // !_WIN32
+
+TEST_F(IoTest, AsyncFileIo) {
+  std::string filename =
+      absl::StrCat(::testing::TempDir(), "/zero_copy_stream_test_file");
+
+  for (int i = 1; i < kBlockSizeCount; i++) {
+    for (int num_buffers = 1; num_buffers <= 3; num_buffers++) {
+      AsyncFileStreamOptions options;
+      options.buffer_size = kBlockSizes[i];
+      options.num_buffers = num_buffers;
+
+      // Make a temporary file.
+      int file =
+          open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0777);
+      ASSERT_GE(file, 0);
+
+      // The streams fall back to plain file I/O where io_uring is not
+      // available, so both paths produce the same results.
+      int size;
+      {
+        AsyncFileOutputStream output(file, options);
+        size = WriteStuff(&output);
+        EXPECT_TRUE(output.Flush());
+        EXPECT_EQ(0, output.GetErrno());
+      }
+      EXPECT_EQ(lseek(file, 0, SEEK_CUR), size);
+
+      // Rewind.
+      ASSERT_NE(lseek(file, 0, SEEK_SET), (off_t)-1);
+
+      {
+        AsyncFileInputStream input(file, options);
+        ReadStuff(&input);
+        EXPECT_EQ(0, input.GetErrno());
+      }
+
+      close(file);
+    }
+  }
+}
+
+#ifndef _WIN32
+TEST_F(IoTest, AsyncFileFallsBackForPipes) {
+  int fd[2];
+  ASSERT_EQ(pipe(fd), 0);
+  ASSERT_EQ(write(fd[1], "abc", 3), 3);
+  close(fd[1]);
+
+  AsyncFileInputStream input(fd[0]);
+  EXPECT_FALSE(input.is_async());
+  const void* data;
+  int size;
+  ASSERT_TRUE(input.Next(&data, &size));
+  EXPECT_EQ(absl::string_view(static_cast<const char*>(data), size), "abc");
+  EXPECT_FALSE(input.Next(&data, &size));
+  close(fd[0]);
+}
+#endif  // !_WIN32
+
 #ifndef _WIN32
 // This tests the FileInputStream with a non blocking file. It opens a pipe in
 // non blocking mode, then starts reading it. The writing thread starts writing
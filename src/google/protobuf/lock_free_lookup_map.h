@@ -0,0 +1,120 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// This file is an internal implementation detail of DescriptorPool and
+// DynamicMessageFactory.  Do not use it directly.
+
+#ifndef GOOGLE_PROTOBUF_LOCK_FREE_LOOKUP_MAP_H__
+#define GOOGLE_PROTOBUF_LOCK_FREE_LOOKUP_MAP_H__
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#include "absl/hash/hash.h"
+#include "absl/log/absl_check.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace internal {
+
+// A hash map from keys to objects that is read without locks.  Entries are
+// never removed, and the objects must outlive the map.
+//
+// Find() may run concurrently with anything, and never waits.  Insert() must
+// be serialized by the caller, usually by holding the mutex that guards the
+// objects being inserted.
+//
+// The key of an object is `KeyOf()(object)`, so each slot is a single
+// pointer and readers see either nothing or a fully published object.  When
+// the table grows, the new table is published and the old one is kept until
+// the map is destroyed, because readers may still be probing it.  The old
+// tables together are smaller than the current one.
+template <typename Key, typename T, typename KeyOf>
+class LockFreeLookupMap {
+ public:
+  LockFreeLookupMap() = default;
+  LockFreeLookupMap(const LockFreeLookupMap&) = delete;
+  LockFreeLookupMap& operator=(const LockFreeLookupMap&) = delete;
+  ~LockFreeLookupMap() { delete table_.load(std::memory_order_relaxed); }
+
+  // Returns the object with the given key, or nullptr.
+  const T* Find(const Key& key) const {
+    const Table* table = table_.load(std::memory_order_acquire);
+    if (table == nullptr) return nullptr;
+    for (size_t i = Hash(key) & table->mask;; i = (i + 1) & table->mask) {
+      const T* value = table->slots[i].load(std::memory_order_acquire);
+      if (value == nullptr) return nullptr;
+      if (KeyOf()(*value) == key) return value;
+    }
+  }
+
+  // Adds `value` unless an object with the same key is already present.
+  void Insert(const T* value) {
+    ABSL_DCHECK(value != nullptr);
+    if (Find(KeyOf()(*value)) != nullptr) return;
+    Table* table = table_.load(std::memory_order_relaxed);
+    // Keep the load factor at most 1/2, so that probes stay short.
+    if (table == nullptr || 2 * (size_ + 1) > table->mask + 1) {
+      table = Grow(table);
+    }
+    InsertInto(table, value);
+    ++size_;
+  }
+
+ private:
+  struct Table {
+    explicit Table(size_t capacity)
+        : mask(capacity - 1), slots(new std::atomic<const T*>[capacity]()) {}
+
+    const size_t mask;
+    std::unique_ptr<std::atomic<const T*>[]> slots;
+    // Readers may still be using the table this one replaced.
+    std::unique_ptr<Table> previous;
+  };
+
+  static size_t Hash(const Key& key) { return absl::Hash<Key>()(key); }
+
+  static void InsertInto(Table* table, const T* value) {
+    size_t i = Hash(KeyOf()(*value)) & table->mask;
+    while (table->slots[i].load(std::memory_order_relaxed) != nullptr) {
+      i = (i + 1) & table->mask;
+    }
+    table->slots[i].store(value, std::memory_order_release);
+  }
+
+  Table* Grow(Table* old_table) {
+    const size_t capacity =
+        old_table == nullptr ? kMinCapacity : 2 * (old_table->mask + 1);
+    auto* table = new Table(capacity);
+    if (old_table != nullptr) {
+      for (size_t i = 0; i <= old_table->mask; ++i) {
+        const T* value = old_table->slots[i].load(std::memory_order_relaxed);
+        if (value != nullptr) InsertInto(table, value);
+      }
+      table->previous.reset(old_table);
+    }
+    table_.store(table, std::memory_order_release);
+    return table;
+  }
+
+  static constexpr size_t kMinCapacity = 16;
+
+  std::atomic<Table*> table_{nullptr};
+  size_t size_ = 0;
+};
+
+}  // namespace internal
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_LOCK_FREE_LOOKUP_MAP_H__
@@ -0,0 +1,89 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/lock_free_lookup_map.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/synchronization/mutex.h"
+
+namespace google {
+namespace protobuf {
+namespace internal {
+namespace {
+
+struct Entry {
+  int key;
+};
+
+struct EntryKey {
+  int operator()(const Entry& entry) const { return entry.key; }
+};
+
+using Map = LockFreeLookupMap<int, Entry, EntryKey>;
+
+TEST(LockFreeLookupMapTest, FindAndInsert) {
+  std::vector<Entry> entries(1000);
+  for (int i = 0; i < 1000; ++i) entries[i].key = i * 7;
+
+  Map map;
+  EXPECT_EQ(map.Find(0), nullptr);
+  for (int i = 0; i < 1000; ++i) {
+    map.Insert(&entries[i]);
+    EXPECT_EQ(map.Find(i * 7), &entries[i]);
+  }
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(map.Find(i * 7), &entries[i]);
+    EXPECT_EQ(map.Find(i * 7 + 1), nullptr);
+  }
+}
+
+TEST(LockFreeLookupMapTest, KeepsFirstEntryForKey) {
+  Entry first{5};
+  Entry second{5};
+  Map map;
+  map.Insert(&first);
+  map.Insert(&second);
+  EXPECT_EQ(map.Find(5), &first);
+}
+
+TEST(LockFreeLookupMapTest, ConcurrentReadersDuringInserts) {
+  constexpr int kEntries = 20000;
+  std::vector<Entry> entries(kEntries);
+  for (int i = 0; i < kEntries; ++i) entries[i].key = i;
+
+  Map map;
+  absl::Mutex mutex;
+  std::atomic<int> inserted{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&] {
+      while (true) {
+        // Everything inserted before this point must be visible.
+        const int limit = inserted.load(std::memory_order_acquire);
+        for (int i = 0; i < limit; i += 97) {
+          ASSERT_EQ(map.Find(i), &entries[i]);
+        }
+        if (limit == kEntries) break;
+      }
+    });
+  }
+  for (int i = 0; i < kEntries; ++i) {
+    absl::MutexLock lock(&mutex);
+    map.Insert(&entries[i]);
+    inserted.store(i + 1, std::memory_order_release);
+  }
+  for (auto& thread : threads) thread.join();
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace protobuf
+}  // namespace google
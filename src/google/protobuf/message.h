@@ -1090,10 +1090,13 @@ class PROTOBUF_EXPORT Reflection final {
   void PopulateTcParseFastEntries(
       const internal::TailCallTableInfo& table_info,
       TcParseTableBase::FastFieldEntry* fast_entries) const;
-  void PopulateTcParseEntries(internal::TailCallTableInfo& table_info,
+  void PopulateTcParseEntries(const internal::TailCallTableInfo& table_info,
                               TcParseTableBase::FieldEntry* entries) const;
+  // `enum_data` holds the validation data of each kEnumValidator entry, in
+  // order.
   void PopulateTcParseFieldAux(const internal::TailCallTableInfo& table_info,
-                               TcParseTableBase::FieldAux* field_aux) const;
+                               TcParseTableBase::FieldAux* field_aux,
+                               const uint32_t* const* enum_data) const;
 
   template <typename T, typename Enable>
   friend class RepeatedFieldRef;
@@ -0,0 +1,249 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/packed_varint_decode.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "absl/base/config.h"
+#include "absl/numeric/bits.h"
+#include "google/protobuf/parse_context.h"
+
+#if defined(ABSL_IS_LITTLE_ENDIAN)
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define PROTOBUF_PACKED_VARINT_SSE2 1
+#define PROTOBUF_PACKED_VARINT_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PROTOBUF_PACKED_VARINT_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PROTOBUF_PACKED_VARINT_NEON 1
+#endif
+#endif  // ABSL_IS_LITTLE_ENDIAN
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace internal {
+namespace {
+
+constexpr uint64_t kContinuationBits = 0x8080808080808080;
+
+uint64_t Load64(const char* p) {
+  uint64_t x;
+  std::memcpy(&x, p, sizeof(x));
+  return x;
+}
+
+template <typename T>
+const char* DecodeVarintsScalar(const char* p, size_t count, T* out) {
+  for (; count > 0; --count) {
+    uint64_t value;
+    p = VarintParse(p, &value);
+    if (p == nullptr) return nullptr;
+    *out++ = static_cast<T>(value);
+  }
+  return p;
+}
+
+#if defined(ABSL_IS_LITTLE_ENDIAN)
+
+// Returns the value of the varint stored in the low `len` bytes of `x`, where
+// `len` is 1 to 8. Each step merges pairs of adjacent 7, 14 and 28 bit groups.
+PROTOBUF_ALWAYS_INLINE uint64_t CompactVarint(uint64_t x, int len) {
+  x &= ~uint64_t{0} >> (64 - 8 * len);
+  x = (x & 0x007f007f007f007f) | ((x & 0x7f007f007f007f00) >> 1);
+  x = (x & 0x00003fff00003fff) | ((x & 0x3fff00003fff0000) >> 2);
+  return (x & 0x000000000fffffff) | ((x & 0x0fffffff00000000) >> 4);
+}
+
+// Portable window of 8 bytes.
+struct SwarWindow {
+  static constexpr int kWidth = 8;
+  static constexpr uint32_t kAllBits = 0xff;
+
+  // Returns a mask with bit i set if byte i has the continuation bit.
+  static uint32_t ContinuationMask(const char* p) {
+    // The multiplication moves the bit of byte i to bit 56 + i without
+    // carries, as all partial products land on distinct bits.
+    return static_cast<uint32_t>(
+        ((Load64(p) & kContinuationBits) * 0x0002040810204081) >> 56);
+  }
+};
+
+#if defined(PROTOBUF_PACKED_VARINT_SSE2)
+struct Sse2Window {
+  static constexpr int kWidth = 16;
+  static constexpr uint32_t kAllBits = 0xffff;
+
+  static uint32_t ContinuationMask(const char* p) {
+    return static_cast<uint32_t>(_mm_movemask_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+  }
+};
+using DefaultWindow = Sse2Window;
+#elif defined(PROTOBUF_PACKED_VARINT_NEON)
+struct NeonWindow {
+  static constexpr int kWidth = 16;
+  static constexpr uint32_t kAllBits = 0xffff;
+
+  static uint32_t ContinuationMask(const char* p) {
+    // NEON has no movemask: shift each continuation bit to its position
+    // within the half and add up the halves.
+    static const int8_t kShifts[16] = {0, 1, 2, 3, 4, 5, 6, 7,
+                                       0, 1, 2, 3, 4, 5, 6, 7};
+    const uint8x16_t bits =
+        vshrq_n_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(p)), 7);
+    const uint8x16_t shifted = vshlq_u8(bits, vld1q_s8(kShifts));
+    return vaddv_u8(vget_low_u8(shifted)) |
+           (static_cast<uint32_t>(vaddv_u8(vget_high_u8(shifted))) << 8);
+  }
+};
+using DefaultWindow = NeonWindow;
+#else
+using DefaultWindow = SwarWindow;
+#endif
+
+// Decodes `Window::kWidth` bytes at a time while at least that many varints
+// are left, then finishes with VarintParse().
+template <typename Window, typename T>
+PROTOBUF_ALWAYS_INLINE const char* DecodeVarintsWindowed(const char* p,
+                                                         const char* end,
+                                                         size_t count,
+                                                         T* out) {
+  constexpr int kWidth = Window::kWidth;
+  while (count >= static_cast<size_t>(kWidth) && end - p >= kWidth) {
+    const uint32_t continuation = Window::ContinuationMask(p);
+    if (continuation == 0) {
+      for (int i = 0; i < kWidth; ++i) out[i] = static_cast<uint8_t>(p[i]);
+      p += kWidth;
+      out += kWidth;
+      count -= kWidth;
+      continue;
+    }
+    uint32_t ends = ~continuation & Window::kAllBits;
+    // A varint spanning the whole window is left to VarintParse().
+    if (ends == 0) break;
+    // At most kWidth varints end in the window, so `count` does not underflow.
+    int start = 0;
+    do {
+      const int last = absl::countr_zero(ends);
+      const int len = last - start + 1;
+      uint64_t value;
+      if (PROTOBUF_PREDICT_TRUE(len <= 8)) {
+        value = CompactVarint(Load64(p + start), len);
+      } else if (VarintParse(p + start, &value) == nullptr) {
+        return nullptr;
+      }
+      *out++ = static_cast<T>(value);
+      --count;
+      start = last + 1;
+      ends &= ends - 1;
+    } while (ends != 0);
+    p += start;
+  }
+  return DecodeVarintsScalar(p, count, out);
+}
+
+#if defined(PROTOBUF_PACKED_VARINT_AVX2)
+// Same as DecodeVarintsWindowed() with 32 byte windows, using PEXT to strip
+// the continuation bits.
+template <typename T>
+__attribute__((target("avx2,bmi,bmi2"))) const char* DecodeVarintsAvx2(
+    const char* p, const char* end, size_t count, T* out) {
+  while (count >= 32 && end - p >= 32) {
+    const uint32_t continuation = static_cast<uint32_t>(_mm256_movemask_epi8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))));
+    if (continuation == 0) {
+      for (int i = 0; i < 32; ++i) out[i] = static_cast<uint8_t>(p[i]);
+      p += 32;
+      out += 32;
+      count -= 32;
+      continue;
+    }
+    uint32_t ends = ~continuation;
+    if (ends == 0) break;
+    int start = 0;
+    do {
+      const int last = absl::countr_zero(ends);
+      const int len = last - start + 1;
+      uint64_t value;
+      if (PROTOBUF_PREDICT_TRUE(len <= 8)) {
+        value = _pext_u64(Load64(p + start),
+                          uint64_t{0x7f7f7f7f7f7f7f7f} >> (64 - 8 * len));
+      } else if (VarintParse(p + start, &value) == nullptr) {
+        return nullptr;
+      }
+      *out++ = static_cast<T>(value);
+      --count;
+      start = last + 1;
+      ends &= ends - 1;
+    } while (ends != 0);
+    p += start;
+  }
+  return DecodeVarintsWindowed<Sse2Window>(p, end, count, out);
+}
+
+bool HasAvx2AndBmi2() {
+  static const bool has = [] {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2");
+  }();
+  return has;
+}
+#endif  // PROTOBUF_PACKED_VARINT_AVX2
+
+#endif  // ABSL_IS_LITTLE_ENDIAN
+
+template <typename T>
+const char* DecodeVarintsImpl(const char* ptr, const char* end, size_t count,
+                              T* out) {
+#if defined(ABSL_IS_LITTLE_ENDIAN)
+#if defined(PROTOBUF_PACKED_VARINT_AVX2)
+  if (HasAvx2AndBmi2()) return DecodeVarintsAvx2(ptr, end, count, out);
+#endif
+  return DecodeVarintsWindowed<DefaultWindow>(ptr, end, count, out);
+#else
+  (void)end;
+  return DecodeVarintsScalar(ptr, count, out);
+#endif
+}
+
+}  // namespace
+
+size_t CountVarints(const char* ptr, const char* end) {
+  size_t count = 0;
+  for (; end - ptr >= 8; ptr += 8) {
+    count += absl::popcount(~Load64(ptr) & kContinuationBits);
+  }
+  for (; ptr < end; ++ptr) {
+    count += static_cast<uint8_t>(*ptr) < 0x80;
+  }
+  return count;
+}
+
+const char* DecodeVarints(const char* ptr, const char* end, size_t count,
+                          uint32_t* out) {
+  return DecodeVarintsImpl(ptr, end, count, out);
+}
+
+const char* DecodeVarints(const char* ptr, const char* end, size_t count,
+                          uint64_t* out) {
+  return DecodeVarintsImpl(ptr, end, count, out);
+}
+
+}  // namespace internal
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
@@ -0,0 +1,51 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// Bulk decoding of packed varint arrays.
+
+#ifndef GOOGLE_PROTOBUF_PACKED_VARINT_DECODE_H__
+#define GOOGLE_PROTOBUF_PACKED_VARINT_DECODE_H__
+
+#include <cstddef>
+#include <cstdint>
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace internal {
+
+// Returns the number of varints that end in [ptr, end), that is the number of
+// bytes in that range without the continuation bit.
+PROTOBUF_EXPORT size_t CountVarints(const char* ptr, const char* end);
+
+// Decodes the `count` varints starting at `ptr` into `out`, which must have
+// room for `count` values. All of them must end before `end`, e.g. `count` was
+// returned by CountVarints(ptr, end). Returns the end of the last varint, or
+// nullptr if one of them is longer than 10 bytes. Values are truncated to the
+// width of the output, like a conversion from the 64-bit value.
+//
+// As with VarintParse(), up to 16 bytes past `end` may be read.
+//
+// The decoder looks at a window of bytes at a time: windows without
+// continuation bits are widened directly, otherwise the varints ending in the
+// window are located from its continuation bit mask and decoded without
+// per-byte branches. The window is 32 bytes with AVX2 and BMI2 (selected at
+// runtime on x86-64), 16 bytes with SSE2 or NEON and 8 bytes elsewhere.
+PROTOBUF_EXPORT const char* DecodeVarints(const char* ptr, const char* end,
+                                          size_t count, uint32_t* out);
+PROTOBUF_EXPORT const char* DecodeVarints(const char* ptr, const char* end,
+                                          size_t count, uint64_t* out);
+
+}  // namespace internal
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_PACKED_VARINT_DECODE_H__
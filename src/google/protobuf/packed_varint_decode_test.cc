@@ -0,0 +1,120 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/packed_varint_decode.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "google/protobuf/parse_context.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+using testing::ElementsAreArray;
+using testing::Eq;
+using testing::IsNull;
+using testing::Range;
+using testing::TestWithParam;
+
+namespace google {
+namespace protobuf {
+namespace internal {
+namespace {
+
+void AppendVarint(uint64_t value, std::string& out) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+// Returns `n` varints of 1 to `max_len` bytes, encoded with slop bytes after
+// the end.
+std::string RandomVarints(int n, int max_len, std::vector<uint64_t>& values) {
+  std::mt19937_64 rng(max_len);
+  std::string res;
+  for (int i = 0; i < n; ++i) {
+    int len = 1 + static_cast<int>(rng() % max_len);
+    uint64_t value = len == 10 ? rng() | (uint64_t{1} << 63)
+                               : (rng() & ((uint64_t{1} << (7 * len)) - 1)) |
+                                     (uint64_t{1} << (7 * (len - 1)));
+    values.push_back(value);
+    AppendVarint(value, res);
+  }
+  return res;
+}
+
+class PackedVarintDecodeTest : public TestWithParam<int> {};
+
+TEST_P(PackedVarintDecodeTest, MatchesVarintParse) {
+  const int max_len = GetParam();
+  std::vector<uint64_t> values;
+  std::string data = RandomVarints(1000, max_len, values);
+  const size_t size = data.size();
+  data.append(16, '\0');
+  const char* end = data.data() + size;
+
+  ASSERT_THAT(CountVarints(data.data(), end), Eq(values.size()));
+
+  std::vector<uint64_t> expected;
+  for (const char* p = data.data(); p < end;) {
+    uint64_t value;
+    p = VarintParse(p, &value);
+    ASSERT_TRUE(p != nullptr);
+    expected.push_back(value);
+  }
+  ASSERT_THAT(expected, ElementsAreArray(values));
+
+  std::vector<uint64_t> out64(values.size());
+  EXPECT_THAT(DecodeVarints(data.data(), end, out64.size(), out64.data()),
+              Eq(end));
+  EXPECT_THAT(out64, ElementsAreArray(expected));
+
+  std::vector<uint32_t> out32(values.size());
+  EXPECT_THAT(DecodeVarints(data.data(), end, out32.size(), out32.data()),
+              Eq(end));
+  std::vector<uint32_t> expected32(expected.begin(), expected.end());
+  EXPECT_THAT(out32, ElementsAreArray(expected32));
+
+  // Decoding a prefix stops right after it.
+  const char* p = data.data();
+  for (int i = 0; i < 100; ++i) {
+    p = VarintParse(p, &out64[0]);
+  }
+  EXPECT_THAT(DecodeVarints(data.data(), end, 100, out64.data()), Eq(p));
+}
+
+INSTANTIATE_TEST_SUITE_P(MaxLength, PackedVarintDecodeTest, Range(1, 11));
+
+TEST(PackedVarintDecode, RejectsOverlongVarint) {
+  // 32 single byte varints, an 11 byte varint and another single byte one.
+  std::string data(32, '\x01');
+  data.append(10, '\x80');
+  data.append(2, '\x01');
+  const size_t size = data.size();
+  data.append(16, '\0');
+  const char* end = data.data() + size;
+
+  EXPECT_THAT(CountVarints(data.data(), end), Eq(size_t{34}));
+  std::vector<uint64_t> out(34);
+  EXPECT_THAT(DecodeVarints(data.data(), end, out.size(), out.data()),
+              IsNull());
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
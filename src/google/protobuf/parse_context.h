@@ -28,6 +28,7 @@
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/metadata_lite.h"
+#include "google/protobuf/packed_varint_decode.h"
 #include "google/protobuf/port.h"
 #include "google/protobuf/repeated_field.h"
 #include "google/protobuf/wire_format_lite.h"
@@ -1208,6 +1209,62 @@ const char* ReadPackedVarintArray(const char* ptr, const char* end, Add add) {
   return ptr;
 }
 
+// Appends varints to a RepeatedField of 32 or 64-bit integers, zigzag decoding
+// them if `zigzag`. ReadPackedVarintArray() decodes runs of varints into such a
+// field in bulk.
+template <typename T, bool zigzag>
+struct PackedVarintAppender {
+  void operator()(uint64_t varint) const {
+    if (zigzag) {
+      field->Add(static_cast<T>(sizeof(T) == 8
+                                    ? WireFormatLite::ZigZagDecode64(varint)
+                                    : WireFormatLite::ZigZagDecode32(
+                                          static_cast<uint32_t>(varint))));
+    } else {
+      field->Add(static_cast<T>(varint));
+    }
+  }
+
+  RepeatedField<T>* field;
+};
+
+template <typename T, bool zigzag>
+const char* ReadPackedVarintArray(const char* ptr, const char* end,
+                                  PackedVarintAppender<T, zigzag> add) {
+  // Short arrays are not worth the counting pass.
+  if (end - ptr >= 32) {
+    using Unsigned = typename std::make_unsigned<T>::type;
+    RepeatedField<T>* field = add.field;
+    const int old_size = field->size();
+    const int count = static_cast<int>(CountVarints(ptr, end));
+    field->Reserve(old_size + count);
+    Unsigned* out =
+        reinterpret_cast<Unsigned*>(field->AddNAlreadyReserved(count));
+    ptr = DecodeVarints(ptr, end, count, out);
+    if (ptr == nullptr) {
+      field->Truncate(old_size);
+      return nullptr;
+    }
+    if (zigzag) {
+      for (int i = 0; i < count; ++i) {
+        out[i] = static_cast<Unsigned>(
+            sizeof(T) == 8 ? WireFormatLite::ZigZagDecode64(out[i])
+                           : WireFormatLite::ZigZagDecode32(
+                                 static_cast<uint32_t>(out[i])));
+      }
+    }
+  }
+  // Parses short arrays, and a last varint running past `end` (see
+  // ReadPackedVarint), which CountVarints() does not include.
+  while (ptr < end) {
+    uint64_t varint;
+    ptr = VarintParse(ptr, &varint);
+    if (ptr == nullptr) return nullptr;
+    add(varint);
+  }
+  return ptr;
+}
+
 template <typename Add, typename SizeCb>
 const char* EpsCopyInputStream::ReadPackedVarint(const char* ptr, Add add,
                                                  SizeCb size_callback) {
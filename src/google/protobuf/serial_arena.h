@@ -66,6 +66,22 @@ struct FirstSerialArena {
   explicit FirstSerialArena() = default;
 };
 
+// Allocation state of a SerialArena, saved by SerialArena::Checkpoint() and
+// restored by SerialArena::RewindTo().
+struct SerialArenaCheckpoint {
+  SerialArena* serial = nullptr;
+  // Life cycle id of the owning ThreadSafeArena. Set by ThreadSafeArena.
+  uint64_t life_cycle_id = 0;
+  ArenaBlock* head = nullptr;
+  char* ptr = nullptr;
+  char* limit = nullptr;
+  size_t space_used = 0;
+  size_t space_allocated = 0;
+  cleanup::ChunkList::Position cleanup = {nullptr, nullptr};
+  StringBlock* string_block = nullptr;
+  size_t string_block_unused = 0;
+};
+
 // A simple arena allocator. Calls to allocate functions must be properly
 // serialized by the caller, hence this class cannot be used as a general
 // purpose allocator in a multi-threaded program. It serves as a building block
@@ -255,6 +271,15 @@ class PROTOBUF_EXPORT SerialArena {
 
   std::vector<void*> PeekCleanupListForTesting();
 
+  // Saves the current allocation state.
+  SerialArenaCheckpoint Checkpoint();
+
+  // Rolls the arena back to `checkpoint`: runs the cleanups and destroys the
+  // strings registered after it, frees the blocks allocated since and resets
+  // the bump pointer. The array freelists are dropped as they may point into
+  // the released memory.
+  void RewindTo(const SerialArenaCheckpoint& checkpoint);
+
  private:
   friend class ThreadSafeArena;
   friend class cleanup::ChunkList;
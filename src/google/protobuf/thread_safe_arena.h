@@ -78,6 +78,8 @@ class PROTOBUF_EXPORT ThreadSafeArena {
   void ReturnArrayMemory(void* p, size_t size) {
     SerialArena* arena;
     if (PROTOBUF_PREDICT_TRUE(GetSerialArenaFast(&arena))) {
+      ThreadSafeArenaStats::RecordReturnArrayMemory(arena_stats_.MutableStats(),
+                                                    size);
       arena->ReturnArrayMemory(p, size);
     }
   }
@@ -105,6 +107,10 @@ class PROTOBUF_EXPORT ThreadSafeArena {
 
   std::vector<void*> PeekCleanupListForTesting();
 
+  // Saves / restores the allocation state of the calling thread's SerialArena.
+  SerialArenaCheckpoint Checkpoint();
+  void RewindTo(const SerialArenaCheckpoint& checkpoint);
+
  private:
   friend class ArenaBenchmark;
   friend class TcParser;
@@ -114,6 +120,8 @@ class PROTOBUF_EXPORT ThreadSafeArena {
   static uint64_t GetNextLifeCycleId();
 
   class SerialArenaChunk;
+  class SharedSerialArena;
+  class SharedSerialArenas;
 
   // Returns a new SerialArenaChunk that has {id, serial} at slot 0. It may
   // grow based on "prev_num_slots".
@@ -133,6 +141,9 @@ class PROTOBUF_EXPORT ThreadSafeArena {
 
   void UnpoisonAllArenaBlocks() const;
 
+  // Reports SpaceUsed() to the policy's ArenaSizeHint, if any.
+  void RecordSizeHint() const;
+
   // Members are declared here to track sizeof(ThreadSafeArena) and hotness
   // centrally.
 
@@ -148,6 +159,8 @@ class PROTOBUF_EXPORT ThreadSafeArena {
   std::atomic<SerialArenaChunk*> head_{nullptr};
 
   void* first_owner_;
+  // Created on first use when AllocationPolicy::max_thread_arenas is set.
+  std::atomic<SharedSerialArenas*> shared_arenas_{nullptr};
   // Must be declared after alloc_policy_; otherwise, it may lose info on
   // user-provided initial block.
   SerialArena first_arena_;
@@ -188,6 +201,16 @@ class PROTOBUF_EXPORT ThreadSafeArena {
 
   SerialArena* GetSerialArena();
 
+  // Returns true if the calling thread allocates from SharedSerialArenas.
+  bool UsesSharedSerialArenas() const;
+  SharedSerialArenas* GetSharedSerialArenas();
+  void DeleteSharedSerialArenas();
+
+  // Returns the SharedSerialArena the calling thread is bound to, binding it
+  // to one if needed, or nullptr if the thread has a SerialArena of its own.
+  // Used when GetSerialArenaFast() fails.
+  SharedSerialArena* GetSharedSerialArena();
+
   template <AllocationClient alloc_client = AllocationClient::kDefault>
   void* AllocateAlignedFallback(size_t n);
 
@@ -231,6 +254,9 @@ class PROTOBUF_EXPORT ThreadSafeArena {
     // lifecycle_id of the arena being used.
     uint64_t last_lifecycle_id_seen{static_cast<uint64_t>(-1)};
     SerialArena* last_serial_arena{nullptr};
+    // Used instead of `last_serial_arena` when `last_lifecycle_id_seen` is the
+    // id of a set of SharedSerialArenas.
+    SharedSerialArena* last_shared_arena{nullptr};
   };
   static_assert(sizeof(ThreadCache) <= kThreadCacheAlignment,
                 "ThreadCache may span several cache lines");
@@ -13,6 +13,7 @@
 #include <vector>
 
 #include "absl/container/btree_map.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
 #include "absl/log/die_if_null.h"
@@ -21,7 +22,10 @@
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
 #include "absl/strings/strip.h"
+#include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/message.h"
+#include "google/protobuf/wire_format.h"
+#include "google/protobuf/wire_format_lite.h"
 
 // Must be included last.
 #include "google/protobuf/port_def.inc"
@@ -31,6 +35,8 @@ namespace protobuf {
 namespace util {
 
 using google::protobuf::FieldMask;
+using google::protobuf::internal::WireFormat;
+using google::protobuf::internal::WireFormatLite;
 
 std::string FieldMaskUtil::ToString(const FieldMask& mask) {
   return absl::StrJoin(mask.paths(), ",");
@@ -690,6 +696,163 @@ bool FieldMaskUtil::TrimMessage(const FieldMask& mask, Message* message,
   return tree.TrimMessage(ABSL_DIE_IF_NULL(message));
 }
 
+// A node of a Projection, for a message type. Fields that are selected as a
+// whole map to a null node.
+struct FieldMaskUtil::Projection::Node {
+  struct Child {
+    const FieldDescriptor* field;
+    std::unique_ptr<Node> node;
+  };
+  absl::flat_hash_map<int, Child> children;  // By field number.
+};
+
+FieldMaskUtil::Projection::Projection(const FieldMask& mask,
+                                      const Descriptor* descriptor)
+    : descriptor_(descriptor) {
+  FieldMaskTree tree;
+  tree.MergeFromFieldMask(mask);
+  FieldMask canonical;
+  tree.MergeToFieldMask(&canonical);
+  if (canonical.paths().empty()) return;
+  auto root = absl::make_unique<Node>();
+  // In canonical form, no path is a sub-path of another.
+  for (const std::string& path : canonical.paths()) {
+    const std::vector<absl::string_view> names = absl::StrSplit(path, '.');
+    Node* node = root.get();
+    const Descriptor* type = descriptor;
+    for (size_t i = 0; i < names.size(); ++i) {
+      const FieldDescriptor* field = type->FindFieldByName(names[i]);
+      if (field == nullptr) break;
+      auto inserted =
+          node->children.try_emplace(field->number(), Node::Child{field});
+      Node::Child& child = inserted.first->second;
+      if (i + 1 == names.size() ||
+          field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE ||
+          field->is_map()) {
+        // The whole field is selected.
+        child.node = nullptr;
+        break;
+      }
+      if (child.node == nullptr) {
+        // Unless an earlier path selected the whole field.
+        if (!inserted.second) break;
+        child.node = absl::make_unique<Node>();
+      }
+      node = child.node.get();
+      type = field->message_type();
+    }
+  }
+  root_ = std::move(root);
+}
+
+FieldMaskUtil::Projection::~Projection() = default;
+
+bool FieldMaskUtil::Projection::ParseMessage(const Node& node,
+                                             absl::string_view data,
+                                             io::CodedInputStream* input,
+                                             Message* message) {
+  const Reflection* reflection = message->GetReflection();
+  // The run of selected fields, at [begin, end) in `data`, that are parsed as
+  // a whole by the message's own parser. A run ends at a skipped field, and is
+  // parsed before recursing into a submessage so that fields are still merged
+  // in input order.
+  int begin = 0;
+  int end = 0;
+  const auto parse_run = [&] {
+    if (begin == end) {
+      return true;
+    }
+    io::CodedInputStream run(
+        reinterpret_cast<const uint8_t*>(data.data()) + begin, end - begin);
+    // The fields are at the current depth of `input`, so their submessages
+    // only get the recursion budget left there.
+    run.SetRecursionLimit(input->RecursionBudget());
+    begin = end;
+    return message->MergePartialFromCodedStream(&run) &&
+           run.ConsumedEntireMessage();
+  };
+  while (true) {
+    const int tag_begin = input->CurrentPosition();
+    const uint32_t tag = input->ReadTag();
+    if (tag == 0 || WireFormatLite::GetTagWireType(tag) ==
+                        WireFormatLite::WIRETYPE_END_GROUP) {
+      break;
+    }
+    auto it = node.children.find(WireFormatLite::GetTagFieldNumber(tag));
+    if (it == node.children.end()) {
+      if (!WireFormatLite::SkipField(input, tag)) {
+        return false;
+      }
+      continue;
+    }
+    const FieldDescriptor* field = it->second.field;
+    const Node* child = it->second.node.get();
+    if (child == nullptr || WireFormatLite::GetTagWireType(tag) !=
+                                WireFormat::WireTypeForField(field)) {
+      if (tag_begin != end) {
+        if (!parse_run()) {
+          return false;
+        }
+        begin = tag_begin;
+      }
+      if (!WireFormatLite::SkipField(input, tag)) {
+        return false;
+      }
+      end = input->CurrentPosition();
+      continue;
+    }
+    if (!parse_run()) {
+      return false;
+    }
+    Message* submessage = field->is_repeated()
+                              ? reflection->AddMessage(message, field)
+                              : reflection->MutableMessage(message, field);
+    if (field->type() == FieldDescriptor::TYPE_GROUP) {
+      if (!input->IncrementRecursionDepth() ||
+          !ParseMessage(*child, data, input, submessage)) {
+        return false;
+      }
+      input->DecrementRecursionDepth();
+      if (!input->LastTagWas(WireFormatLite::MakeTag(
+              field->number(), WireFormatLite::WIRETYPE_END_GROUP))) {
+        return false;
+      }
+    } else {
+      uint32_t length;
+      if (!input->ReadVarint32(&length)) {
+        return false;
+      }
+      auto limit = input->IncrementRecursionDepthAndPushLimit(length);
+      if (limit.second < 0 || !ParseMessage(*child, data, input, submessage) ||
+          !input->DecrementRecursionDepthAndPopLimit(limit.first)) {
+        return false;
+      }
+    }
+  }
+  return parse_run();
+}
+
+bool FieldMaskUtil::ParseWithFieldMask(absl::string_view data,
+                                       const FieldMask& mask,
+                                       Message* message) {
+  return ParseWithFieldMask(data, Projection(mask, message->GetDescriptor()),
+                            message);
+}
+
+bool FieldMaskUtil::ParseWithFieldMask(absl::string_view data,
+                                       const Projection& projection,
+                                       Message* message) {
+  ABSL_DCHECK_EQ(message->GetDescriptor(), projection.descriptor());
+  message->Clear();
+  if (projection.root_ == nullptr) {
+    return message->ParseFrom<MessageLite::kMergePartial>(data);
+  }
+  io::CodedInputStream input(reinterpret_cast<const uint8_t*>(data.data()),
+                             static_cast<int>(data.size()));
+  return Projection::ParseMessage(*projection.root_, data, &input, message) &&
+         input.ConsumedEntireMessage();
+}
+
 }  // namespace util
 }  // namespace protobuf
 }  // namespace google
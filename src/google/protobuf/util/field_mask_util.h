@@ -11,6 +11,7 @@
 #define GOOGLE_PROTOBUF_UTIL_FIELD_MASK_UTIL_H__
 
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -18,6 +19,7 @@
 #include "absl/log/absl_check.h"
 #include "absl/strings/string_view.h"
 #include "google/protobuf/descriptor.h"
+#include "google/protobuf/io/coded_stream.h"
 
 // Must be included last.
 #include "google/protobuf/port_def.inc"
@@ -158,6 +160,25 @@ class PROTOBUF_EXPORT FieldMaskUtil {
   static bool TrimMessage(const FieldMask& mask, Message* message,
                           const TrimOptions& options);
 
+  // Parses 'message' from 'data', setting only the fields represented in the
+  // given FieldMask. Other fields are skipped on the wire without being
+  // decoded, and paths are followed into submessages. If the FieldMask is
+  // empty, all fields are parsed. Required fields are not checked, since
+  // those outside the FieldMask are left unset.
+  // Returns false if the input is malformed.
+  static bool ParseWithFieldMask(absl::string_view data, const FieldMask& mask,
+                                 Message* message);
+
+  // A FieldMask resolved against a message type, for ParseWithFieldMask().
+  // Building one looks up the fields of every path once, so reuse it when
+  // parsing many inputs with the same FieldMask.
+  class Projection;
+
+  // Same as above, with a Projection built for the type of 'message'.
+  static bool ParseWithFieldMask(absl::string_view data,
+                                 const Projection& projection,
+                                 Message* message);
+
  private:
   friend class SnakeCaseCamelCaseTest;
   // Converts a field name from snake_case to camelCase:
@@ -233,6 +254,31 @@ class PROTOBUF_EXPORT FieldMaskUtil::TrimOptions {
   bool keep_required_fields_;
 };
 
+class PROTOBUF_EXPORT FieldMaskUtil::Projection {
+ public:
+  // Paths that don't name a field of 'descriptor' select nothing.
+  Projection(const FieldMask& mask, const Descriptor* descriptor);
+  ~Projection();
+
+  Projection(const Projection&) = delete;
+  Projection& operator=(const Projection&) = delete;
+
+  const Descriptor* descriptor() const { return descriptor_; }
+
+ private:
+  friend class FieldMaskUtil;
+  struct Node;
+
+  // Parses the fields selected by 'node' from 'input', which reads 'data',
+  // into 'message'. Stops at the end of input or at an end-group tag.
+  static bool ParseMessage(const Node& node, absl::string_view data,
+                           io::CodedInputStream* input, Message* message);
+
+  const Descriptor* descriptor_;
+  // Null if the FieldMask is empty, which selects all fields.
+  std::unique_ptr<const Node> root_;
+};
+
 }  // namespace util
 }  // namespace protobuf
 }  // namespace google
@@ -9,10 +9,12 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <string>
 #include <vector>
 
 #include "google/protobuf/field_mask.pb.h"
 #include <gtest/gtest.h>
+#include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/test_util.h"
 #include "google/protobuf/unittest.pb.h"
 
@@ -804,6 +806,98 @@ TEST(FieldMaskUtilTest, TrimMessageReturnValue) {
   // supported.
 }
 
+TEST(FieldMaskUtilTest, ParseWithFieldMask) {
+  TestAllTypes full_msg;
+  TestUtil::SetAllFields(&full_msg);
+  std::string data = full_msg.SerializeAsString();
+
+  // Parsing with a mask matches parsing everything and then trimming.
+  for (const char* paths :
+       {"", "optional_int32", "optional_string,repeated_int64",
+        "optional_nested_message.bb", "optionalgroup.a,repeatedgroup",
+        "oneof_uint32,oneof_bytes",
+        "optional_nested_message,optional_foreign_message.c,default_bool"}) {
+    FieldMask mask;
+    FieldMaskUtil::FromString(paths, &mask);
+    TestAllTypes expected = full_msg;
+    FieldMaskUtil::TrimMessage(mask, &expected);
+    TestAllTypes parsed_msg;
+    parsed_msg.set_optional_uint64(1);
+    ASSERT_TRUE(FieldMaskUtil::ParseWithFieldMask(data, mask, &parsed_msg))
+        << paths;
+    EXPECT_EQ(parsed_msg.DebugString(), expected.DebugString()) << paths;
+  }
+
+  // TrimMessage() does not follow paths into repeated fields, but parsing
+  // does, for each element.
+  FieldMask repeated_mask;
+  FieldMaskUtil::FromString("repeated_nested_message.bb", &repeated_mask);
+  TestAllTypes repeated_msg;
+  ASSERT_TRUE(
+      FieldMaskUtil::ParseWithFieldMask(data, repeated_mask, &repeated_msg));
+  TestAllTypes expected_repeated;
+  *expected_repeated.mutable_repeated_nested_message() =
+      full_msg.repeated_nested_message();
+  EXPECT_EQ(repeated_msg.DebugString(), expected_repeated.DebugString());
+
+  // Malformed input is rejected, also when it is in a skipped field.
+  FieldMask mask;
+  FieldMaskUtil::FromString("optional_nested_message.bb", &mask);
+  TestAllTypes parsed_msg;
+  EXPECT_FALSE(FieldMaskUtil::ParseWithFieldMask(
+      data.substr(0, data.size() - 1), mask, &parsed_msg));
+  EXPECT_FALSE(
+      FieldMaskUtil::ParseWithFieldMask("\x0a\x05ab", mask, &parsed_msg));
+}
+
+TEST(FieldMaskUtilTest, ParseWithFieldMaskRecursionLimit) {
+  // Returns `levels` nested submessages.
+  const auto nested = [](int levels) {
+    NestedTestAllTypes msg;
+    NestedTestAllTypes* m = &msg;
+    for (int i = 1; i < levels; ++i) m = m->mutable_child();
+    m->mutable_payload()->set_optional_int32(1);
+    return msg.SerializeAsString();
+  };
+  const int limit = io::CodedInputStream::GetDefaultRecursionLimit();
+  FieldMask mask;
+  FieldMaskUtil::FromString("child.child.child", &mask);
+  NestedTestAllTypes parsed_msg;
+
+  ASSERT_TRUE(parsed_msg.ParseFromString(nested(limit)));
+  EXPECT_TRUE(
+      FieldMaskUtil::ParseWithFieldMask(nested(limit), mask, &parsed_msg));
+  // The fields parsed as a whole below the mask get the remaining budget.
+  ASSERT_FALSE(parsed_msg.ParseFromString(nested(limit + 1)));
+  EXPECT_FALSE(
+      FieldMaskUtil::ParseWithFieldMask(nested(limit + 1), mask, &parsed_msg));
+}
+
+TEST(FieldMaskUtilTest, ParseWithProjection) {
+  FieldMask mask;
+  FieldMaskUtil::FromString(
+      "optional_nested_message.bb,repeated_int32,optional_int32.x,"
+      "no_such_field",
+      &mask);
+  const FieldMaskUtil::Projection projection(mask, TestAllTypes::descriptor());
+  EXPECT_EQ(projection.descriptor(), TestAllTypes::descriptor());
+
+  // The same projection parses several inputs.
+  for (int i = 1; i <= 3; ++i) {
+    TestAllTypes full_msg;
+    TestUtil::SetAllFields(&full_msg);
+    full_msg.mutable_optional_nested_message()->set_bb(i);
+    full_msg.add_repeated_int32(i);
+    TestAllTypes expected = full_msg;
+    FieldMaskUtil::TrimMessage(mask, &expected);
+    TestAllTypes parsed_msg;
+    ASSERT_TRUE(FieldMaskUtil::ParseWithFieldMask(
+        full_msg.SerializeAsString(), projection, &parsed_msg));
+    EXPECT_EQ(parsed_msg.DebugString(), expected.DebugString());
+    EXPECT_EQ(parsed_msg.optional_nested_message().bb(), i);
+    EXPECT_TRUE(parsed_msg.has_optional_int32());
+  }
+}
 
 }  // namespace
 }  // namespace util
@@ -0,0 +1,209 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/parallel_parse.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+#include "google/protobuf/wire_format_lite.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+using internal::WireFormatLite;
+
+// An element of the repeated field, as a range of the input.
+struct Span {
+  size_t offset;
+  size_t size;
+};
+
+// Reads a varint from [*ptr, end). Unlike the parser's varint routines, this
+// never reads past `end`.
+bool ReadVarint(const char** ptr, const char* end, uint64_t* value) {
+  uint64_t res = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (*ptr == end) return false;
+    const uint8_t byte = static_cast<uint8_t>(*(*ptr)++);
+    res |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (byte < 0x80) {
+      *value = res;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Collects the elements of field `field_number` into `spans` and all other
+// fields into `rest`. Returns false if the input is malformed or contains
+// groups, which can only be skipped by parsing them; those inputs are left to
+// the regular parser.
+bool ScanFields(absl::string_view data, int field_number,
+                std::vector<Span>* spans, std::string* rest) {
+  const char* const begin = data.data();
+  const char* const end = begin + data.size();
+  const char* ptr = begin;
+  while (ptr < end) {
+    const char* field_begin = ptr;
+    uint64_t tag;
+    if (!ReadVarint(&ptr, end, &tag) || tag > uint64_t{0xffffffff} ||
+        WireFormatLite::GetTagFieldNumber(static_cast<uint32_t>(tag)) == 0) {
+      return false;
+    }
+    const auto wire_type =
+        WireFormatLite::GetTagWireType(static_cast<uint32_t>(tag));
+    uint64_t value;
+    switch (wire_type) {
+      case WireFormatLite::WIRETYPE_VARINT:
+        if (!ReadVarint(&ptr, end, &value)) return false;
+        break;
+      case WireFormatLite::WIRETYPE_FIXED64:
+        if (end - ptr < 8) return false;
+        ptr += 8;
+        break;
+      case WireFormatLite::WIRETYPE_FIXED32:
+        if (end - ptr < 4) return false;
+        ptr += 4;
+        break;
+      case WireFormatLite::WIRETYPE_LENGTH_DELIMITED:
+        if (!ReadVarint(&ptr, end, &value) ||
+            value > static_cast<uint64_t>(end - ptr)) {
+          return false;
+        }
+        if (WireFormatLite::GetTagFieldNumber(static_cast<uint32_t>(tag)) ==
+            field_number) {
+          spans->push_back({static_cast<size_t>(ptr - begin),
+                            static_cast<size_t>(value)});
+          ptr += value;
+          continue;
+        }
+        ptr += value;
+        break;
+      default:
+        return false;
+    }
+    rest->append(field_begin, ptr);
+  }
+  return true;
+}
+
+}  // namespace
+
+bool ParallelParseFromString(absl::string_view data,
+                             const FieldDescriptor* field,
+                             const ParallelParseOptions& options,
+                             Message* message) {
+  const Reflection* reflection = message->GetReflection();
+  ABSL_CHECK_EQ(field->containing_type(), message->GetDescriptor());
+  ABSL_CHECK(field->is_repeated() && !field->is_map() &&
+             field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE)
+      << field->full_name() << " is not a repeated message field.";
+
+  if (!options.executor || field->type() == FieldDescriptor::TYPE_GROUP) {
+    return message->ParseFromString(data);
+  }
+
+  std::vector<Span> spans;
+  std::string rest;
+  if (!ScanFields(data, field->number(), &spans, &rest)) {
+    return message->ParseFromString(data);
+  }
+
+  size_t total_bytes = 0;
+  for (const Span& span : spans) total_bytes += span.size;
+  size_t chunk_bytes = std::max<size_t>(options.min_chunk_bytes, 1);
+  if (options.max_chunks > 0) {
+    chunk_bytes = std::max(chunk_bytes, total_bytes / options.max_chunks + 1);
+  }
+  if (total_bytes < 2 * chunk_bytes) {
+    return message->ParseFromString(data);
+  }
+
+  // Chunk `i` holds the elements [chunk_begin[i], chunk_begin[i + 1]).
+  std::vector<size_t> chunk_begin = {0};
+  size_t bytes = 0;
+  for (size_t i = 0; i < spans.size(); ++i) {
+    if (bytes >= chunk_bytes) {
+      chunk_begin.push_back(i);
+      bytes = 0;
+    }
+    bytes += spans[i].size;
+  }
+  chunk_begin.push_back(spans.size());
+  const size_t num_chunks = chunk_begin.size() - 1;
+
+  // The other fields are cheap to parse and set up the message for the
+  // elements to be added.
+  if (!message->ParsePartialFromString(rest)) return false;
+
+  Arena* arena = message->GetArena();
+  const Message* prototype =
+      reflection->GetMessageFactory()->GetPrototype(field->message_type());
+  std::vector<Message*> elements(spans.size(), nullptr);
+  // Not std::vector<bool>, as chunks are written concurrently.
+  std::vector<char> chunk_ok(num_chunks, false);
+  constexpr size_t kMaxElementSize = std::numeric_limits<int>::max();
+  auto parse_chunk = [&](size_t chunk) {
+    for (size_t i = chunk_begin[chunk]; i < chunk_begin[chunk + 1]; ++i) {
+      const Span& span = spans[i];
+      if (span.size > kMaxElementSize) return;
+      elements[i] = prototype->New(arena);
+      if (!elements[i]->ParsePartialFromArray(data.data() + span.offset,
+                                              static_cast<int>(span.size))) {
+        return;
+      }
+    }
+    chunk_ok[chunk] = true;
+  };
+
+  {
+    absl::BlockingCounter pending(static_cast<int>(num_chunks - 1));
+    for (size_t chunk = 1; chunk < num_chunks; ++chunk) {
+      options.executor([&parse_chunk, &pending, chunk] {
+        parse_chunk(chunk);
+        pending.DecrementCount();
+      });
+    }
+    parse_chunk(0);
+    pending.Wait();
+  }
+
+  if (std::find(chunk_ok.begin(), chunk_ok.end(), false) != chunk_ok.end()) {
+    if (arena == nullptr) {
+      for (Message* element : elements) delete element;
+    }
+    return false;
+  }
+
+  // Elements share the arena of `message`, so they are added without copies.
+  for (Message* element : elements) {
+    reflection->AddAllocatedMessage(message, field, element);
+  }
+  return message->IsInitialized();
+}
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
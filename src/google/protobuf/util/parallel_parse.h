@@ -0,0 +1,73 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Parsing of messages dominated by one large repeated message field, such as
+//
+//   message Records {
+//     repeated Record records = 1;
+//   }
+//
+// on several threads.
+
+#ifndef GOOGLE_PROTOBUF_UTIL_PARALLEL_PARSE_H__
+#define GOOGLE_PROTOBUF_UTIL_PARALLEL_PARSE_H__
+
+#include <cstddef>
+#include <functional>
+
+#include "absl/strings/string_view.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+struct ParallelParseOptions {
+  // Runs the given task, on any thread and at any time. Tasks may run inline,
+  // but the call must not wait for other tasks to complete. If empty,
+  // everything is parsed on the calling thread.
+  std::function<void(std::function<void()>)> executor;
+
+  // Minimum number of bytes of the repeated field parsed by each task. Inputs
+  // whose repeated field is smaller than twice this are parsed sequentially.
+  size_t min_chunk_bytes = size_t{1} << 20;
+
+  // If non-zero, the maximum number of tasks, including the one run on the
+  // calling thread.
+  int max_chunks = 0;
+};
+
+// Parses `data` into `message` like Message::ParseFromString(), parsing the
+// elements of the repeated message field `field` in parallel.
+//
+// The input is first scanned for the boundaries of the elements of `field`,
+// which are then split into chunks of consecutive elements. One chunk is
+// parsed on the calling thread and the others on `options.executor`. Elements
+// are allocated on the arena of `message`, if any; since arenas are
+// thread-safe, each thread then allocates from its own part of that arena.
+// The parsed elements are finally appended to `field` in their original
+// order, so the result is the same as a sequential parse.
+//
+// `field` must be a non-map repeated message field of `message`. Inputs
+// encoding `field` as groups are parsed sequentially.
+//
+// Returns false if the input is invalid or required fields are missing.
+PROTOBUF_EXPORT bool ParallelParseFromString(
+    absl::string_view data, const FieldDescriptor* field,
+    const ParallelParseOptions& options, Message* message);
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_UTIL_PARALLEL_PARSE_H__
@@ -0,0 +1,120 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/parallel_parse.h"
+
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/strings/string_view.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/unittest.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+using protobuf_unittest::TestAllTypes;
+
+// Runs every task on a new thread, joined on destruction.
+class ThreadExecutor {
+ public:
+  ~ThreadExecutor() {
+    for (std::thread& thread : threads_) thread.join();
+  }
+
+  ParallelParseOptions Options() {
+    ParallelParseOptions options;
+    options.executor = [this](std::function<void()> task) {
+      threads_.emplace_back(std::move(task));
+    };
+    options.min_chunk_bytes = 64;
+    return options;
+  }
+
+ private:
+  std::vector<std::thread> threads_;
+};
+
+std::string MakeInput() {
+  TestAllTypes message;
+  message.set_optional_int32(1);
+  for (int i = 0; i < 1000; ++i) {
+    message.add_repeated_nested_message()->set_bb(i);
+    // Interleave another field to check it does not get in the way.
+    if (i % 100 == 0) message.add_repeated_int32(i);
+  }
+  message.set_optional_string("end");
+  return message.SerializeAsString();
+}
+
+const FieldDescriptor* RepeatedNestedMessage() {
+  return TestAllTypes::descriptor()->FindFieldByName(
+      "repeated_nested_message");
+}
+
+TEST(ParallelParseTest, MatchesSequentialParse) {
+  const std::string data = MakeInput();
+  TestAllTypes expected;
+  ASSERT_TRUE(expected.ParseFromString(data));
+
+  TestAllTypes message;
+  {
+    ThreadExecutor executor;
+    ASSERT_TRUE(ParallelParseFromString(data, RepeatedNestedMessage(),
+                                        executor.Options(), &message));
+  }
+  EXPECT_EQ(message.SerializeAsString(), expected.SerializeAsString());
+}
+
+TEST(ParallelParseTest, ParsesOnArena) {
+  const std::string data = MakeInput();
+  TestAllTypes expected;
+  ASSERT_TRUE(expected.ParseFromString(data));
+
+  Arena arena;
+  auto* message = Arena::Create<TestAllTypes>(&arena);
+  {
+    ThreadExecutor executor;
+    ParallelParseOptions options = executor.Options();
+    options.max_chunks = 4;
+    ASSERT_TRUE(ParallelParseFromString(data, RepeatedNestedMessage(), options,
+                                        message));
+  }
+  EXPECT_EQ(message->SerializeAsString(), expected.SerializeAsString());
+  EXPECT_EQ(message->repeated_nested_message(999).GetArena(), &arena);
+}
+
+TEST(ParallelParseTest, RejectsInvalidElement) {
+  std::string data = MakeInput();
+  // An element with a truncated varint.
+  data += "\x82\x03\x02\x08\x80";
+  TestAllTypes message;
+  ThreadExecutor executor;
+  EXPECT_FALSE(ParallelParseFromString(data, RepeatedNestedMessage(),
+                                       executor.Options(), &message));
+}
+
+TEST(ParallelParseTest, RejectsTruncatedInput) {
+  const std::string data = MakeInput();
+  TestAllTypes message;
+  ThreadExecutor executor;
+  EXPECT_FALSE(ParallelParseFromString(
+      absl::string_view(data).substr(0, data.size() - 1),
+      RepeatedNestedMessage(), executor.Options(), &message));
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
@@ -0,0 +1,58 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/reverse_serializer.h"
+
+#include <climits>
+#include <memory>
+#include <string>
+
+#include "absl/log/absl_check.h"
+#include "absl/log/absl_log.h"
+#include "google/protobuf/generated_message_tctable_impl.h"
+#include "google/protobuf/message.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+ReverseSerializer::ReverseSerializer()
+    : buffer_(std::make_unique<internal::ReverseBuffer>()) {}
+
+ReverseSerializer::~ReverseSerializer() = default;
+
+bool ReverseSerializer::SerializeToString(const Message& message,
+                                          std::string* output) {
+  ABSL_DCHECK(message.IsInitialized())
+      << "Can't serialize message of type \"" << message.GetTypeName()
+      << "\" because it is missing required fields: "
+      << message.InitializationErrorString();
+  return SerializePartialToString(message, output);
+}
+
+bool ReverseSerializer::SerializePartialToString(const Message& message,
+                                                 std::string* output) {
+  buffer_->Clear();
+  internal::TcParser::SerializeReverse(message, *buffer_);
+  if (buffer_->size() > INT_MAX) {
+    ABSL_LOG(ERROR) << message.GetTypeName()
+                    << " exceeded maximum protobuf size of 2GB: "
+                    << buffer_->size();
+    return false;
+  }
+  output->assign(buffer_->data(), buffer_->size());
+  return true;
+}
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
@@ -0,0 +1,68 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Serialization of messages in a single pass, without computing their sizes
+// first.
+
+#ifndef GOOGLE_PROTOBUF_UTIL_REVERSE_SERIALIZER_H__
+#define GOOGLE_PROTOBUF_UTIL_REVERSE_SERIALIZER_H__
+
+#include <memory>
+#include <string>
+
+#include "google/protobuf/message.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace internal {
+class ReverseBuffer;
+}  // namespace internal
+namespace util {
+
+// Serializes messages from the end of a buffer to its front.
+//
+// Message::SerializeToString() first calls ByteSizeLong(), which walks the
+// whole message tree to compute and cache the size of every submessage, and
+// then walks it again to write the data, prefixing each submessage with its
+// cached size. Writing back to front, the last field is written first and the
+// size of a submessage is known once it was written, right before its length
+// prefix is. Each message is therefore visited once, and no sizes are cached.
+//
+// The output is the same as that of SerializeToString(). Like the
+// table-driven serializer, fields are written using the parse tables of the
+// messages. Messages with maps, weak, lazy or StringPiece fields, extensions,
+// or unknown fields kept in an UnknownFieldSet are written by the regular
+// serializer instead, which computes the sizes of their submessages first.
+//
+// A ReverseSerializer reuses its buffer across calls, so serializing many
+// messages with one instance avoids most allocations. It is not thread-safe.
+class PROTOBUF_EXPORT ReverseSerializer {
+ public:
+  ReverseSerializer();
+  ReverseSerializer(const ReverseSerializer&) = delete;
+  ReverseSerializer& operator=(const ReverseSerializer&) = delete;
+  ~ReverseSerializer();
+
+  // Like Message::SerializeToString().
+  bool SerializeToString(const Message& message, std::string* output);
+  // Like Message::SerializePartialToString().
+  bool SerializePartialToString(const Message& message, std::string* output);
+
+ private:
+  std::unique_ptr<internal::ReverseBuffer> buffer_;
+};
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_UTIL_REVERSE_SERIALIZER_H__
@@ -0,0 +1,123 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/reverse_serializer.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+#include "google/protobuf/map_test_util.h"
+#include "google/protobuf/map_unittest.pb.h"
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/unittest.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+using protobuf_unittest::TestAllExtensions;
+using protobuf_unittest::TestAllTypes;
+using protobuf_unittest::TestPackedTypes;
+using protobuf_unittest::TestRecursiveMessage;
+
+TEST(ReverseSerializerTest, AllFields) {
+  TestAllTypes message;
+  TestUtil::SetAllFields(&message);
+  ReverseSerializer serializer;
+  std::string output;
+  ASSERT_TRUE(serializer.SerializeToString(message, &output));
+  EXPECT_EQ(output, message.SerializeAsString());
+}
+
+TEST(ReverseSerializerTest, AllExtensions) {
+  TestAllExtensions message;
+  TestUtil::SetAllExtensions(&message);
+  ReverseSerializer serializer;
+  std::string output;
+  ASSERT_TRUE(serializer.SerializeToString(message, &output));
+  EXPECT_EQ(output, message.SerializeAsString());
+}
+
+TEST(ReverseSerializerTest, PackedFields) {
+  TestPackedTypes message;
+  TestUtil::SetPackedFields(&message);
+  ReverseSerializer serializer;
+  std::string output;
+  ASSERT_TRUE(serializer.SerializeToString(message, &output));
+  EXPECT_EQ(output, message.SerializeAsString());
+}
+
+TEST(ReverseSerializerTest, UnknownFields) {
+  TestAllTypes all;
+  TestUtil::SetAllFields(&all);
+  TestAllExtensions message;
+  ASSERT_TRUE(message.ParseFromString(all.SerializeAsString()));
+  message.SetExtension(protobuf_unittest::optional_int32_extension, 5);
+  ReverseSerializer serializer;
+  std::string output;
+  ASSERT_TRUE(serializer.SerializeToString(message, &output));
+  EXPECT_EQ(output, message.SerializeAsString());
+}
+
+TEST(ReverseSerializerTest, DeepNesting) {
+  TestRecursiveMessage message;
+  TestRecursiveMessage* m = &message;
+  for (int i = 0; i < 90; ++i) {
+    m->set_i(i);
+    m = m->mutable_a();
+  }
+  m->set_i(-1);
+  ReverseSerializer serializer;
+  std::string output;
+  ASSERT_TRUE(serializer.SerializeToString(message, &output));
+  EXPECT_EQ(output, message.SerializeAsString());
+}
+
+TEST(ReverseSerializerTest, Maps) {
+  protobuf_unittest::TestMap message;
+  MapTestUtil::SetMapFields(&message);
+  ReverseSerializer serializer;
+  std::string output;
+  ASSERT_TRUE(serializer.SerializeToString(message, &output));
+  // Messages with maps are written by the regular serializer.
+  EXPECT_EQ(output, message.SerializeAsString());
+  protobuf_unittest::TestMap parsed;
+  ASSERT_TRUE(parsed.ParseFromString(output));
+  MapTestUtil::ExpectMapFieldsSet(parsed);
+}
+
+TEST(ReverseSerializerTest, SubmessageWithMaps) {
+  protobuf_unittest::TestMapSubmessage message;
+  MapTestUtil::SetMapFields(message.mutable_test_map());
+  ReverseSerializer serializer;
+  std::string output;
+  ASSERT_TRUE(serializer.SerializeToString(message, &output));
+  EXPECT_EQ(output, message.SerializeAsString());
+}
+
+TEST(ReverseSerializerTest, ReusesSerializer) {
+  ReverseSerializer serializer;
+  std::string output;
+  TestAllTypes message;
+  TestUtil::SetAllFields(&message);
+  ASSERT_TRUE(serializer.SerializeToString(message, &output));
+
+  TestAllTypes small;
+  small.set_optional_int32(1);
+  ASSERT_TRUE(serializer.SerializeToString(small, &output));
+  EXPECT_EQ(output, small.SerializeAsString());
+
+  TestAllTypes empty;
+  ASSERT_TRUE(serializer.SerializeToString(empty, &output));
+  EXPECT_EQ(output, "");
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
@@ -21,10 +21,27 @@
 #include <stdint.h>
 #include <string.h>
 
-#ifdef __SSE4_1__
+/* The SSE4.1 and AVX2 kernels are built with function target attributes when
+ * the compiler supports them, and picked at runtime. A build with -msse4.1 or
+ * -mavx2 uses them unconditionally.
+ */
+#if defined(__x86_64__) || defined(__i386__)
+#if defined(__GNUC__)
+#include <immintrin.h>
+#define UTF8_RANGE_SSE4 1
+#define UTF8_RANGE_AVX2 1
+#define UTF8_RANGE_TARGET_SSE4 __attribute__((target("sse4.1")))
+#define UTF8_RANGE_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(__SSE4_1__)
 #include <emmintrin.h>
 #include <smmintrin.h>
 #include <tmmintrin.h>
+#define UTF8_RANGE_SSE4 1
+#define UTF8_RANGE_TARGET_SSE4
+#endif
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define UTF8_RANGE_NEON 1
 #endif
 
 #if defined(__GNUC__)
@@ -143,7 +160,7 @@ static size_t utf8_range_ValidateUTF8Naive(const char* data, const char* end,
   return err_pos + (1 - return_position);
 }
 
-#ifdef __SSE4_1__
+#if defined(UTF8_RANGE_SSE4) || defined(UTF8_RANGE_NEON)
 /* Returns the number of bytes needed to skip backwards to get to the first
    byte of codepoint.
  */
@@ -158,7 +175,7 @@ static inline int utf8_range_CodepointSkipBackwards(int32_t codepoint_word) {
   }
   return 0;
 }
-#endif  // __SSE4_1__
+#endif  // UTF8_RANGE_SSE4 || UTF8_RANGE_NEON
 
 /* Skipping over ASCII as much as possible, per 8 bytes. It is intentional
    as most strings to check for validity consist only of 1 byte codepoints.
@@ -175,22 +192,20 @@ static inline const char* utf8_range_SkipAscii(const char* data,
   return data;
 }
 
-static FORCE_INLINE_ATTR inline size_t utf8_range_Validate(
-    const char* data, size_t len, int return_position) {
-  if (len == 0) return 1 - return_position;
-  const char* const end = data + len;
-  data = utf8_range_SkipAscii(data, end);
-  /* SIMD algorithm always outperforms the naive version for any data of
-     length >=16.
-   */
-  if (end - data < 16) {
-    return (return_position ? (data - (end - len)) : 0) +
-           utf8_range_ValidateUTF8Naive(data, end, return_position);
-  }
-#ifndef __SSE4_1__
-  return (return_position ? (data - (end - len)) : 0) +
-         utf8_range_ValidateUTF8Naive(data, end, return_position);
+#ifdef UTF8_RANGE_SSE4
+static inline int utf8_range_HasSse4(void) {
+#ifdef __SSE4_1__
+  return 1;
 #else
+  return __builtin_cpu_supports("sse4.1");
+#endif
+}
+
+/* Validates [data, end), at least 16 bytes long, 16 bytes at a time. The whole
+ * input is the |len| bytes ending at |end|.
+ */
+static UTF8_RANGE_TARGET_SSE4 size_t utf8_range_ValidateSse4(
+    const char* data, const char* end, size_t len, int return_position) {
   /* This code checks that utf-8 ranges are structurally valid 16 bytes at once
    * using superscalar instructions.
    * The mapping between ranges of codepoint and their corresponding utf-8
@@ -455,6 +470,233 @@ static FORCE_INLINE_ATTR inline size_t utf8_range_Validate(
   }
   /* Check the tail */
   return utf8_range_ValidateUTF8Naive(data, end, return_position);
+}
+#endif  // UTF8_RANGE_SSE4
+
+#ifdef UTF8_RANGE_AVX2
+static inline int utf8_range_HasAvx2(void) {
+#ifdef __AVX2__
+  return 1;
+#else
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+
+/* Same algorithm as utf8_range_ValidateSse4(), 32 bytes at a time. Byte shifts
+ * and shuffles work within each 128-bit lane, so the bytes shifted in from the
+ * previous block come from a permutation of the previous and current vectors:
+ * (prev, input) << 1 byte is alignr(input, (prev.hi, input.lo), 15).
+ */
+static UTF8_RANGE_TARGET_AVX2 size_t utf8_range_ValidateAvx2(
+    const char* data, const char* end, size_t len, int return_position) {
+  const __m256i first_len_table = _mm256_broadcastsi128_si256(
+      _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 2, 3));
+  const __m256i first_range_table = _mm256_broadcastsi128_si256(
+      _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 8, 8, 8, 8));
+  const __m256i range_min_table = _mm256_broadcastsi128_si256(
+      _mm_setr_epi8(0x00, 0x80, 0x80, 0x80, 0xA0, 0x80, 0x90, 0x80, 0xC2, 0x7F,
+                    0x7F, 0x7F, 0x7F, 0x7F, 0x7F, 0x7F));
+  const __m256i range_max_table = _mm256_broadcastsi128_si256(
+      _mm_setr_epi8(0x7F, 0xBF, 0xBF, 0xBF, 0xBF, 0x9F, 0xBF, 0x8F, 0xF4, 0x80,
+                    0x80, 0x80, 0x80, 0x80, 0x80, 0x80));
+  const __m256i df_ee_table = _mm256_broadcastsi128_si256(
+      _mm_setr_epi8(0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 0));
+  const __m256i ef_fe_table = _mm256_broadcastsi128_si256(
+      _mm_setr_epi8(0, 3, 0, 0, 0, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0));
+
+  __m256i prev_input = _mm256_setzero_si256();
+  __m256i prev_first_len = _mm256_setzero_si256();
+  __m256i error = _mm256_setzero_si256();
+  while (end - data >= 32) {
+    const __m256i input = _mm256_loadu_si256((const __m256i*)(data));
+
+    const __m256i high_nibbles =
+        _mm256_and_si256(_mm256_srli_epi16(input, 4), _mm256_set1_epi8(0x0F));
+    const __m256i first_len = _mm256_shuffle_epi8(first_len_table, high_nibbles);
+    __m256i range = _mm256_shuffle_epi8(first_range_table, high_nibbles);
+
+    /* (prev_first_len.hi, first_len.lo) */
+    const __m256i mid_first_len =
+        _mm256_permute2x128_si256(prev_first_len, first_len, 0x21);
+    range = _mm256_or_si256(range,
+                            _mm256_alignr_epi8(first_len, mid_first_len, 15));
+
+    __m256i tmp1;
+    __m256i tmp2;
+    tmp1 = _mm256_subs_epu8(first_len, _mm256_set1_epi8(1));
+    tmp2 = _mm256_subs_epu8(mid_first_len, _mm256_set1_epi8(1));
+    range = _mm256_or_si256(range, _mm256_alignr_epi8(tmp1, tmp2, 14));
+
+    tmp1 = _mm256_subs_epu8(first_len, _mm256_set1_epi8(2));
+    tmp2 = _mm256_subs_epu8(mid_first_len, _mm256_set1_epi8(2));
+    range = _mm256_or_si256(range, _mm256_alignr_epi8(tmp1, tmp2, 13));
+
+    const __m256i mid_input =
+        _mm256_permute2x128_si256(prev_input, input, 0x21);
+    const __m256i shift1 = _mm256_alignr_epi8(input, mid_input, 15);
+    const __m256i pos = _mm256_sub_epi8(shift1, _mm256_set1_epi8(0xEF));
+    tmp1 = _mm256_subs_epu8(pos, _mm256_set1_epi8(-16));
+    __m256i range2 = _mm256_shuffle_epi8(df_ee_table, tmp1);
+    tmp2 = _mm256_adds_epu8(pos, _mm256_set1_epi8(112));
+    range2 = _mm256_add_epi8(range2, _mm256_shuffle_epi8(ef_fe_table, tmp2));
+
+    range = _mm256_add_epi8(range, range2);
+
+    const __m256i min_range = _mm256_shuffle_epi8(range_min_table, range);
+    const __m256i max_range = _mm256_shuffle_epi8(range_max_table, range);
+
+    if (return_position) {
+      error = _mm256_cmpgt_epi8(min_range, input);
+      error = _mm256_or_si256(error, _mm256_cmpgt_epi8(input, max_range));
+      if (!_mm256_testz_si256(error, error)) {
+        break;
+      }
+    } else {
+      error = _mm256_or_si256(error, _mm256_cmpgt_epi8(min_range, input));
+      error = _mm256_or_si256(error, _mm256_cmpgt_epi8(input, max_range));
+    }
+
+    prev_input = input;
+    prev_first_len = first_len;
+
+    data += 32;
+  }
+  if (return_position && (data - (end - len)) == 0) {
+    return utf8_range_ValidateUTF8Naive(data, end, return_position);
+  }
+  data -=
+      utf8_range_CodepointSkipBackwards(_mm256_extract_epi32(prev_input, 7));
+  if (return_position) {
+    return (data - (end - len)) +
+           utf8_range_ValidateUTF8Naive(data, end, return_position);
+  }
+  if (!_mm256_testz_si256(error, error)) {
+    return 0;
+  }
+  return utf8_range_ValidateUTF8Naive(data, end, return_position);
+}
+#endif  // UTF8_RANGE_AVX2
+
+#ifdef UTF8_RANGE_NEON
+/* Same algorithm as utf8_range_ValidateSse4(). TBL yields 0 for indices past
+ * the table rather than using their low nibble, so the F0/F4 adjustment is
+ * looked up with |pos| directly. The range check is unsigned, so the invalid
+ * indices map to the empty range [FF, 00].
+ */
+static size_t utf8_range_ValidateNeon(const char* data, const char* end,
+                                      size_t len, int return_position) {
+  static const uint8_t kFirstLen[16] = {0, 0, 0, 0, 0, 0, 0, 0,
+                                        0, 0, 0, 0, 1, 1, 2, 3};
+  static const uint8_t kFirstRange[16] = {0, 0, 0, 0, 0, 0, 0, 0,
+                                          0, 0, 0, 0, 8, 8, 8, 8};
+  static const uint8_t kRangeMin[16] = {0x00, 0x80, 0x80, 0x80, 0xA0, 0x80,
+                                        0x90, 0x80, 0xC2, 0xFF, 0xFF, 0xFF,
+                                        0xFF, 0xFF, 0xFF, 0xFF};
+  static const uint8_t kRangeMax[16] = {0x7F, 0xBF, 0xBF, 0xBF, 0xBF, 0x9F,
+                                        0xBF, 0x8F, 0xF4, 0x00, 0x00, 0x00,
+                                        0x00, 0x00, 0x00, 0x00};
+  static const uint8_t kDfEe[16] = {0, 2, 0, 0, 0, 0, 0, 0,
+                                    0, 0, 0, 0, 0, 0, 3, 0};
+  static const uint8_t kEfFe[16] = {0, 3, 0, 0, 0, 4, 0, 0,
+                                    0, 0, 0, 0, 0, 0, 0, 0};
+  const uint8x16_t first_len_table = vld1q_u8(kFirstLen);
+  const uint8x16_t first_range_table = vld1q_u8(kFirstRange);
+  const uint8x16_t range_min_table = vld1q_u8(kRangeMin);
+  const uint8x16_t range_max_table = vld1q_u8(kRangeMax);
+  const uint8x16_t df_ee_table = vld1q_u8(kDfEe);
+  const uint8x16_t ef_fe_table = vld1q_u8(kEfFe);
+
+  uint8x16_t prev_input = vdupq_n_u8(0);
+  uint8x16_t prev_first_len = vdupq_n_u8(0);
+  uint8x16_t error = vdupq_n_u8(0);
+  while (end - data >= 16) {
+    const uint8x16_t input = vld1q_u8((const uint8_t*)data);
+
+    const uint8x16_t high_nibbles = vshrq_n_u8(input, 4);
+    const uint8x16_t first_len = vqtbl1q_u8(first_len_table, high_nibbles);
+    uint8x16_t range = vqtbl1q_u8(first_range_table, high_nibbles);
+
+    range = vorrq_u8(range, vextq_u8(prev_first_len, first_len, 15));
+
+    uint8x16_t tmp1;
+    uint8x16_t tmp2;
+    tmp1 = vqsubq_u8(first_len, vdupq_n_u8(1));
+    tmp2 = vqsubq_u8(prev_first_len, vdupq_n_u8(1));
+    range = vorrq_u8(range, vextq_u8(tmp2, tmp1, 14));
+
+    tmp1 = vqsubq_u8(first_len, vdupq_n_u8(2));
+    tmp2 = vqsubq_u8(prev_first_len, vdupq_n_u8(2));
+    range = vorrq_u8(range, vextq_u8(tmp2, tmp1, 13));
+
+    const uint8x16_t shift1 = vextq_u8(prev_input, input, 15);
+    const uint8x16_t pos = vsubq_u8(shift1, vdupq_n_u8(0xEF));
+    uint8x16_t range2 =
+        vqtbl1q_u8(df_ee_table, vqsubq_u8(pos, vdupq_n_u8(240)));
+    range2 = vaddq_u8(range2, vqtbl1q_u8(ef_fe_table, pos));
+
+    range = vaddq_u8(range, range2);
+
+    const uint8x16_t min_range = vqtbl1q_u8(range_min_table, range);
+    const uint8x16_t max_range = vqtbl1q_u8(range_max_table, range);
+
+    if (return_position) {
+      error = vorrq_u8(vcltq_u8(input, min_range), vcgtq_u8(input, max_range));
+      if (vmaxvq_u8(error) != 0) {
+        break;
+      }
+    } else {
+      error = vorrq_u8(error, vcltq_u8(input, min_range));
+      error = vorrq_u8(error, vcgtq_u8(input, max_range));
+    }
+
+    prev_input = input;
+    prev_first_len = first_len;
+
+    data += 16;
+  }
+  if (return_position && (data - (end - len)) == 0) {
+    return utf8_range_ValidateUTF8Naive(data, end, return_position);
+  }
+  data -= utf8_range_CodepointSkipBackwards(
+      vgetq_lane_s32(vreinterpretq_s32_u8(prev_input), 3));
+  if (return_position) {
+    return (data - (end - len)) +
+           utf8_range_ValidateUTF8Naive(data, end, return_position);
+  }
+  if (vmaxvq_u8(error) != 0) {
+    return 0;
+  }
+  return utf8_range_ValidateUTF8Naive(data, end, return_position);
+}
+#endif  // UTF8_RANGE_NEON
+
+static FORCE_INLINE_ATTR inline size_t utf8_range_Validate(
+    const char* data, size_t len, int return_position) {
+  if (len == 0) return 1 - return_position;
+  const char* const end = data + len;
+  data = utf8_range_SkipAscii(data, end);
+  /* SIMD algorithm always outperforms the naive version for any data of
+     length >=16.
+   */
+  if (end - data < 16) {
+    return (return_position ? (data - (end - len)) : 0) +
+           utf8_range_ValidateUTF8Naive(data, end, return_position);
+  }
+#ifdef UTF8_RANGE_NEON
+  return utf8_range_ValidateNeon(data, end, len, return_position);
+#else
+#ifdef UTF8_RANGE_AVX2
+  if (end - data >= 32 && utf8_range_HasAvx2()) {
+    return utf8_range_ValidateAvx2(data, end, len, return_position);
+  }
+#endif
+#ifdef UTF8_RANGE_SSE4
+  if (utf8_range_HasSse4()) {
+    return utf8_range_ValidateSse4(data, end, len, return_position);
+  }
+#endif
+  return (return_position ? (data - (end - len)) : 0) +
+         utf8_range_ValidateUTF8Naive(data, end, return_position);
 #endif
 }
 
@@ -1,6 +1,9 @@
 #include "utf8_validity.h"
 
+#include <string>
+
 #include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 
 namespace utf8_range {
@@ -73,4 +76,27 @@ TEST(Utf8Validity, IsStructurallyValid) {
   EXPECT_FALSE(IsStructurallyValid("\xc7\xc8\xcd\xcb"));
 }
 
+TEST(Utf8Validity, LongStrings) {
+  // Inputs of 16 bytes and more go through the SIMD validators, which carry
+  // state from one block to the next. Put errors at every codepoint boundary.
+  const std::string kGood = "ab\xc2\x81\xe2\x81\x81\xf2\x81\x81\x81";
+  std::string text;
+  for (int i = 0; i < 12; ++i) text += kGood;
+  EXPECT_TRUE(IsStructurallyValid(text));
+  EXPECT_EQ(text.size(), SpanStructurallyValid(text));
+
+  const absl::string_view kBad[] = {"\x80", "\xc2", "\xe0\x81\x81",
+                                    "\xf4\xbf\xbf\xbf", "\xED\xA0\x80",
+                                    "\xc7\xc8\xcd\xcb"};
+  for (size_t i = 0; i <= text.size(); ++i) {
+    const absl::string_view head = absl::string_view(text).substr(0, i);
+    if (SpanStructurallyValid(head) != i) continue;
+    for (absl::string_view bad : kBad) {
+      const std::string str = absl::StrCat(head, bad, text);
+      EXPECT_FALSE(IsStructurallyValid(str)) << i;
+      EXPECT_EQ(i, SpanStructurallyValid(str));
+    }
+  }
+}
+
 }  // namespace utf8_range